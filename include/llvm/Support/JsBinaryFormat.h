@@ -0,0 +1,116 @@
+//===-- llvm/Support/JsBinaryFormat.h - JsBackend binary format -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header defines the binary form of the intertype stream, which the
+// Javascript backend writes instead of JSON when asked for an object file
+// (llc -filetype=obj).  It carries the same globals, functions, instructions,
+// operands and constants as the JSON form, plus the basic block boundaries.
+//
+// The enum values defined in this file should be considered permanent.  If
+// new features are added, they should have values added at the end of the
+// respective lists.
+//
+// Encoding
+// --------
+// Unless stated otherwise, integers are unsigned LEB128 (7 bits per byte,
+// least significant group first, high bit set on all bytes but the last).
+// Signed integers are zigzag encoded first: (n << 1) ^ (n >> 63).
+//
+//   str   - an index into the string pool.
+//   ostr  - 0 if absent, otherwise an index into the string pool plus one.
+//   ty    - an index into the type pool.
+//   oty   - 0 if absent, otherwise an index into the type pool plus one.
+//
+// File layout
+// -----------
+//   File      := 'J' 'S' 'I' 'B' Version Item* Pools Trailer
+//   Version   := uint (JS_BINARY_VERSION)
+//   Item      := Kind:uint Length:uint Payload[Length]
+//   Pools     := StringPool TypePool
+//   StringPool:= Count:uint (Length:uint Bytes[Length])*
+//   TypePool  := Count:uint Description:str*
+//   Trailer   := PoolsOffset:uint32 (little endian, from the start of the file)
+//
+// The pools come last so that the writer can stream the items, and every item
+// is prefixed by its length so that a reader can index the items up front and
+// decode the functions lazily.  Strings are not NUL terminated, so a reader
+// can refer to them in place.  The type descriptions are the textual LLVM
+// types that the JSON form prints.
+//
+// Items
+// -----
+//   ITEM_GLOBAL   := ident:str lineNum:uint type:ty value:Value
+//   ITEM_FUNCTION := ident:str lineNum:uint returnType:ty
+//                    NumParams:uint param:str* NumBlocks:uint Block*
+//   Block         := name:str NumInsts:uint Inst*
+//   Inst          := ident:ostr intertype:str lineNum:uint type:oty
+//                    NumOperands:uint Operand*
+//
+// Only terminators have a type and only non-terminators have an ident, as in
+// the JSON form.  The intertype is the LLVM opcode name ("add", "br", ...),
+// except that a getelementptr whose indices are all constant is folded into
+// "offset", whose operands are the pointer and an i32 byte offset from it.
+//
+// Operands and constants
+// ----------------------
+//   Operand := type:ty Value
+//   Value   := Tag:uint followed by
+//     VALUE_LOCAL     name:str          - argument, instruction or block
+//     VALUE_GLOBAL    name:str          - global variable or function
+//     VALUE_INT       value:sint        - sign extended to 64 bits
+//     VALUE_BOOL      value:uint        - 0 or 1
+//     VALUE_FLOAT     Bytes[8]          - IEEE double, little endian
+//     VALUE_NULL                        - null pointer
+//     VALUE_UNDEF                       - undefined scalar or vector
+//     VALUE_STRING    bytes:str         - i8 array, without the trailing NUL
+//     VALUE_AGGREGATE Count:uint Value* - array, struct or vector elements
+//     VALUE_ZERO                        - zero of the enclosing aggregate type
+//     VALUE_EXPR      opcode:str predicate:uint NumOperands:uint Operand*
+//
+// Constant getelementptrs are folded into "offset" expressions in the same
+// way, or into their pointer if the offset is 0.  The predicate of a
+// VALUE_EXPR is the LLVM CmpInst predicate for "icmp" and "fcmp"
+// (FCMP_FALSE = 0 ... FCMP_TRUE = 15, ICMP_EQ = 32 ... ICMP_SLE = 41) and 0
+// otherwise.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_JSBINARYFORMAT_H
+#define LLVM_SUPPORT_JSBINARYFORMAT_H
+
+namespace llvm {
+namespace jsbin {
+  enum {
+    JS_BINARY_VERSION = 1
+  };
+
+  /// ItemKinds - The kinds of the top-level items.
+  enum ItemKinds {
+    ITEM_GLOBAL   = 1,
+    ITEM_FUNCTION = 2
+  };
+
+  /// ValueTags - The tags that start every encoded value.
+  enum ValueTags {
+    VALUE_LOCAL     = 0,
+    VALUE_GLOBAL    = 1,
+    VALUE_INT       = 2,
+    VALUE_BOOL      = 3,
+    VALUE_FLOAT     = 4,
+    VALUE_NULL      = 5,
+    VALUE_UNDEF     = 6,
+    VALUE_STRING    = 7,
+    VALUE_AGGREGATE = 8,
+    VALUE_ZERO      = 9,
+    VALUE_EXPR      = 10
+  };
+} // End jsbin namespace
+} // End llvm namespace
+
+#endif
@@ -8,11 +8,18 @@
 //===----------------------------------------------------------------------===//
 //
 // This library converts LLVM IR to a JSON format, suitable for consumption by
-// Emscripten.
+// Emscripten.  With -js-codegen it instead emits executable javascript that
+// keeps the memory of the program in a typed-array heap.
 //
 //===----------------------------------------------------------------------===//
 
 #include "JsTargetMachine.h"
+#include "JsCodeSplitting.h"
+#include "JsFrameLayout.h"
+#include "JsLocalColoring.h"
+#include "JsNameMinifier.h"
+#include "JsRelooper.h"
+#include "JsSourceMap.h"
 #include "llvm/CallingConv.h"
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
@@ -24,16 +31,22 @@
 #include "llvm/Intrinsics.h"
 #include "llvm/IntrinsicInst.h"
 #include "llvm/InlineAsm.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Analysis/ConstantsScanner.h"
+#include "llvm/Analysis/DebugInfo.h"
 #include "llvm/Analysis/FindUsedTypes.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/Target/Mangler.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
@@ -46,11 +59,140 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/JsBinaryFormat.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV2.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/RWMutex.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/system_error.h"
 #include "llvm/Config/config.h"
 #include <algorithm>
+#include <map>
+#if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
 using namespace llvm;
 
+static cl::opt<unsigned>
+JsThreads("js-threads",
+          cl::desc("Number of threads used to emit functions in the "
+                   "javascript backend (default = 1)"),
+          cl::value_desc("N"), cl::init(1));
+
+static cl::opt<bool>
+JsStream("js-stream",
+         cl::desc("At -O0, read each function body of a module that is read "
+                  "lazily only to emit it, and release it once it is written "
+                  "out"));
+
+static cl::opt<bool>
+JsTypeTable("js-type-table",
+            cl::desc("Emit a module-level type table and refer to types by "
+                     "their index in it"));
+
+static cl::opt<bool>
+JsCodeGen("js-codegen",
+          cl::desc("Emit executable javascript instead of the intertype "
+                   "JSON"));
+
+static cl::opt<bool>
+JsLegalizeI64("js-legalize-i64",
+              cl::desc("Split the i64 values of the javascript code "
+                       "generator, including the arguments and results of "
+                       "functions, into exact operations on i32 halves"),
+              cl::init(true));
+
+static cl::opt<bool>
+JsReuseLocals("js-reuse-locals",
+              cl::desc("Let the values of the javascript code generator whose "
+                       "live ranges do not overlap share locals"));
+
+static cl::opt<bool>
+JsCoalescePhis("js-coalesce-phis",
+               cl::desc("Let the phis of the javascript code generator share "
+                        "the locals of their incoming values where their live "
+                        "ranges do not overlap"),
+               cl::init(true));
+
+static cl::opt<bool>
+JsShareStackSlots("js-share-stack-slots",
+                  cl::desc("Let the static allocas of the javascript code "
+                           "generator whose contents are never live at the "
+                           "same time share stack slots"),
+                  cl::init(true));
+
+static cl::opt<bool>
+JsMemInit("js-mem-init",
+          cl::desc("Lay out the internal global variables of the intertype "
+                   "JSON in one memory image, and embed it, or the static "
+                   "data of the code generator, as base64"));
+
+static cl::opt<std::string>
+JsMemInitFile("js-mem-init-file",
+              cl::desc("With -js-mem-init, write the memory image to this "
+                       "file instead of embedding it"),
+              cl::value_desc("filename"));
+
+static cl::opt<bool>
+JsMinifyNames("js-minify-names",
+              cl::desc("Give the locals and internal globals of the "
+                       "javascript backend the shortest names"));
+
+static cl::opt<std::string>
+JsNameMap("js-name-map",
+          cl::desc("With -js-minify-names, write the original names of the "
+                   "minified ones to this file"),
+          cl::value_desc("filename"));
+
+static cl::opt<std::string>
+JsSourceMapFile("js-source-map",
+                cl::desc("With -js-codegen, write a source map of the output "
+                         "to this file"),
+                cl::value_desc("filename"));
+
+static cl::opt<std::string>
+JsSplit("js-split",
+        cl::desc("With -js-codegen, move the functions that do not run at "
+                 "startup to chunks that are loaded on first use, written "
+                 "to <prefix>N.js"),
+        cl::value_desc("prefix"));
+
+static cl::opt<unsigned>
+JsSplitChunkSize("js-split-chunk-size",
+                 cl::desc("The number of instructions in a chunk of "
+                          "-js-split (default = 4096)"),
+                 cl::value_desc("N"), cl::init(4096));
+
+static cl::opt<std::string>
+JsProfile("js-profile",
+          cl::desc("Profile data that guides the layout of the output of "
+                   "the javascript code generator"),
+          cl::value_desc("llvmprof.out"));
+
+static cl::opt<std::string>
+JsExports("js-exports",
+          cl::desc("Keep only main and the symbols listed in this file "
+                   "external, and remove the code and data that they do "
+                   "not use"),
+          cl::value_desc("filename"));
+
+static cl::opt<bool>
+JsProfileInstrument("js-profile-instrument",
+                    cl::desc("Instrument the output of the javascript code "
+                             "generator to count the executions of the "
+                             "functions and edges, in the llvmprof.out "
+                             "format"));
+
+/// JsConstantsLock - Guards the creation of new constants by the emission
+/// threads, as the constant uniquing tables of the context are not thread
+/// safe.
+static ManagedStatic<sys::SmartMutex<true> > JsConstantsLock;
+
 extern "C" void LLVMInitializeJsBackendTarget() { 
   // Register the target.
   RegisterTargetMachine<JsTargetMachine> X(TheJsBackendTarget);
@@ -64,19 +206,79 @@ namespace {
       PrivateGlobalPrefix = "";
     }
   };
+  /// TypeTable - The types printed by the writer, numbered in the order in
+  /// which they are first used by the module.
+  struct TypeTable {
+    std::vector<const Type*> Types;
+    DenseMap<const Type*, unsigned> IDs;
+
+    void addType(const Type *Ty) {
+      if (IDs.insert(std::make_pair(Ty, (unsigned)Types.size())).second)
+        Types.push_back(Ty);
+    }
+    void addValue(const Value *V, SmallPtrSet<const Constant*, 32> &Visited);
+  };
+
+  /// JsCaseRange - The consecutive case values Low to High of a switch, which
+  /// all lead to the destination of successor Succ.
+  struct JsCaseRange {
+    int64_t Low, High;
+    unsigned Succ;
+  };
+
+  /// BodyFacts - With -js-stream, what the writer needs to know about the
+  /// function bodies of the module before it reads them one at a time: the
+  /// functions whose address is taken, the types of the indirect calls, and
+  /// the uses of the globals by the instructions.
+  struct BodyFacts {
+    SmallPtrSet<const Function*, 32> AddressTaken;
+    std::set<const FunctionType*> IndirectCalls;
+    DenseMap<const GlobalValue*, unsigned> Uses;
+
+    void addFunction(const Function &F,
+                     SmallPtrSet<const Constant*, 32> &Visited);
+    void addAddressTaken(const Value *V,
+                         SmallPtrSet<const Constant*, 32> &Visited);
+  };
+
   /// JsBackendNameAllUsedStructsAndMergeFunctions - This pass inserts names for
   /// any unnamed structure types that are used by the program, and merges
-  /// external functions with the same name.
+  /// external functions with the same name.  With -js-type-table, or when
+  /// writing the binary format, it also numbers the types that the writer
+  /// prints.
+  ///
+  /// With -js-stream the bodies of the functions are read one at a time, and
+  /// released again, to find the types they use and to gather the BodyFacts
+  /// of the writer.
   ///
   class JsBackendNameAllUsedStructsAndMergeFunctions : public ModulePass {
+    TypeTable Types;
+    bool NumberTypes;
+    bool Stream;
+    BodyFacts Facts;
+
   public:
     static char ID;
-    JsBackendNameAllUsedStructsAndMergeFunctions() 
-      : ModulePass(ID) {
+    JsBackendNameAllUsedStructsAndMergeFunctions(bool NumberTypes, bool Stream)
+      : ModulePass(ID), NumberTypes(NumberTypes), Stream(Stream) {
       initializeFindUsedTypesPass(*PassRegistry::getPassRegistry());
     }
+
+    /// getTypeTable - Return the type table built by this pass, or null if
+    /// the writer should print the types inline.
+    const TypeTable *getTypeTable() const {
+      return NumberTypes ? &Types : 0;
+    }
+
+    /// getBodyFacts - Return the facts gathered by this pass with -js-stream,
+    /// or null.
+    const BodyFacts *getBodyFacts() const {
+      return Stream ? &Facts : 0;
+    }
+
     void getAnalysisUsage(AnalysisUsage &AU) const {
-      AU.addRequired<FindUsedTypes>();
+      if (!Stream)
+        AU.addRequired<FindUsedTypes>();
     }
 
     virtual const char *getPassName() const {
@@ -84,14 +286,84 @@ namespace {
     }
 
     virtual bool runOnModule(Module &M);
+
+  private:
+    void scanBodies(Module &M, std::set<const Type*> &UT);
+    void numberGlobals(Module &M, SmallPtrSet<const Constant*, 32> &Visited);
+    void numberFunction(Function &F,
+                        SmallPtrSet<const Constant*, 32> &Visited);
   };
 
   char JsBackendNameAllUsedStructsAndMergeFunctions::ID = 0;
 
   /// JsWriter - This class is the main chunk of code that converts an LLVM
   /// module to a javascript translation unit.
+  ///
+  /// With -js-threads=N the functions are not printed as they are visited.
+  /// Instead, runOnFunction records the block order computed from LoopInfo,
+  /// numbers the anonymous values and reserves the line numbers of the
+  /// function, and batches of such pending functions are then rendered
+  /// concurrently into per-function buffers that are spliced into the output
+  /// in module order.  The output is identical to that of the serial writer.
+  ///
+  /// When writing an object file the writer produces the binary form of the
+  /// intertype stream described in JsBinaryFormat.h instead of JSON.
+  ///
+  /// With -js-codegen the writer is a code generator instead: it emits a
+  /// javascript module whose functions operate on a typed-array heap, see the
+  /// "Javascript code generator" section below.
+  ///
+  /// With -js-mem-init the global variables of the intertype are laid out in
+  /// a memory image, like the static data of the code generator, instead of
+  /// being printed as nested constants.  The image, and the static data of
+  /// the code generator, is embedded as base64 or written to a separate file.
+  ///
+  /// With -js-minify-names the locals and internal globals are given the
+  /// shortest names that JsNameMinifier hands out, and -js-name-map records
+  /// their original names for debugging.
+  ///
+  /// With -js-split the code generator writes the functions that do not run
+  /// at startup to separate chunks, see JsCodeSplitting.h, and leaves stubs
+  /// that load them in the module.
+  ///
+  /// The state of a function, its anonymous value numbers and its locals, is
+  /// dropped once the function is written out.  With -js-stream the body of
+  /// the function is released too, see JsStreamer, and the BodyFacts of the
+  /// namer stand for the bodies that are not in memory.
   class JsWriter : public FunctionPass {
-    formatted_raw_ostream &Out;
+    typedef std::vector<BasicBlock*> BlockList;
+
+    /// JsFunctionState - The state of the code generator while it prints one
+    /// function.  Every emission thread has its own.
+    struct JsFunctionState {
+      const JsRelooper *Relooper;
+      const JsFrameLayout *Frame;
+      bool UsesStack;
+      std::string Indent;
+      /// Locations - With -js-source-map, where the code of the instructions
+      /// with debug locations starts.
+      std::vector<JsSourceLocation> *Locations;
+    };
+
+    /// JsRelocation - A pointer in the static data that refers to an imported
+    /// global, and therefore has to be filled in when the module starts.
+    struct JsRelocation {
+      uint64_t Address;
+      const GlobalValue *Target;
+      int64_t Offset;
+    };
+
+    /// PendingFunction - A function whose emission has been deferred to the
+    /// next parallel batch.
+    struct PendingFunction {
+      Function *F;
+      BlockList Blocks;
+      unsigned FirstLine;
+      std::string Buffer;
+      std::vector<JsSourceLocation> Locations;
+    };
+
+    formatted_raw_ostream &FOut;
     IntrinsicLowering *IL;
     Mangler *Mang;
     LoopInfo *LI;
@@ -99,22 +371,87 @@ namespace {
     const MCAsmInfo* TAsm;
     MCContext *TCtx;
     const TargetData* TD;
+    const TargetData *TargetLayout;
+    const TypeTable *Types;
+    /// Facts - With -js-stream, the facts of the bodies gathered by the namer.
+    const BodyFacts *Facts;
+    /// Released - With -js-stream, the functions whose bodies have been
+    /// released, and the declarations that those bodies used.
+    SmallPtrSet<const Function*, 32> Released;
+    SmallPtrSet<const GlobalValue*, 32> ReleasedUses;
     std::map<const Type *, std::string> TypeNames;
+    sys::SmartRWMutex<true> TypeNamesLock;
+    DenseMap<const GlobalValue*, std::string> GlobalNames;
     std::set<Function*> intrinsicPrototypesAlreadyGenerated;
     std::set<const Argument*> ByValParams;
     unsigned FPCounter;
     unsigned LineNumber;
+    /// AnonValueNumbers - The numbers of the unnamed values of the functions
+    /// being emitted.  The numbering goes on from one function to the next,
+    /// but the entries are dropped once the function is written out.
     DenseMap<const Value*, unsigned> AnonValueNumbers;
     unsigned NextAnonValueNumber;
+    /// LocalRepresentatives - With -js-reuse-locals, the value whose local
+    /// holds each value of the code generator.  Filled in before a function
+    /// is emitted, like AnonValueNumbers.
+    DenseMap<const Value*, const Value*> LocalRepresentatives;
+    /// MinifiedNames - With -js-minify-names, the names of the internal
+    /// globals.
+    DenseMap<const Value*, std::string> MinifiedNames;
+    /// MinifiedLocals - With -js-minify-names, the names of the locals of the
+    /// functions being emitted.
+    DenseMap<const Value*, std::string> MinifiedLocals;
+    JsNameMinifier Minifier;
+    raw_fd_ostream *NameMap;
     bool initialized;
+    unsigned NumThreads;
+    std::vector<PendingFunction> Pending;
+    volatile sys::cas_flag NextPending;
+    /// LaidOutTypes - The types whose layout has been computed ahead of the
+    /// parallel emission.
+    SmallPtrSet<const Type*, 64> LaidOutTypes;
+
+    // State of the binary writer: the string pool, the types that are missing
+    // from the type table, and the number of bytes written so far.
+    bool Binary;
+    StringMap<unsigned> StringIDs;
+    std::vector<StringRef> Strings;
+    DenseMap<const Type*, unsigned> ExtraTypeIDs;
+    std::vector<const Type*> ExtraTypes;
+    uint64_t BinaryOffset;
+
+    // State of the code generator: the static data image and the addresses
+    // of the global variables in it, and the function tables of the
+    // signatures, padded to powers of two.
+    bool CodeGen;
+    DenseMap<const GlobalValue*, uint64_t> GlobalAddresses;
+    std::vector<unsigned char> StaticData;
+    std::vector<JsRelocation> Relocations;
+    uint64_t StackBase;
+    DenseMap<const Function*, unsigned> FunctionIndices;
+    std::map<std::string, std::vector<const Function*> > FunctionTables;
+    /// Partition - With -js-split, the chunks of the functions, computed when
+    /// the first function is emitted.
+    JsChunkPartition *Partition;
+    std::vector<raw_fd_ostream*> ChunkFiles;
+    JsSourceMap *SourceMap;
+    /// Profile - With -js-profile, the profile that guides the layout of the
+    /// blocks.
+    ProfileInfo *Profile;
 
   public:
     static char ID;
-    explicit JsWriter(formatted_raw_ostream &o)
-      : FunctionPass(ID), Out(o), IL(0), Mang(0), LI(0), 
-        TheModule(0), TAsm(0), TCtx(0), TD(0), LineNumber(0),
-        NextAnonValueNumber(0), initialized(false) {
+    JsWriter(formatted_raw_ostream &o, const TargetData *Layout,
+             const TypeTable *TT, const BodyFacts *Facts, bool Binary,
+             bool CodeGen)
+      : FunctionPass(ID), FOut(o), IL(0), Mang(0), LI(0),
+        TheModule(0), TAsm(0), TCtx(0), TD(0), TargetLayout(Layout),
+        Types(TT), Facts(Facts), LineNumber(0), NextAnonValueNumber(0),
+        NameMap(0), initialized(false), NumThreads(1),
+        NextPending(0), Binary(Binary), BinaryOffset(0), CodeGen(CodeGen),
+        StackBase(0), Partition(0), SourceMap(0), Profile(0) {
       initializeLoopInfoPass(*PassRegistry::getPassRegistry());
+      initializeProfileInfoAnalysisGroup(*PassRegistry::getPassRegistry());
       FPCounter = 0;
     }
 
@@ -122,7 +459,11 @@ namespace {
 
     void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addRequired<LoopInfo>();
-      AU.setPreservesAll();
+      if (CodeGen && (!JsSplit.empty() || !JsProfile.empty()))
+        AU.addRequired<ProfileInfo>();
+      // Lowering intrinsics only replaces calls with instructions.
+      AU.setPreservesCFG();
+      AU.addPreserved<ProfileInfo>();
     }
 
     virtual bool doInitialization(Module &M);
@@ -134,40 +475,199 @@ namespace {
        return false;
 
       LI = &getAnalysis<LoopInfo>();
+      if (CodeGen && !JsProfile.empty())
+        Profile = &getAnalysis<ProfileInfo>();
 
-      printFunction(F);
-      return false;
+      if (CodeGen && !JsSplit.empty() && !Partition)
+        splitModule(*F.getParent());
+      bool Changed = CodeGen && lowerIntrinsics(F);
+
+      BlockList Blocks;
+      computeBlockOrder(F, Blocks);
+
+      if (CodeGen && (JsReuseLocals || JsCoalescePhis))
+        colorLocals(Blocks);
+      if (JsMinifyNames)
+        minifyLocals(F, Blocks);
+
+      if (Binary) {
+        encodeFunction(F, Blocks);
+      } else if (NumThreads > 1) {
+        queueFunction(F, Blocks);
+        return Changed;
+      } else if (CodeGen && (Partition || SourceMap)) {
+        std::string Buffer;
+        raw_string_ostream OS(Buffer);
+        std::vector<JsSourceLocation> Locations;
+        printJsFunction(F, Blocks, OS, SourceMap ? &Locations : 0);
+        writeJsFunction(F, OS.str(), Locations);
+      } else {
+        printSeparator();
+        if (CodeGen)
+          printJsFunction(F, Blocks, FOut, 0);
+        else
+          printFunction(F, Blocks, LineNumber, FOut);
+      }
+      releaseFunction();
+      releaseBody(F);
+      return Changed;
     }
 
     virtual bool doFinalization(Module &M) {
-      Out << "]";
+      emitPendingFunctions();
+      if (Binary)
+        writeBinaryPools();
+      else if (CodeGen)
+        printJsEpilogue(M);
+      else
+        FOut << "]";
       // Free memory...
       delete IL;
       delete TD;
       delete Mang;
       delete TCtx;
       delete TAsm;
+      delete NameMap;
+      NameMap = 0;
+      delete Partition;
+      Partition = 0;
+      if (SourceMap)
+        SourceMap->finish();
+      delete SourceMap;
+      SourceMap = 0;
+      for (unsigned i = 0, e = ChunkFiles.size(); i != e; ++i)
+        delete ChunkFiles[i];
+      ChunkFiles.clear();
       TypeNames.clear();
+      GlobalNames.clear();
+      StringIDs.clear();
+      Strings.clear();
+      ExtraTypeIDs.clear();
+      ExtraTypes.clear();
+      GlobalAddresses.clear();
+      StaticData.clear();
+      Relocations.clear();
+      FunctionIndices.clear();
+      FunctionTables.clear();
+      MinifiedNames.clear();
+      LaidOutTypes.clear();
       ByValParams.clear();
       intrinsicPrototypesAlreadyGenerated.clear();
+      Released.clear();
+      ReleasedUses.clear();
       return false;
     }
 
-    void writeOperand(Value *Operand, bool Static = false);
+    void writeOperand(Value *Operand, raw_ostream &Out, bool Static = false);
+    void replaceFunction(const Function *F, const Function *NF);
 
   private :
-    void printFunction(Function &);
-    void printBasicBlock(BasicBlock *BB);
-    void printLoop(Loop *L);
+    void computeBlockOrder(Function &F, BlockList &Blocks);
+    void computeLoopBlockOrder(Loop *L, BlockList &Blocks);
+
+    void queueFunction(Function &F, BlockList &Blocks);
+    void releaseFunction();
+    void releaseBody(Function &F);
+    void recordReleasedUses(const Value *V,
+                            SmallPtrSet<const Constant*, 32> &Visited);
+    bool isJsImport(const GlobalValue *GV) const;
+    bool isJsDefinition(const Function *F) const;
+    void prepareOperand(const Value *V);
+    void emitPendingFunctions();
+    static void *emitPendingFunctionsThread(void *Arg);
+
+    void printSeparator();
+    void printTypeTable();
+    void printFunction(Function &F, const BlockList &Blocks, unsigned &LineNo,
+                       raw_ostream &Out);
+    void printBasicBlock(BasicBlock *BB, unsigned &LineNo, raw_ostream &Out);
 
     void printConstant(Constant *CPV, bool Static, raw_ostream &Out);
-    void printConstant(Constant *CPV, bool Static);
-    void printConstantArray(ConstantArray *CPA, bool Static);
-    void printConstantVector(ConstantVector *CV, bool Static);
+    void printConstantArray(ConstantArray *CPA, bool Static, raw_ostream &Out);
+    void printConstantVector(ConstantVector *CV, bool Static,
+                             raw_ostream &Out);
 
     void writeOperands(User::const_op_iterator OI,
-		       User::const_op_iterator OE);
-    void writeOperands(const Instruction &I);
+		       User::const_op_iterator OE, raw_ostream &Out);
+    void writeOperands(const Instruction &I, raw_ostream &Out);
+    void writeOffsetOperands(Value *Ptr, int64_t Offset, raw_ostream &Out);
+
+    void writeBinaryHeader();
+    void writeBinaryItem(unsigned Kind, StringRef Payload);
+    void writeBinaryPools();
+    void encodeGlobal(GlobalVariable *GV);
+    void encodeFunction(Function &F, const BlockList &Blocks);
+    void encodeOperand(Value *Operand, raw_ostream &Out);
+    void encodeOffsetOperands(Value *Ptr, int64_t Offset, raw_ostream &Out);
+    void encodeConstant(Constant *CPV, raw_ostream &Out);
+    unsigned getStringID(StringRef Str);
+    unsigned getBinaryTypeID(const Type *Ty);
+    bool getConstantOffset(const User *GEP, int64_t &Offset);
+
+    bool lowerIntrinsics(Function &F);
+    void colorLocals(const BlockList &Blocks);
+    void minifyGlobals(Module &M);
+    void minifyLocals(Function &F, const BlockList &Blocks);
+    std::string getUnminifiedName(const Value *V);
+    void prepareLayout(const Type *Ty);
+    void layoutGlobals(Module &M);
+    void layoutFunctionTables(Module &M);
+    void writeMemoryImageFile(size_t Size);
+    void printMemoryInitializer(Module &M);
+    void layoutConstant(const Constant *C, uint64_t Address);
+    void writeStaticBytes(uint64_t Address, uint64_t Value, unsigned Size);
+    bool evaluateAddress(const Constant *C, const GlobalValue *&Base,
+                         int64_t &Offset);
+    void printJsPreamble(raw_ostream &Out);
+    void printJsEpilogue(Module &M);
+    void splitModule(Module &M);
+    void writeJsFunction(const Function &F, StringRef Code,
+                         const std::vector<JsSourceLocation> &Locations);
+    void writeJsCode(StringRef Code,
+                     const std::vector<JsSourceLocation> *Locations);
+    void printJsChunkFunction(const Function &F, StringRef Code);
+    void printJsFunction(Function &F, const BlockList &Blocks,
+                         raw_ostream &Out,
+                         std::vector<JsSourceLocation> *Locations);
+    void addJsLocation(const Instruction &I, uint64_t Start,
+                       const JsFunctionState &S, raw_ostream &Out);
+    void printJsInstruction(Instruction &I, const JsFunctionState &S,
+                            raw_ostream &Out);
+    void printJsShape(const JsShape *Shape, JsFunctionState &S,
+                      raw_ostream &Out);
+    void printJsTerminator(TerminatorInst &I, const JsShape *Shape,
+                           JsFunctionState &S, raw_ostream &Out);
+    void printJsDispatch(const JsShape *Shape, JsFunctionState &S,
+                         raw_ostream &Out);
+    void printJsBranch(BasicBlock *From, const JsBranch &B,
+                       JsFunctionState &S, raw_ostream &Out);
+    void printJsConditional(BasicBlock *BB, const std::string &Cond,
+                            const JsBranch &True, const JsBranch &False,
+                            JsFunctionState &S, raw_ostream &Out);
+    void printJsSwitch(SwitchInst &SI, const JsShape *Shape,
+                       JsFunctionState &S, raw_ostream &Out);
+    void printJsCaseTree(BasicBlock *BB, const std::string &Cond,
+                         const std::vector<JsCaseRange> &Ranges,
+                         unsigned Begin, unsigned End, const JsShape *Shape,
+                         JsFunctionState &S, raw_ostream &Out);
+    void printJsCall(Instruction &I, const JsFunctionState &S,
+                     raw_ostream &Out);
+    void printJsMemIntrinsic(const MemIntrinsic &MI, const char *Indent,
+                             raw_ostream &Out);
+    std::string getJsName(const GlobalValue *GV);
+    std::string getJsValue(const Value *V);
+    std::string getJsConstant(const Constant *C);
+    std::string getJsExpr(const User *U, unsigned Opcode);
+    std::string getJsCast(unsigned Opcode, const Value *V, const Type *DstTy);
+    std::string getJsGEP(const User *U);
+    std::string getJsLoad(const Type *Ty, const std::string &Ptr,
+                          unsigned Offset, unsigned Align);
+    std::string getJsStore(const Type *Ty, const std::string &Ptr,
+                           unsigned Offset, unsigned Align,
+                           const std::string &Val);
+    void printJsAggregateStore(const Constant *C, const std::string &Ptr,
+                               unsigned Offset, unsigned Align,
+                               const char *Indent, raw_ostream &Out);
 
     // Converts an APFloat to a string via a double
     static inline std::string apfToStr(const APFloat& V) {
@@ -183,6 +683,13 @@ namespace {
       return Buffer;
     }
     
+    static Constant *getNullValue(const Type *Ty);
+    const std::string &getTypeName(const Type *Ty);
+    void writeType(const Type *Ty, raw_ostream &Out);
+    const std::string &getGlobalName(const GlobalValue *GV);
+    std::string getMangledName(const GlobalValue *GV);
+    unsigned getAnonValueNumber(const Value *V);
+    const Value *getLocalRepresentative(const Value *V) const;
     std::string GetValueName(const Value *Operand);
   };
 }
@@ -211,8 +718,48 @@ static std::string JsBEMangle(const std::string &S) {
 /// program.
 ///
 bool JsBackendNameAllUsedStructsAndMergeFunctions::runOnModule(Module &M) {
+  // Loop over all external functions and globals.  If we have two with
+  // identical names, merge them.  This comes first, so that the bodies read
+  // by scanBodies only see the merged globals.
+  bool Changed = false;
+  std::map<std::string, GlobalValue*> ExtSymbols;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E;) {
+    Function *GV = I++;
+    if (GV->isDeclaration() && GV->hasName()) {
+      std::pair<std::map<std::string, GlobalValue*>::iterator, bool> X
+        = ExtSymbols.insert(std::make_pair(GV->getName(), GV));
+      if (!X.second) {
+        // Found a conflict, replace this global with the previous one.
+        GlobalValue *OldGV = X.first->second;
+        GV->replaceAllUsesWith(ConstantExpr::getBitCast(OldGV, GV->getType()));
+        GV->eraseFromParent();
+        Changed = true;
+      }
+    }
+  }
+  // Do the same for globals.
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E;) {
+    GlobalVariable *GV = I++;
+    if (GV->isDeclaration() && GV->hasName()) {
+      std::pair<std::map<std::string, GlobalValue*>::iterator, bool> X
+        = ExtSymbols.insert(std::make_pair(GV->getName(), GV));
+      if (!X.second) {
+        // Found a conflict, replace this global with the previous one.
+        GlobalValue *OldGV = X.first->second;
+        GV->replaceAllUsesWith(ConstantExpr::getBitCast(OldGV, GV->getType()));
+        GV->eraseFromParent();
+        Changed = true;
+      }
+    }
+  }
+
   // Get a set of types that are used by the program...
-  std::set<const Type *> UT = getAnalysis<FindUsedTypes>().getTypes();
+  std::set<const Type *> UT;
+  if (Stream)
+    scanBodies(M, UT);
+  else
+    UT = getAnalysis<FindUsedTypes>().getTypes();
 
   // Loop over the module symbol table, removing types from UT that are
   // already named, and removing names for types that are not used.
@@ -240,7 +787,6 @@ bool JsBackendNameAllUsedStructsAndMergeFunctions::runOnModule(Module &M) {
   // UT now contains types that are not named.  Loop over it, naming
   // structure types.
   //
-  bool Changed = false;
   unsigned RenameCounter = 0;
   for (std::set<const Type *>::const_iterator I = UT.begin(), E = UT.end();
        I != E; ++I)
@@ -249,60 +795,243 @@ bool JsBackendNameAllUsedStructsAndMergeFunctions::runOnModule(Module &M) {
         ++RenameCounter;
       Changed = true;
     }
-      
-      
-  // Loop over all external functions and globals.  If we have two with
-  // identical names, merge them.
-  std::map<std::string, GlobalValue*> ExtSymbols;
-  for (Module::iterator I = M.begin(), E = M.end(); I != E;) {
-    Function *GV = I++;
-    if (GV->isDeclaration() && GV->hasName()) {
-      std::pair<std::map<std::string, GlobalValue*>::iterator, bool> X
-        = ExtSymbols.insert(std::make_pair(GV->getName(), GV));
-      if (!X.second) {
-        // Found a conflict, replace this global with the previous one.
-        GlobalValue *OldGV = X.first->second;
-        GV->replaceAllUsesWith(ConstantExpr::getBitCast(OldGV, GV->getType()));
-        GV->eraseFromParent();
-        Changed = true;
-      }
-    }
+
+  if (NumberTypes && !Stream) {
+    SmallPtrSet<const Constant*, 32> Visited;
+    numberGlobals(M, Visited);
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+      if (!F->isDeclaration())
+        numberFunction(*F, Visited);
   }
-  // Do the same for globals.
+
+  return Changed;
+}
+
+/// addUsedType - Add Ty and the types it contains to UT, as FindUsedTypes
+/// does.
+static void addUsedType(std::set<const Type*> &UT, const Type *Ty) {
+  if (!UT.insert(Ty).second)
+    return;
+  for (Type::subtype_iterator I = Ty->subtype_begin(), E = Ty->subtype_end();
+       I != E; ++I)
+    addUsedType(UT, *I);
+}
+
+/// addUsedValue - Add the types used by V to UT, as FindUsedTypes does.
+static void addUsedValue(std::set<const Type*> &UT, const Value *V) {
+  addUsedType(UT, V->getType());
+  if (const Constant *C = dyn_cast<Constant>(V))
+    if (!isa<GlobalValue>(C))
+      for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end();
+           OI != OE; ++OI)
+        addUsedValue(UT, *OI);
+}
+
+/// hasLiveUse - Return true if V is used by an instruction or a global, and
+/// not only by constants that nothing uses any more, like those left behind
+/// by the released bodies of -js-stream.
+static bool hasLiveUse(const Value *V) {
+  for (Value::const_use_iterator UI = V->use_begin(), E = V->use_end();
+       UI != E; ++UI)
+    if (!isa<Constant>(*UI) || isa<GlobalValue>(*UI) || hasLiveUse(*UI))
+      return true;
+  return false;
+}
+
+/// isUsedByGlobals - Return true if V is used by a global, directly or
+/// through constants.
+static bool isUsedByGlobals(const Value *V) {
+  for (Value::const_use_iterator UI = V->use_begin(), E = V->use_end();
+       UI != E; ++UI)
+    if (isa<GlobalValue>(*UI) ||
+        (isa<Constant>(*UI) && isUsedByGlobals(*UI)))
+      return true;
+  return false;
+}
+
+/// scanBodies - Read the body of every function, collect the types it uses
+/// into UT, number them and gather the BodyFacts, then release the body
+/// again.  This stands for FindUsedTypes, which only sees the bodies that are
+/// in memory.  The table is numbered in the same order as without
+/// -js-stream.
+void JsBackendNameAllUsedStructsAndMergeFunctions::scanBodies(
+                                        Module &M, std::set<const Type*> &UT) {
   for (Module::global_iterator I = M.global_begin(), E = M.global_end();
-       I != E;) {
-    GlobalVariable *GV = I++;
-    if (GV->isDeclaration() && GV->hasName()) {
-      std::pair<std::map<std::string, GlobalValue*>::iterator, bool> X
-        = ExtSymbols.insert(std::make_pair(GV->getName(), GV));
-      if (!X.second) {
-        // Found a conflict, replace this global with the previous one.
-        GlobalValue *OldGV = X.first->second;
-        GV->replaceAllUsesWith(ConstantExpr::getBitCast(OldGV, GV->getType()));
-        GV->eraseFromParent();
-        Changed = true;
-      }
+       I != E; ++I) {
+    addUsedType(UT, I->getType());
+    if (I->hasInitializer())
+      addUsedValue(UT, I->getInitializer());
+  }
+
+  SmallPtrSet<const Constant*, 32> Visited, FactsVisited;
+  if (NumberTypes)
+    numberGlobals(M, Visited);
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    addUsedType(UT, F->getType());
+    bool Lazy = F->isMaterializable();
+    std::string ErrInfo;
+    if (F->Materialize(&ErrInfo))
+      report_fatal_error("Cannot read the body of '" + F->getName() + "': " +
+                         ErrInfo);
+    if (F->isDeclaration())
+      continue;
+
+    for (inst_iterator II = inst_begin(F), IE = inst_end(F);
+         II != IE; ++II) {
+      addUsedType(UT, II->getType());
+      for (User::const_op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI)
+        addUsedValue(UT, *OI);
+    }
+    if (NumberTypes)
+      numberFunction(*F, Visited);
+    Facts.addFunction(*F, FactsVisited);
+
+    if (Lazy) {
+      // Releasing the body makes the function external.
+      GlobalValue::LinkageTypes Linkage = F->getLinkage();
+      F->Dematerialize();
+      F->setLinkage(Linkage);
     }
   }
-  
-  return Changed;
+
+  // The uses by the initializers of the globals and by aliases are still
+  // there.
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (isUsedByGlobals(F))
+      Facts.AddressTaken.insert(F);
 }
 
-void JsWriter::printConstantArray(ConstantArray *CPA, bool Static) {
+/// addFunction - Add the facts of the body of F.  The uses of the globals
+/// are only counted for a body that is read lazily, as the uses by the other
+/// bodies stay in the use lists.
+void BodyFacts::addFunction(const Function &F,
+                            SmallPtrSet<const Constant*, 32> &Visited) {
+  bool Legalize = JsCodeGen && JsLegalizeI64;
+  bool CountUses = F.isDematerializable();
+  for (const_inst_iterator II = inst_begin(F), IE = inst_end(F); II != IE;
+       ++II) {
+    const Instruction *I = &*II;
+    if (CountUses)
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+           OI != OE; ++OI)
+        if (const GlobalValue *GV = dyn_cast<GlobalValue>(*OI))
+          ++Uses[GV];
 
-  // As a special case, print the array as a string if it is an array of
-  // ubytes or an array of sbytes with positive values.
-  //
+    ImmutableCallSite CS(I);
+    if (!CS) {
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+           OI != OE; ++OI)
+        addAddressTaken(*OI, Visited);
+      continue;
+    }
+    for (ImmutableCallSite::arg_iterator AI = CS.arg_begin(),
+         AE = CS.arg_end(); AI != AE; ++AI)
+      addAddressTaken(*AI, Visited);
+
+    // As in layoutFunctionTables, the calls of functions, even through a
+    // bitcast, are direct.  Calling a function through a bitcast takes its
+    // address, unless the i64 legalization folds the bitcast away.
+    const Value *Called = CS.getCalledValue();
+    const FunctionType *FTy = cast<FunctionType>(
+      cast<PointerType>(Called->getType())->getElementType());
+    const Value *Callee = Called->stripPointerCasts();
+    if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(Callee))
+      if (const GlobalValue *GV = GA->resolveAliasedGlobal(false))
+        Callee = GV;
+    const Function *CF = dyn_cast<Function>(Callee);
+    if (!CF && !isa<InlineAsm>(Callee))
+      IndirectCalls.insert(FTy);
+    if (Called != Callee &&
+        !(CF && Legalize && getJsLegalI64Type(FTy) == CF->getFunctionType()))
+      addAddressTaken(Called, Visited);
+  }
+}
+
+/// addAddressTaken - Record the functions that V refers to as address taken.
+void BodyFacts::addAddressTaken(const Value *V,
+                                SmallPtrSet<const Constant*, 32> &Visited) {
+  if (const Function *F = dyn_cast<Function>(V)) {
+    AddressTaken.insert(F);
+    return;
+  }
+  const Constant *C = dyn_cast<Constant>(V);
+  if (!C || isa<GlobalValue>(C) || !Visited.insert(C))
+    return;
+  for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end();
+       OI != OE; ++OI)
+    addAddressTaken(*OI, Visited);
+}
+
+/// addValue - Add the type of V to the table, along with the types of the
+/// operands that are printed for it if it is a constant.
+void TypeTable::addValue(const Value *V,
+                         SmallPtrSet<const Constant*, 32> &Visited) {
+  addType(V->getType());
+  const Constant *C = dyn_cast<Constant>(V);
+  if (!C || isa<GlobalValue>(C) || !Visited.insert(C))
+    return;
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C))
+    if (CE->getOpcode() == Instruction::GetElementPtr)
+      addType(Type::getInt32Ty(C->getContext()));
+  for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end();
+       OI != OE; ++OI)
+    addValue(*OI, Visited);
+}
+
+/// numberGlobals - Number the types of the global variables that the writer
+/// prints.  The types of the functions are numbered after them, by
+/// numberFunction.  Walking the module in order, rather than using the set
+/// computed by FindUsedTypes, keeps the numbering stable from one run to the
+/// next.
+void JsBackendNameAllUsedStructsAndMergeFunctions::numberGlobals(
+                      Module &M, SmallPtrSet<const Constant*, 32> &Visited) {
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    Types.addType(I->getType());
+    Types.addValue(I->getInitializer(), Visited);
+  }
+}
+
+/// numberFunction - Number the types that the writer prints for F: those of
+/// its return value and of the operands of its instructions.
+void JsBackendNameAllUsedStructsAndMergeFunctions::numberFunction(
+                      Function &F, SmallPtrSet<const Constant*, 32> &Visited) {
+  Types.addType(F.getReturnType());
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB)
+    for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+         ++II) {
+      if (isa<TerminatorInst>(II))
+        Types.addType(II->getType());
+      // Folded getelementptrs have an i32 offset operand.
+      if (isa<GetElementPtrInst>(II))
+        Types.addType(Type::getInt32Ty(F.getContext()));
+      for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI)
+        Types.addValue(*OI, Visited);
+    }
+}
+
+/// isCString - Return true if the array should be printed as a string: if it
+/// is an array of bytes that ends with a null char, as automatically added by
+/// C.
+static bool isCString(ConstantArray *CPA) {
   const Type *ETy = CPA->getType()->getElementType();
-  bool isString = (ETy == Type::getInt8Ty(CPA->getContext()) ||
-                   ETy == Type::getInt8Ty(CPA->getContext()));
+  if (ETy != Type::getInt8Ty(CPA->getContext()))
+    return false;
+  return CPA->getNumOperands() != 0 &&
+         cast<Constant>(*(CPA->op_end()-1))->isNullValue();
+}
 
-  // Make sure the last character is a null char, as automatically added by C
-  if (isString && (CPA->getNumOperands() == 0 ||
-                   !cast<Constant>(*(CPA->op_end()-1))->isNullValue()))
-    isString = false;
+void JsWriter::printConstantArray(ConstantArray *CPA, bool Static,
+                                  raw_ostream &Out) {
 
-  if (isString) {
+  // As a special case, print the array as a string if it is an array of
+  // ubytes or an array of sbytes with positive values.
+  //
+  if (isCString(CPA)) {
     Out << '\"';
     // Keep track of whether the last number was a hexadecimal escape
     bool LastWasHex = false;
@@ -347,23 +1076,24 @@ void JsWriter::printConstantArray(ConstantArray *CPA, bool Static) {
   } 
   Out << '[';
   if (CPA->getNumOperands()) {
-    printConstant(cast<Constant>(CPA->getOperand(0)), Static);
+    printConstant(cast<Constant>(CPA->getOperand(0)), Static, Out);
     for (unsigned i = 1, e = CPA->getNumOperands(); i != e; ++i) {
       Out << ", ";
-      printConstant(cast<Constant>(CPA->getOperand(i)), Static);
+      printConstant(cast<Constant>(CPA->getOperand(i)), Static, Out);
     }
   }
   Out << "]";
 }
 
-void JsWriter::printConstantVector(ConstantVector *CP, bool Static) {
+void JsWriter::printConstantVector(ConstantVector *CP, bool Static,
+                                   raw_ostream &Out) {
   Out << '[';
   if (CP->getNumOperands()) {
     Out << ' ';
-    printConstant(cast<Constant>(CP->getOperand(0)), Static);
+    printConstant(cast<Constant>(CP->getOperand(0)), Static, Out);
     for (unsigned i = 1, e = CP->getNumOperands(); i != e; ++i) {
       Out << ", ";
-      printConstant(cast<Constant>(CP->getOperand(i)), Static);
+      printConstant(cast<Constant>(CP->getOperand(i)), Static, Out);
     }
   }
   Out << " ]";
@@ -390,7 +1120,7 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
         // Make sure we really sext from bool here by subtracting from 0
         Out << "0-";
       }
-      printConstant(CE->getOperand(0), Static);
+      printConstant(CE->getOperand(0), Static, Out);
       if (CE->getType() == Type::getInt1Ty(CPV->getContext()) &&
           (CE->getOpcode() == Instruction::Trunc ||
            CE->getOpcode() == Instruction::FPToUI ||
@@ -405,22 +1135,35 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
     case Instruction::GetElementPtr:
       // If there are no indices, just print out the pointer.
       if (CE->getNumOperands() <= 1) {
-	writeOperand(CE->getOperand(0));
+	writeOperand(CE->getOperand(0), Out);
 	return;
       }
 
+      // Constant indices are folded into a byte offset from the pointer.
+      int64_t Offset;
+      if (getConstantOffset(CE, Offset)) {
+        if (!Offset) {
+          writeOperand(CE->getOperand(0), Out);
+          return;
+        }
+        Out << "{ \"intertype\": \"offset\", \"operands\": ";
+        writeOffsetOperands(CE->getOperand(0), Offset, Out);
+        Out << "}";
+        return;
+      }
+
       Out << "{ \"intertype\": \"getelementptr\", ";
       Out << "\"operands\": ";
-      writeOperands(CE->op_begin(), CE->op_end());
+      writeOperands(CE->op_begin(), CE->op_end(), Out);
       Out << "}";
       return;
     case Instruction::Select:
       Out << "\"(";
-      printConstant(CE->getOperand(0), Static);
+      printConstant(CE->getOperand(0), Static, Out);
       Out << '?';
-      printConstant(CE->getOperand(1), Static);
+      printConstant(CE->getOperand(1), Static, Out);
       Out << ':';
-      printConstant(CE->getOperand(2), Static);
+      printConstant(CE->getOperand(2), Static, Out);
       Out << ")\"";
       return;
     case Instruction::Add:
@@ -444,7 +1187,7 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
     case Instruction::AShr:
     {
       Out << "\"(";
-      printConstant(CE->getOperand(0), Static);
+      printConstant(CE->getOperand(0), Static, Out);
       switch (CE->getOpcode()) {
       case Instruction::Add:
       case Instruction::FAdd: Out << " + "; break;
@@ -481,7 +1224,7 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
         break;
       default: llvm_unreachable("Illegal opcode here!");
       }
-      printConstant(CE->getOperand(1), Static);
+      printConstant(CE->getOperand(1), Static, Out);
       Out << ")\"";
       return;
     }
@@ -511,9 +1254,9 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
         case FCmpInst::FCMP_OGE: op = "oge"; break;
         }
         Out << "llvm_fcmp_" << op << "(";
-        printConstant(CE->getOperand(0), Static);
+        printConstant(CE->getOperand(0), Static, Out);
         Out << ", ";
-        printConstant(CE->getOperand(1), Static);
+        printConstant(CE->getOperand(1), Static, Out);
         Out << ")";
       }
       Out << ")\"";
@@ -572,18 +1315,18 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
 
   case Type::ArrayTyID:
     if (ConstantArray *CA = dyn_cast<ConstantArray>(CPV)) {
-      printConstantArray(CA, Static);
+      printConstantArray(CA, Static, Out);
     } else {
       assert(isa<ConstantAggregateZero>(CPV) || isa<UndefValue>(CPV));
       const ArrayType *AT = cast<ArrayType>(CPV->getType());
       Out << '[';
       if (AT->getNumElements()) {
         Out << ' ';
-        Constant *CZ = Constant::getNullValue(AT->getElementType());
-        printConstant(CZ, Static);
+        Constant *CZ = getNullValue(AT->getElementType());
+        printConstant(CZ, Static, Out);
         for (unsigned i = 1, e = AT->getNumElements(); i != e; ++i) {
           Out << ", ";
-          printConstant(CZ, Static);
+          printConstant(CZ, Static, Out);
         }
       }
       Out << " ]";
@@ -592,16 +1335,16 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
 
   case Type::VectorTyID:
     if (ConstantVector *CV = dyn_cast<ConstantVector>(CPV)) {
-      printConstantVector(CV, Static);
+      printConstantVector(CV, Static, Out);
     } else {
       assert(isa<ConstantAggregateZero>(CPV) || isa<UndefValue>(CPV));
       const VectorType *VT = cast<VectorType>(CPV->getType());
       Out << "[ ";
-      Constant *CZ = Constant::getNullValue(VT->getElementType());
-      printConstant(CZ, Static);
+      Constant *CZ = getNullValue(VT->getElementType());
+      printConstant(CZ, Static, Out);
       for (unsigned i = 1, e = VT->getNumElements(); i != e; ++i) {
         Out << ", ";
-        printConstant(CZ, Static);
+        printConstant(CZ, Static, Out);
       }
       Out << " ]";
     }
@@ -613,10 +1356,10 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
       Out << '[';
       if (ST->getNumElements()) {
         Out << ' ';
-        printConstant(Constant::getNullValue(ST->getElementType(0)), Static);
+        printConstant(getNullValue(ST->getElementType(0)), Static, Out);
         for (unsigned i = 1, e = ST->getNumElements(); i != e; ++i) {
           Out << ", ";
-          printConstant(Constant::getNullValue(ST->getElementType(i)), Static);
+          printConstant(getNullValue(ST->getElementType(i)), Static, Out);
         }
       }
       Out << " ]";
@@ -624,10 +1367,10 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
     }
     Out << '[';
     if (CPV->getNumOperands()) {
-      printConstant(cast<Constant>(CPV->getOperand(0)), Static);
+      printConstant(cast<Constant>(CPV->getOperand(0)), Static, Out);
       for (unsigned i = 1, e = CPV->getNumOperands(); i != e; ++i) {
 	Out << ", ";
-	printConstant(cast<Constant>(CPV->getOperand(i)), Static);
+	printConstant(cast<Constant>(CPV->getOperand(i)), Static, Out);
       }
     }
     Out << "]";
@@ -638,7 +1381,7 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
       Out << "null";
       break;
     } else if (GlobalValue *GV = dyn_cast<GlobalValue>(CPV)) {
-      writeOperand(GV, Static);
+      writeOperand(GV, Out, Static);
       break;
     }
   // FALL THROUGH
@@ -650,28 +1393,108 @@ void JsWriter::printConstant(Constant *CPV, bool Static, raw_ostream &Out) {
   }
 }
 
-// printConstant - The LLVM Constant to C Constant converter.
-void inline JsWriter::printConstant(Constant *CPV, bool Static) {
-  printConstant(CPV, Static, Out);
+/// getNullValue - Return the null value of the given type.  This may be called
+/// concurrently by the emission threads, so the constant is created under
+/// JsConstantsLock.
+Constant *JsWriter::getNullValue(const Type *Ty) {
+  sys::SmartScopedLock<true> Guard(*JsConstantsLock);
+  return Constant::getNullValue(Ty);
 }
 
-std::string JsWriter::GetValueName(const Value *Operand) {
+/// getTypeName - Return the description of the given type, caching it in
+/// TypeNames.
+const std::string &JsWriter::getTypeName(const Type *Ty) {
+  {
+    sys::SmartScopedReader<true> Guard(TypeNamesLock);
+    std::map<const Type *, std::string>::const_iterator I = TypeNames.find(Ty);
+    if (I != TypeNames.end())
+      return I->second;
+  }
+  sys::SmartScopedWriter<true> Guard(TypeNamesLock);
+  std::string &Name = TypeNames[Ty];
+  if (Name.empty())
+    Name = Ty->getDescription();
+  return Name;
+}
+
+/// writeType - Output the given type, either as its index in the type table
+/// or inline as a string.  The table covers every type the writer prints.
+void JsWriter::writeType(const Type *Ty, raw_ostream &Out) {
+  if (!Types) {
+    Out << '"' << getTypeName(Ty) << '"';
+    return;
+  }
+  DenseMap<const Type*, unsigned>::const_iterator I = Types->IDs.find(Ty);
+  assert(I != Types->IDs.end() && "Type missing from the type table!");
+  Out << I->second;
+}
+
+/// getGlobalName - Return the mangled name of the given global, caching it in
+/// GlobalNames.  The names of all globals that a function refers to are
+/// computed before it is emitted in parallel, so that the emission threads
+/// only ever read GlobalNames.
+const std::string &JsWriter::getGlobalName(const GlobalValue *GV) {
+  DenseMap<const GlobalValue*, std::string>::iterator I = GlobalNames.find(GV);
+  if (I != GlobalNames.end())
+    return I->second;
+
+  DenseMap<const Value*, std::string>::iterator M = MinifiedNames.find(GV);
+  if (M != MinifiedNames.end())
+    return GlobalNames[GV] = M->second;
+  return GlobalNames[GV] = getMangledName(GV);
+}
+
+/// getMangledName - Return the name of the given global as it is written
+/// when it is not minified.
+std::string JsWriter::getMangledName(const GlobalValue *GV) {
   // Mangle globals with the standard mangler interface for LLC compatibility.
-  if (const GlobalValue *GV = dyn_cast<GlobalValue>(Operand)) {
-    SmallString<128> Str;
-    Mang->getNameWithPrefix(Str, GV, false);
-    return JsBEMangle(Str.str().str());
+  SmallString<128> Str;
+  Mang->getNameWithPrefix(Str, GV, false);
+  return JsBEMangle(Str.str().str());
+}
+
+/// getAnonValueNumber - Return the number of the given unnamed value, assigning
+/// the next free one if it has none yet.  Looking up a value that is already
+/// numbered does not modify AnonValueNumbers.
+unsigned JsWriter::getAnonValueNumber(const Value *V) {
+  std::pair<DenseMapIterator<const Value*, unsigned>, bool> Lookup = AnonValueNumbers.insert(std::pair<const Value*, unsigned>(V, NextAnonValueNumber));
+  if(Lookup.second) {
+    NextAnonValueNumber++;
   }
-    
+  return Lookup.first->second;
+}
+
+/// getLocalRepresentative - Return the value whose local holds V, which is V
+/// itself unless locals are reused.
+const Value *JsWriter::getLocalRepresentative(const Value *V) const {
+  if (LocalRepresentatives.empty())
+    return V;
+  DenseMap<const Value*, const Value*>::const_iterator I =
+    LocalRepresentatives.find(V);
+  return I == LocalRepresentatives.end() ? V : I->second;
+}
+
+std::string JsWriter::GetValueName(const Value *Operand) {
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(Operand))
+    return getGlobalName(GV);
+
+  Operand = getLocalRepresentative(Operand);
+  if (!MinifiedLocals.empty()) {
+    DenseMap<const Value*, std::string>::const_iterator I =
+      MinifiedLocals.find(Operand);
+    if (I != MinifiedLocals.end())
+      return I->second;
+  }
+  return getUnminifiedName(Operand);
+}
+
+/// getUnminifiedName - Return the name of the given local as it is written
+/// when it is not minified.
+std::string JsWriter::getUnminifiedName(const Value *Operand) {
   std::string Name = Operand->getName();
     
   if (Name.empty()) { // Assign unique names to local temporaries.
-    std::pair<DenseMapIterator<const Value*, unsigned>, bool> Lookup = AnonValueNumbers.insert(std::pair<const Value*, unsigned>(Operand, NextAnonValueNumber));
-    if(Lookup.second) {
-      NextAnonValueNumber++;
-    }
-    unsigned &No = Lookup.first->second;
-    Name = utostr(No);
+    Name = utostr(getAnonValueNumber(Operand));
   }
     
   std::string VarName;
@@ -693,21 +1516,119 @@ std::string JsWriter::GetValueName(const Value *Operand) {
   return "v" + VarName;
 }
 
+/// minifyGlobals - Give the internal globals of the module the shortest names,
+/// the most used first, and keep the names of the other globals from being
+/// handed out.  Optionally, open the name map and record the names in it.
+void JsWriter::minifyGlobals(Module &M) {
+  if (!JsNameMap.empty()) {
+    std::string Error;
+    NameMap = new raw_fd_ostream(JsNameMap.c_str(), Error);
+    if (!Error.empty())
+      report_fatal_error("Cannot open the javascript name map '" + JsNameMap +
+                         "': " + Error);
+  }
+
+  std::vector<const GlobalValue*> Globals;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    Globals.push_back(F);
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    Globals.push_back(I);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    Globals.push_back(I);
+
+  // The code generator prefixes the names of the other globals with '_'.
+  if (CodeGen)
+    Minifier.reserveUnderscore();
+  std::vector<std::pair<unsigned, const Value*> > Counts;
+  for (unsigned i = 0, e = Globals.size(); i != e; ++i) {
+    const GlobalValue *GV = Globals[i];
+    // The code generator refers to global variables by their addresses.
+    if (CodeGen && !isa<Function>(GV))
+      continue;
+    if (GV->hasLocalLinkage())
+      Counts.push_back(std::make_pair(GV->getNumUses() +
+                                        (Facts ? Facts->Uses.lookup(GV) : 0),
+                                      (const Value*)GV));
+    else if (!CodeGen)
+      Minifier.reserve(getMangledName(GV));
+  }
+
+  std::vector<std::string> Names;
+  Minifier.assignNames(Counts, Names);
+  for (unsigned i = 0, e = Counts.size(); i != e; ++i) {
+    const GlobalValue *GV = cast<GlobalValue>(Counts[i].second);
+    MinifiedNames[GV] = Names[i];
+    // Locals never take the names of globals.
+    Minifier.reserve(Names[i]);
+    if (NameMap)
+      *NameMap << "global " << Names[i] << " " << getMangledName(GV) << "\n";
+  }
+}
+
+/// minifyLocals - Give the arguments and local values of F the shortest names,
+/// the most used first.  Values that share a local are counted together.
+void JsWriter::minifyLocals(Function &F, const BlockList &Blocks) {
+  std::vector<std::pair<unsigned, const Value*> > Counts;
+  DenseMap<const Value*, unsigned> Indices;
+  SmallVector<const Value*, 8> Uses;
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    Uses.push_back(AI);
+  for (BlockList::const_iterator BI = Blocks.begin(), BE = Blocks.end();
+       BI != BE; ++BI)
+    for (BasicBlock::iterator II = (*BI)->begin(), IE = (*BI)->end();
+         II != IE; ++II) {
+      // The code generator names the values that it defines, the intertype
+      // every instruction but the terminators.
+      if (CodeGen ? !II->getType()->isVoidTy() : !isa<TerminatorInst>(II))
+        Uses.push_back(II);
+      for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI)
+        if (isa<Instruction>(*OI) || isa<Argument>(*OI))
+          Uses.push_back(*OI);
+
+      for (unsigned i = 0, e = Uses.size(); i != e; ++i) {
+        const Value *V = getLocalRepresentative(Uses[i]);
+        std::pair<DenseMap<const Value*, unsigned>::iterator, bool> Entry =
+          Indices.insert(std::make_pair(V, (unsigned)Counts.size()));
+        if (Entry.second)
+          Counts.push_back(std::make_pair(0U, V));
+        ++Counts[Entry.first->second].first;
+      }
+      Uses.clear();
+    }
+
+  std::vector<std::string> Names;
+  Minifier.assignNames(Counts, Names);
+  for (unsigned i = 0, e = Counts.size(); i != e; ++i) {
+    const Value *V = Counts[i].second;
+    if (NameMap)
+      *NameMap << "local " << GetValueName(&F) << " " << Names[i] << " "
+               << getUnminifiedName(V) << "\n";
+    MinifiedLocals[V] = Names[i];
+  }
+}
+
 // writeOperands - Outputs a javascript array of operand objects for the
 // specified Instruction.
-void JsWriter::writeOperands(User::const_op_iterator OI, User::const_op_iterator OE) {
+void JsWriter::writeOperands(User::const_op_iterator OI,
+                             User::const_op_iterator OE, raw_ostream &Out) {
   Out << "[";
   if(OI != OE) {
     Out << "{ \"value\": ";
-    writeOperand(*OI);
-    Out << ", \"type\": \"";
-    Out << OI->get()->getType()->getDescription() << "\" }";
+    writeOperand(*OI, Out);
+    Out << ", \"type\": ";
+    writeType(OI->get()->getType(), Out);
+    Out << " }";
     ++OI;
     for(; OI != OE; ++OI) {
       Out << ", { \"value\": ";
-      writeOperand(*OI);
-      Out << ", \"type\": \"";
-      Out << OI->get()->getType()->getDescription() << "\" }";
+      writeOperand(*OI, Out);
+      Out << ", \"type\": ";
+      writeType(OI->get()->getType(), Out);
+      Out << " }";
     }
   }
   Out << "]";
@@ -715,16 +1636,45 @@ void JsWriter::writeOperands(User::const_op_iterator OI, User::const_op_iterator
 
 // writeOperands - Outputs a javascript array of operand objects for the
 // specified Instruction.
-void JsWriter::writeOperands(const Instruction &I) {
-  writeOperands(I.op_begin(), I.op_end());
+void JsWriter::writeOperands(const Instruction &I, raw_ostream &Out) {
+  writeOperands(I.op_begin(), I.op_end(), Out);
+}
+
+// writeOffsetOperands - Outputs the operands of a folded getelementptr: the
+// pointer and the i32 byte offset from it.
+void JsWriter::writeOffsetOperands(Value *Ptr, int64_t Offset,
+                                   raw_ostream &Out) {
+  Out << "[{ \"value\": ";
+  writeOperand(Ptr, Out);
+  Out << ", \"type\": ";
+  writeType(Ptr->getType(), Out);
+  Out << " }, { \"value\": " << Offset << ", \"type\": ";
+  writeType(Type::getInt32Ty(Ptr->getContext()), Out);
+  Out << " }]";
+}
+
+/// getConstantOffset - If all the indices of the getelementptr GEP are
+/// constant, compute the byte offset that they add to its pointer, which is
+/// how the writer prints it.
+bool JsWriter::getConstantOffset(const User *GEP, int64_t &Offset) {
+  SmallVector<Value*, 8> Indices;
+  for (User::const_op_iterator OI = GEP->op_begin() + 1, OE = GEP->op_end();
+       OI != OE; ++OI) {
+    if (!isa<ConstantInt>(*OI))
+      return false;
+    Indices.push_back(*OI);
+  }
+  Offset = TD->getIndexedOffset(GEP->getOperand(0)->getType(),
+                                Indices.data(), Indices.size());
+  return true;
 }
 
 // writeOperand - Outputs a javascript object that specifies the given Operand.
-void JsWriter::writeOperand(Value *Operand, bool Static) {
+void JsWriter::writeOperand(Value *Operand, raw_ostream &Out, bool Static) {
   Constant* CPV = dyn_cast<Constant>(Operand);
 
   if (CPV && !isa<GlobalValue>(CPV)) {
-    printConstant(CPV, Static);
+    printConstant(CPV, Static, Out);
   } else {
     Out << "\"" << GetValueName(Operand) << "\"";
   }
@@ -736,14 +1686,68 @@ bool JsWriter::doInitialization(Module &M) {
   // Initialize
   TheModule = &M;
 
-  TD = new TargetData(&M);
+  // The types of a module that has a data layout were laid out by its front
+  // end, so that layout is kept.  Other modules use the javascript layout.
+  if (M.getDataLayout().empty())
+    TD = new TargetData(*TargetLayout);
+  else
+    TD = new TargetData(&M);
   IL = new IntrinsicLowering(*TD);
   IL->AddPrototypes(M);
 
   TAsm = new JsBEMCAsmInfo();
   TCtx = new MCContext(*TAsm, NULL);
   Mang = new Mangler(*TCtx, *TD);
-  Out << "[";
+
+  if (JsMinifyNames)
+    minifyGlobals(M);
+
+  // Parallel emission needs the locks of LLVM to be enabled.  Fall back to the
+  // serial writer if that is not possible.
+  NumThreads = JsThreads;
+  if (NumThreads > 1 && !llvm_start_multithreaded())
+    NumThreads = 1;
+  // The binary writer interns strings as it goes, so it is always serial.
+  if (Binary)
+    NumThreads = 1;
+
+  if (CodeGen) {
+    if (TD->getPointerSize() != 4)
+      report_fatal_error("The javascript code generator requires a data "
+                         "layout with 32-bit pointers");
+    layoutGlobals(M);
+    if (!JsSourceMapFile.empty()) {
+      std::string Error;
+      SourceMap = new JsSourceMap(JsSourceMapFile.c_str(), Error);
+      if (!Error.empty())
+        report_fatal_error("Cannot open the javascript source map '" +
+                           JsSourceMapFile + "': " + Error);
+    }
+    std::string Preamble;
+    raw_string_ostream OS(Preamble);
+    printJsPreamble(OS);
+    writeJsCode(OS.str(), 0);
+    return false;
+  }
+
+  if (Binary) {
+    writeBinaryHeader();
+    for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+         I != E; ++I)
+      if (!I->isDeclaration() &&
+          (I->hasLocalLinkage() || I->hasHiddenVisibility()))
+        encodeGlobal(I);
+    return false;
+  }
+
+  FOut << "[";
+  if (Types)
+    printTypeTable();
+  if (JsMemInit) {
+    layoutGlobals(M);
+    printMemoryInitializer(M);
+    return false;
+  }
   if(M.global_empty()) {
     return false;
   }
@@ -751,14 +1755,16 @@ bool JsWriter::doInitialization(Module &M) {
   for(; I != E; ++I) {
     if (!I->isDeclaration() &&
 	(I->hasLocalLinkage() || I->hasHiddenVisibility())) {
-      Out << "{ \"ident\": \"" << GetValueName(I);
-      Out << "\", \"intertype\": \"globalVariable\", ";
-      Out << "\"lineNum\": " << LineNumber++ << ", ";
-      Out << "\"type\": \"" << I->getType()->getDescription() << "\", ";
-      Out << "\"value\": { \"text\": ";
-      writeOperand(I->getInitializer(), true);
-      Out << " }}";
-      initialized = true;
+      printSeparator();
+      FOut << "{ \"ident\": \"" << GetValueName(I);
+      FOut << "\", \"intertype\": \"globalVariable\", ";
+      FOut << "\"lineNum\": " << LineNumber++ << ", ";
+      FOut << "\"type\": ";
+      writeType(I->getType(), FOut);
+      FOut << ", ";
+      FOut << "\"value\": { \"text\": ";
+      writeOperand(I->getInitializer(), FOut, true);
+      FOut << " }}";
       ++I;
       break;
     }
@@ -766,23 +1772,266 @@ bool JsWriter::doInitialization(Module &M) {
   for(; I != E; ++I) {
     if (!I->isDeclaration() &&
 	(I->hasLocalLinkage() || I->hasHiddenVisibility())) {
-      writeOperand(I->getInitializer(), true);
+      writeOperand(I->getInitializer(), FOut, true);
     }
   }
   return false;
 }
 
-void JsWriter::printFunction(Function &F) {
-  if(initialized) {
-    Out << ",\n";
-  } else {
-    initialized = true;
+/// computeBlockOrder - Compute the order in which the basic blocks of F are
+/// emitted: the blocks of each outermost loop are grouped together at the
+/// position of its header.
+void JsWriter::computeBlockOrder(Function &F, BlockList &Blocks) {
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    if (Loop *L = LI->getLoopFor(BB)) {
+      if (L->getHeader() == BB && L->getParentLoop() == 0)
+        computeLoopBlockOrder(L, Blocks);
+    } else {
+      Blocks.push_back(BB);
+    }
   }
-  Out << "{ \"ident\": \"" << GetValueName(&F) << "\", ";
-  Out << "\"intertype\": \"function\", \"lineNum\": " << LineNumber++;
-  Out << ", \"params\": [";
-  if(!F.arg_empty()) {
-    Function::const_arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+}
+
+void JsWriter::computeLoopBlockOrder(Loop *L, BlockList &Blocks) {
+  for (unsigned i = 0, e = L->getBlocks().size(); i != e; ++i) {
+    BasicBlock *BB = L->getBlocks()[i];
+    Loop *BBLoop = LI->getLoopFor(BB);
+    if (BBLoop == L)
+      Blocks.push_back(BB);
+    else if (BB == BBLoop->getHeader() && BBLoop->getParentLoop() == L)
+      computeLoopBlockOrder(BBLoop, Blocks);
+  }
+}
+
+/// queueFunction - Defer the emission of F to the next parallel batch.  All
+/// the state that is shared between functions (the anonymous value numbers,
+/// the global names and the line numbers) is assigned here, in module order,
+/// so that the batch can be rendered without any further writes to it.
+void JsWriter::queueFunction(Function &F, BlockList &Blocks) {
+  Pending.push_back(PendingFunction());
+  PendingFunction &P = Pending.back();
+  P.F = &F;
+  P.Blocks.swap(Blocks);
+  P.FirstLine = LineNumber++;
+
+  getGlobalName(&F);
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    prepareOperand(AI);
+  for (BlockList::iterator BI = P.Blocks.begin(), BE = P.Blocks.end();
+       BI != BE; ++BI) {
+    for (BasicBlock::iterator II = (*BI)->begin(), IE = (*BI)->end();
+         II != IE; ++II, ++LineNumber) {
+      // The code generator names the values that it defines, in order, and
+      // no other local values.
+      if (CodeGen ? !II->getType()->isVoidTy() : !isa<TerminatorInst>(II))
+        prepareOperand(II);
+      for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI)
+        if (!CodeGen || isa<Constant>(*OI))
+          prepareOperand(*OI);
+      prepareLayout(II->getType());
+      for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI)
+        prepareLayout(OI->get()->getType());
+    }
+  }
+
+  if (Pending.size() >= NumThreads * 64)
+    emitPendingFunctions();
+}
+
+/// prepareOperand - Assign the name that GetValueName will return for V, and
+/// for the globals referenced by V if it is a constant.
+void JsWriter::prepareOperand(const Value *V) {
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+    getGlobalName(GV);
+  } else if (isa<Constant>(V)) {
+    // Folding the constant getelementptrs needs the layouts of their types.
+    const User *U = cast<User>(V);
+    for (User::const_op_iterator OI = U->op_begin(), OE = U->op_end();
+         OI != OE; ++OI) {
+      prepareLayout(OI->get()->getType());
+      prepareOperand(*OI);
+    }
+  } else {
+    V = getLocalRepresentative(V);
+    if (!V->hasName())
+      getAnonValueNumber(V);
+  }
+}
+
+/// prepareLayout - Compute the layout of the given type and of the types it
+/// contains, so that the emission threads only ever read the layouts cached
+/// by TargetData.
+void JsWriter::prepareLayout(const Type *Ty) {
+  if (!LaidOutTypes.insert(Ty))
+    return;
+  if (Ty->isSized()) {
+    TD->getTypeAllocSize(Ty);
+    TD->getABITypeAlignment(Ty);
+  }
+  for (Type::subtype_iterator I = Ty->subtype_begin(), E = Ty->subtype_end();
+       I != E; ++I)
+    prepareLayout(*I);
+}
+
+/// emitPendingFunctions - Render the pending functions into their buffers
+/// using up to NumThreads threads, then write them out in module order.
+void JsWriter::emitPendingFunctions() {
+  if (Pending.empty())
+    return;
+
+  NextPending = 0;
+#if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
+  std::vector<pthread_t> Threads;
+  for (unsigned i = 1, e = std::min<size_t>(NumThreads, Pending.size());
+       i < e; ++i) {
+    pthread_t Thread;
+    if (::pthread_create(&Thread, 0, emitPendingFunctionsThread, this) != 0)
+      break;
+    Threads.push_back(Thread);
+  }
+#endif
+  // The calling thread takes its share of the work too, and finishes the
+  // batch on its own if no thread could be created.
+  emitPendingFunctionsThread(this);
+#if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    ::pthread_join(Threads[i], 0);
+#endif
+
+  for (unsigned i = 0, e = Pending.size(); i != e; ++i) {
+    if (CodeGen) {
+      writeJsFunction(*Pending[i].F, Pending[i].Buffer, Pending[i].Locations);
+    } else {
+      printSeparator();
+      FOut << Pending[i].Buffer;
+    }
+  }
+  // The stubs of -js-split name the arguments as they are written out, so
+  // the names of the batch are kept until then.
+  releaseFunction();
+  for (unsigned i = 0, e = Pending.size(); i != e; ++i)
+    releaseBody(*Pending[i].F);
+  Pending.clear();
+}
+
+/// releaseFunction - Drop the state that the writer kept for the function,
+/// or the batch of functions, that has just been written out, so that the
+/// memory of the writer does not grow with the size of the module.
+void JsWriter::releaseFunction() {
+  AnonValueNumbers.clear();
+  LocalRepresentatives.clear();
+  MinifiedLocals.clear();
+}
+
+/// releaseBody - With -js-stream, release the body of F, which has just been
+/// written out.  A body that was read lazily is dematerialized, so that the
+/// reader could read it again, and any other body is deleted.  The
+/// declarations that the body used are recorded for the epilogue, which
+/// imports them.
+void JsWriter::releaseBody(Function &F) {
+  if (!Facts)
+    return;
+  SmallPtrSet<const Constant*, 32> Visited;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI)
+      recordReleasedUses(*OI, Visited);
+
+  // Releasing the body makes the function external.
+  GlobalValue::LinkageTypes Linkage = F.getLinkage();
+  if (F.isDematerializable())
+    F.Dematerialize();
+  else
+    F.deleteBody();
+  F.setLinkage(Linkage);
+  Released.insert(&F);
+}
+
+/// recordReleasedUses - Record the declarations that V refers to.
+void JsWriter::recordReleasedUses(const Value *V,
+                                  SmallPtrSet<const Constant*, 32> &Visited) {
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+    if (GV->isDeclaration() && !GV->isMaterializable())
+      ReleasedUses.insert(GV);
+    return;
+  }
+  const Constant *C = dyn_cast<Constant>(V);
+  if (!C || !Visited.insert(C))
+    return;
+  for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end();
+       OI != OE; ++OI)
+    recordReleasedUses(*OI, Visited);
+}
+
+/// isJsImport - Return true if GV is a declaration that the module uses, in
+/// the bodies that are in memory, the released ones or the globals.
+bool JsWriter::isJsImport(const GlobalValue *GV) const {
+  if (!GV->isDeclaration() || GV->isMaterializable())
+    return false;
+  if (const Function *F = dyn_cast<Function>(GV))
+    if (Released.count(F))
+      return false;
+  return hasLiveUse(GV) || ReleasedUses.count(GV);
+}
+
+/// isJsDefinition - Return true if F is defined in the module, even if its
+/// body is not in memory.
+bool JsWriter::isJsDefinition(const Function *F) const {
+  return !F->isDeclaration() || F->isMaterializable() || Released.count(F);
+}
+
+void *JsWriter::emitPendingFunctionsThread(void *Arg) {
+  JsWriter *W = static_cast<JsWriter*>(Arg);
+  while (true) {
+    unsigned i = sys::AtomicIncrement(&W->NextPending) - 1;
+    if (i >= W->Pending.size())
+      break;
+    PendingFunction &P = W->Pending[i];
+    raw_string_ostream OS(P.Buffer);
+    unsigned LineNo = P.FirstLine;
+    if (W->CodeGen)
+      W->printJsFunction(*P.F, P.Blocks, OS,
+                         W->SourceMap ? &P.Locations : 0);
+    else
+      W->printFunction(*P.F, P.Blocks, LineNo, OS);
+  }
+  return 0;
+}
+
+void JsWriter::printSeparator() {
+  // The functions of the code generator are not separated.
+  if (CodeGen)
+    return;
+  if(initialized) {
+    FOut << ",\n";
+  } else {
+    initialized = true;
+  }
+}
+
+/// printTypeTable - Output the descriptions of the types in the type table,
+/// in the order of their indices.
+void JsWriter::printTypeTable() {
+  printSeparator();
+  FOut << "{ \"intertype\": \"typeTable\", \"types\": [";
+  for (unsigned i = 0, e = Types->Types.size(); i != e; ++i) {
+    if (i)
+      FOut << ", ";
+    FOut << '"' << getTypeName(Types->Types[i]) << '"';
+  }
+  FOut << "]}";
+}
+
+void JsWriter::printFunction(Function &F, const BlockList &Blocks,
+                             unsigned &LineNo, raw_ostream &Out) {
+  Out << "{ \"ident\": \"" << GetValueName(&F) << "\", ";
+  Out << "\"intertype\": \"function\", \"lineNum\": " << LineNo++;
+  Out << ", \"params\": [";
+  if(!F.arg_empty()) {
+    Function::const_arg_iterator AI = F.arg_begin(), AE = F.arg_end();
     Out << "{ \"item\": \"" << GetValueName(AI) << "\", ";
     Out << "\"intertype\": \"\" }";
     ++AI;
@@ -791,84 +2040,2918 @@ void JsWriter::printFunction(Function &F) {
       Out << "\"intertype\": \"\" }";
     }
   }
-  Out << "]";
-  Out << ", \"returnType\": \"" << F.getReturnType()->getDescription() << "\"";
-  Out << ", \"basicBlocks\":\n[";
+  Out << "]";
+  Out << ", \"returnType\": ";
+  writeType(F.getReturnType(), Out);
+  Out << ", \"basicBlocks\":\n[";
+
+  // print the basic blocks
+  for (BlockList::const_iterator BI = Blocks.begin(), BE = Blocks.end();
+       BI != BE; ++BI)
+    printBasicBlock(*BI, LineNo, Out);
+  Out << "]}";
+}
+
+void JsWriter::printBasicBlock(BasicBlock *BB, unsigned &LineNo,
+                               raw_ostream &Out) {
+  // Output all of the instructions in the basic block...
+  for (BasicBlock::iterator II = BB->begin(), E = --BB->end(); II != E;
+       ++II, LineNo++) {
+    int64_t Offset;
+    bool Folded = isa<GetElementPtrInst>(II) && getConstantOffset(II, Offset);
+    Out << "{ \"ident\": \"" << GetValueName(II) << "\", ";
+    Out << "\"intertype\": \""
+        << (Folded ? "offset" : II->getOpcodeName()) << "\", ";
+    Out << "\"lineNum\": " << LineNo << ", ";
+    Out << "\"operands\": ";
+    if (Folded)
+      writeOffsetOperands(II->getOperand(0), Offset, Out);
+    else
+      writeOperands(*II, Out);
+    Out << "},\n";
+  }
+  const TerminatorInst *terminator = BB->getTerminator();
+  Out << "{ \"intertype\": \"" << terminator->getOpcodeName() << "\", ";
+  Out << "\"lineNum\": " << LineNo++ << ", ";
+  Out << "\"type\": ";
+  writeType(terminator->getType(), Out);
+  Out << ", ";
+  Out << "\"operands\": ";
+  writeOperands(*terminator, Out);
+  Out << "}";
+}
+
+//===----------------------------------------------------------------------===//
+//                       Binary intertype writer
+//===----------------------------------------------------------------------===//
+
+static void writeVBR(raw_ostream &Out, uint64_t V) {
+  do {
+    unsigned char Byte = V & 0x7f;
+    V >>= 7;
+    if (V)
+      Byte |= 0x80;
+    Out << (char)Byte;
+  } while (V);
+}
+
+static void writeSignedVBR(raw_ostream &Out, int64_t V) {
+  writeVBR(Out, ((uint64_t)V << 1) ^ (uint64_t)(V >> 63));
+}
+
+unsigned JsWriter::getStringID(StringRef Str) {
+  StringMapEntry<unsigned> &Entry = StringIDs.GetOrCreateValue(Str, 0);
+  if (Entry.getValue() == 0) {
+    Strings.push_back(Entry.getKey());
+    Entry.setValue(Strings.size());
+  }
+  return Entry.getValue() - 1;
+}
+
+/// getBinaryTypeID - Return the index of the given type in the type pool.
+/// Types that are missing from the type table are appended after it.
+unsigned JsWriter::getBinaryTypeID(const Type *Ty) {
+  DenseMap<const Type*, unsigned>::const_iterator I = Types->IDs.find(Ty);
+  if (I != Types->IDs.end())
+    return I->second;
+  std::pair<DenseMap<const Type*, unsigned>::iterator, bool> Lookup =
+    ExtraTypeIDs.insert(std::make_pair(Ty, Types->Types.size() +
+                                           ExtraTypes.size()));
+  if (Lookup.second)
+    ExtraTypes.push_back(Ty);
+  return Lookup.first->second;
+}
+
+void JsWriter::writeBinaryHeader() {
+  SmallString<8> Header;
+  raw_svector_ostream OS(Header);
+  OS << "JSIB";
+  writeVBR(OS, jsbin::JS_BINARY_VERSION);
+  OS.flush();
+  FOut << Header.str();
+  BinaryOffset += Header.size();
+}
+
+/// writeBinaryItem - Output a top-level item, prefixed by its kind and by
+/// the length of its payload.
+void JsWriter::writeBinaryItem(unsigned Kind, StringRef Payload) {
+  SmallString<16> Prefix;
+  raw_svector_ostream OS(Prefix);
+  writeVBR(OS, Kind);
+  writeVBR(OS, Payload.size());
+  OS.flush();
+  FOut << Prefix.str() << Payload;
+  BinaryOffset += Prefix.size() + Payload.size();
+}
+
+/// writeBinaryPools - Output the string and type pools, followed by the
+/// trailer that locates them.
+void JsWriter::writeBinaryPools() {
+  uint64_t PoolsOffset = BinaryOffset;
+
+  // Intern the type descriptions first, so that the string pool is complete.
+  std::vector<unsigned> TypeStrings;
+  for (unsigned i = 0, e = Types->Types.size(); i != e; ++i)
+    TypeStrings.push_back(getStringID(getTypeName(Types->Types[i])));
+  for (unsigned i = 0, e = ExtraTypes.size(); i != e; ++i)
+    TypeStrings.push_back(getStringID(getTypeName(ExtraTypes[i])));
+
+  SmallString<1024> Pools;
+  raw_svector_ostream OS(Pools);
+  writeVBR(OS, Strings.size());
+  for (unsigned i = 0, e = Strings.size(); i != e; ++i) {
+    writeVBR(OS, Strings[i].size());
+    OS << Strings[i];
+  }
+  writeVBR(OS, TypeStrings.size());
+  for (unsigned i = 0, e = TypeStrings.size(); i != e; ++i)
+    writeVBR(OS, TypeStrings[i]);
+  OS.flush();
+  FOut << Pools.str();
+
+  assert(PoolsOffset < (1ULL << 32) && "Binary intertype file too large!");
+  for (unsigned i = 0; i != 4; ++i)
+    FOut << (char)((PoolsOffset >> (i * 8)) & 0xff);
+}
+
+void JsWriter::encodeGlobal(GlobalVariable *GV) {
+  SmallString<256> Payload;
+  raw_svector_ostream OS(Payload);
+  writeVBR(OS, getStringID(GetValueName(GV)));
+  writeVBR(OS, LineNumber++);
+  writeVBR(OS, getBinaryTypeID(GV->getType()));
+  encodeConstant(GV->getInitializer(), OS);
+  OS.flush();
+  writeBinaryItem(jsbin::ITEM_GLOBAL, Payload.str());
+}
+
+void JsWriter::encodeFunction(Function &F, const BlockList &Blocks) {
+  SmallString<1024> Payload;
+  raw_svector_ostream OS(Payload);
+  writeVBR(OS, getStringID(GetValueName(&F)));
+  writeVBR(OS, LineNumber++);
+  writeVBR(OS, getBinaryTypeID(F.getReturnType()));
+  writeVBR(OS, F.arg_size());
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    writeVBR(OS, getStringID(GetValueName(AI)));
+
+  writeVBR(OS, Blocks.size());
+  for (BlockList::const_iterator BI = Blocks.begin(), BE = Blocks.end();
+       BI != BE; ++BI) {
+    BasicBlock *BB = *BI;
+    writeVBR(OS, getStringID(GetValueName(BB)));
+    writeVBR(OS, BB->size());
+    for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+         ++II, ++LineNumber) {
+      bool IsTerminator = isa<TerminatorInst>(II);
+      int64_t Offset;
+      bool Folded = isa<GetElementPtrInst>(II) && getConstantOffset(II, Offset);
+      writeVBR(OS, IsTerminator ? 0 : getStringID(GetValueName(II)) + 1);
+      writeVBR(OS, getStringID(Folded ? "offset" : II->getOpcodeName()));
+      writeVBR(OS, LineNumber);
+      writeVBR(OS, IsTerminator ? getBinaryTypeID(II->getType()) + 1 : 0);
+      if (Folded) {
+        encodeOffsetOperands(II->getOperand(0), Offset, OS);
+        continue;
+      }
+      writeVBR(OS, II->getNumOperands());
+      for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI)
+        encodeOperand(*OI, OS);
+    }
+  }
+  OS.flush();
+  writeBinaryItem(jsbin::ITEM_FUNCTION, Payload.str());
+}
+
+void JsWriter::encodeOperand(Value *Operand, raw_ostream &Out) {
+  writeVBR(Out, getBinaryTypeID(Operand->getType()));
+  if (GlobalValue *GV = dyn_cast<GlobalValue>(Operand)) {
+    writeVBR(Out, jsbin::VALUE_GLOBAL);
+    writeVBR(Out, getStringID(GetValueName(GV)));
+  } else if (Constant *CPV = dyn_cast<Constant>(Operand)) {
+    encodeConstant(CPV, Out);
+  } else {
+    writeVBR(Out, jsbin::VALUE_LOCAL);
+    writeVBR(Out, getStringID(GetValueName(Operand)));
+  }
+}
+
+/// encodeOffsetOperands - The binary counterpart of writeOffsetOperands,
+/// including the operand count.
+void JsWriter::encodeOffsetOperands(Value *Ptr, int64_t Offset,
+                                    raw_ostream &Out) {
+  writeVBR(Out, 2);
+  encodeOperand(Ptr, Out);
+  writeVBR(Out, getBinaryTypeID(Type::getInt32Ty(Ptr->getContext())));
+  writeVBR(Out, jsbin::VALUE_INT);
+  writeSignedVBR(Out, Offset);
+}
+
+/// encodeConstant - The binary counterpart of printConstant.
+void JsWriter::encodeConstant(Constant *CPV, raw_ostream &Out) {
+  if (GlobalValue *GV = dyn_cast<GlobalValue>(CPV)) {
+    writeVBR(Out, jsbin::VALUE_GLOBAL);
+    writeVBR(Out, getStringID(GetValueName(GV)));
+    return;
+  }
+
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(CPV)) {
+    // As in the JSON form, a getelementptr without indices is its pointer,
+    // and one with constant indices is folded into a byte offset.
+    int64_t Offset;
+    if (CE->getOpcode() == Instruction::GetElementPtr &&
+        (CE->getNumOperands() <= 1 || getConstantOffset(CE, Offset))) {
+      if (CE->getNumOperands() <= 1 || !Offset) {
+        encodeConstant(CE->getOperand(0), Out);
+        return;
+      }
+      writeVBR(Out, jsbin::VALUE_EXPR);
+      writeVBR(Out, getStringID("offset"));
+      writeVBR(Out, 0);
+      encodeOffsetOperands(CE->getOperand(0), Offset, Out);
+      return;
+    }
+    writeVBR(Out, jsbin::VALUE_EXPR);
+    writeVBR(Out, getStringID(CE->getOpcodeName()));
+    writeVBR(Out, CE->isCompare() ? CE->getPredicate() : 0);
+    writeVBR(Out, CE->getNumOperands());
+    for (User::op_iterator OI = CE->op_begin(), OE = CE->op_end();
+         OI != OE; ++OI)
+      encodeOperand(*OI, Out);
+    return;
+  }
+
+  if (isa<ConstantAggregateZero>(CPV) ||
+      (isa<UndefValue>(CPV) && !CPV->getType()->isSingleValueType())) {
+    writeVBR(Out, jsbin::VALUE_ZERO);
+    return;
+  }
+  if (isa<UndefValue>(CPV)) {
+    writeVBR(Out, jsbin::VALUE_UNDEF);
+    return;
+  }
+  if (isa<ConstantPointerNull>(CPV)) {
+    writeVBR(Out, jsbin::VALUE_NULL);
+    return;
+  }
+
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(CPV)) {
+    if (CI->getType() == Type::getInt1Ty(CPV->getContext())) {
+      writeVBR(Out, jsbin::VALUE_BOOL);
+      writeVBR(Out, CI->getZExtValue());
+    } else {
+      writeVBR(Out, jsbin::VALUE_INT);
+      writeSignedVBR(Out, CI->getSExtValue());
+    }
+    return;
+  }
+
+  if (ConstantFP *FPC = dyn_cast<ConstantFP>(CPV)) {
+    double V;
+    if (FPC->getType() == Type::getFloatTy(CPV->getContext()))
+      V = FPC->getValueAPF().convertToFloat();
+    else if (FPC->getType() == Type::getDoubleTy(CPV->getContext()))
+      V = FPC->getValueAPF().convertToDouble();
+    else {
+#ifndef NDEBUG
+      errs() << "Unknown constant type: " << *CPV << "\n";
+#endif
+      llvm_unreachable(0);
+    }
+    uint64_t Bits = DoubleToBits(V);
+    writeVBR(Out, jsbin::VALUE_FLOAT);
+    for (unsigned i = 0; i != 8; ++i)
+      Out << (char)((Bits >> (i * 8)) & 0xff);
+    return;
+  }
+
+  if (ConstantArray *CPA = dyn_cast<ConstantArray>(CPV)) {
+    if (isCString(CPA)) {
+      std::string Str;
+      for (unsigned i = 0, e = CPA->getNumOperands()-1; i != e; ++i)
+        Str += (char)cast<ConstantInt>(CPA->getOperand(i))->getZExtValue();
+      writeVBR(Out, jsbin::VALUE_STRING);
+      writeVBR(Out, getStringID(Str));
+      return;
+    }
+  }
+
+  if (isa<ConstantArray>(CPV) || isa<ConstantStruct>(CPV) ||
+      isa<ConstantVector>(CPV)) {
+    writeVBR(Out, jsbin::VALUE_AGGREGATE);
+    writeVBR(Out, CPV->getNumOperands());
+    for (User::op_iterator OI = CPV->op_begin(), OE = CPV->op_end();
+         OI != OE; ++OI)
+      encodeConstant(cast<Constant>(*OI), Out);
+    return;
+  }
+
+#ifndef NDEBUG
+  errs() << "Unknown constant type: " << *CPV << "\n";
+#endif
+  llvm_unreachable(0);
+}
+
+//===----------------------------------------------------------------------===//
+//                       Javascript code generator
+//===----------------------------------------------------------------------===//
+//
+// With -js-codegen the writer emits a javascript module of the form
+//
+//   var JsModule = function(global, env, buffer) {
+//     var HEAP8 = new global.Int8Array(buffer);  ... (the other heap views)
+//     var STACKTOP = ...;
+//     function _main(vargc, vargv) { ... }
+//     var _printf = env._printf;                  (the imported symbols)
+//     HEAPU8.set([...], 16);                      (the static data)
+//     var FUNCTION_TABLE_ii = [abort, ...];       (the function tables)
+//     return { _main: _main };
+//   };
+//
+// All the memory of the program lives in the heap buffer: the static data of
+// the global variables is laid out from address JS_GLOBAL_BASE according to
+// the data layout of the module, and the stack grows upwards from the end of
+// it.  Pointers are byte addresses into the heap, and loads and stores index
+// the heap view of the accessed type.  Function pointers are indices into
+// the function table of their signature, FUNCTION_TABLE_ followed by the
+// letters of the javascript types of the result and the parameters (see
+// getJsSignature), in which index 0 is the null function pointer.  Indirect
+// calls index the table of the called type, masking the pointer to the size
+// of the table, which is a power of two, instead of checking its bounds.
+// Functions of different signatures may thus have the same pointer.
+//
+// Values are held in javascript locals.  Integers of up to 32 bits are kept
+// sign extended to 32 bits (i1 as 0 or 1), and every operation restores that
+// form with an explicit coercion, e.g. "(a + b)|0" or "x<<24>>24".  Doubles
+// are coerced with a unary "+" and floats with Math_fround.  Coercions that
+// the expression makes redundant are left out, e.g. the "|0" of "a << b",
+// or that of "(a / b)|0" under "<<24>>24" (see isJsSigned32).  With
+// -js-reuse-locals, values whose live ranges do not overlap share a local,
+// see JsLocalColoring.h.
+//
+// i64 values are split into their i32 halves by -js-legalize-i64, which is
+// on by default (see JsLegalizeI64.cpp).  Functions take an i64 argument as
+// two arguments, the low half first, and return an i64 result as its low
+// half, with the high half stored to HEAP32[JS_TEMP_RET_PTR >> 2], where the
+// caller reads it right after the call.  Host functions that the module
+// imports or calls follow the same convention.  Divisions that do not fit in
+// i32 call i64_divmod in the runtime, which divides the halves.  The i64
+// values left whole, and all of them without the legalization, are
+// approximated by doubles, which is exact up to 2^53.
+//
+// Control flow is rebuilt into nested loops, conditionals and labeled blocks
+// by the relooper (see JsRelooper.h), and phi nodes are assigned on the edges
+// that lead to their block, as a parallel copy (see printJsBranch).  Unless
+// -js-coalesce-phis=false is given, a phi shares the local of its incoming
+// values where they do not interfere, which leaves most edges without
+// copies.  Switches become comparisons, bit tests, jump tables or binary
+// searches over their sorted cases (see printJsSwitch).
+//
+// The stack is the part of the heap from STACKTOP up.  The static allocas of
+// a function are in a frame that it allocates on entry, where the allocas
+// whose contents are never live at the same time share slots (see
+// JsFrameLayout.h), and above -O0 only the allocas that SROA cannot promote
+// are left.  Variadic arguments are passed on the stack, as a pointer that
+// follows the fixed arguments.  Imported functions are called with the same
+// convention as the generated ones.
+//
+// Exceptions are javascript exceptions whose value is the pointer to the
+// exception object: the runtime is expected to throw it as a number from
+// __cxa_throw and _Unwind_Resume_or_Rethrow.  An invoke that may throw runs
+// its call in a try block, whose handler records the pointer in the local
+// exn and branches to the unwind destination.  llvm.eh.exception reads exn,
+// unwind rethrows it, or aborts if no exception was caught, and
+// llvm.eh.selector calls the eh_selector function of the environment with
+// the exception and the clauses.  Invokes of calls that cannot throw are
+// emitted as plain calls.
+//
+// The module exports its external functions.  With -js-exports, only main
+// and the symbols listed in the given file stay external, and the code and
+// data that they do not use are removed before the code is generated (see
+// addJsScopeRestrictions).
+//
+// Above -O0, the static constructors that can be run at compile time are
+// folded into the static data and dropped from llvm.global_ctors, up to the
+// first one that cannot be (see JsCtorEval.cpp).
+//
+// With -js-mem-init, the static data is a base64 string that the module
+// decodes into the heap.  With -js-mem-init-file too, it is written to that
+// file, and env.loadMemoryImage is passed the name of the file and returns
+// its bytes.
+//
+// With -js-split, the functions that are cold at startup are written to the
+// chunk files <prefix>N.js, and the module keeps a stub for each of them.
+// The first call of a stub passes N to env.loadChunk, which returns the code
+// of the chunk, and evaluates it in the scope of the module.  That code
+// assigns the functions of the chunk over their stubs, and over the entries
+// of the stubs in the function tables.
+//
+// With -js-profile, the relooper lays out the functions after the edge
+// profile: the successors that a block rarely branches to are placed after
+// the code of the block, out of the hot path, which falls through the
+// conditionals that lead to them (see JsRelooper.h).
+//
+// With -js-source-map, the code of every instruction that has a debug
+// location is mapped to it in a version 3 source map, see JsSourceMap.h.
+// The code of the chunks is not mapped.
+//
+// With -js-profile-instrument, the functions count their entries, and the
+// edges that the optimal edge profiler selects count their executions, in an
+// llvmprof.out file that the module keeps in the heap (see JsProfiling.cpp).
+// The host saves the bytes HEAPU8.subarray(_llvm_prof_data(),
+// _llvm_prof_data() + _llvm_prof_size()) as the profile.  The counters are
+// placed where -js-profile reads them, after the cleanup passes of the code
+// generator, so llvm-prof reads the profile with the module as those passes
+// leave it, which is the input module itself at -O0 and for modules that
+// were optimized already.
+//
+
+enum {
+  /// JS_TEMP_DOUBLE_PTR - Address of the 8 bytes through which values are
+  /// reinterpreted and unaligned values copied.
+  JS_TEMP_DOUBLE_PTR = 8,
+  /// JS_GLOBAL_BASE - Address of the first global variable.
+  JS_GLOBAL_BASE = 16,
+  /// JS_MEM_UNROLL_LIMIT - The largest memcpy or memset of constant size that
+  /// is unrolled into loads and stores.
+  JS_MEM_UNROLL_LIMIT = 64,
+  /// JS_MIN_JUMP_TABLE_SIZE - The fewest case values that a switch statement
+  /// is emitted for, rather than comparisons.
+  JS_MIN_JUMP_TABLE_SIZE = 4,
+  /// JS_BIT_TEST_WIDTH - The widest span of case values that is tested with
+  /// the bits of a mask.
+  JS_BIT_TEST_WIDTH = 32
+};
+
+/// JS_MIN_JUMP_TABLE_DENSITY - The smallest fraction of the span of the case
+/// values of a switch statement that the cases have to fill for the engines
+/// to compile it into a jump table.
+static const double JS_MIN_JUMP_TABLE_DENSITY = 0.4;
+
+static void unsupportedJs(const Value *V, const char *What) {
+  std::string Msg;
+  raw_string_ostream OS(Msg);
+  OS << "The javascript code generator does not support " << What << ": "
+     << *V;
+  report_fatal_error(OS.str());
+}
+
+/// getJsIntWidth - Return the width of the integers that represent values of
+/// the given type, or 0 if the type is not an integer or a pointer.
+static unsigned getJsIntWidth(const Type *Ty) {
+  if (Ty->isPointerTy())
+    return 32;
+  if (const IntegerType *ITy = dyn_cast<IntegerType>(Ty))
+    return ITy->getBitWidth();
+  return 0;
+}
+
+/// isJsAtomic - Return true if the given expression can be used as an operand
+/// without parentheses: a name, a number, or a call, index or parenthesized
+/// expression that spans the whole string.
+static bool isJsAtomic(const std::string &E) {
+  size_t i = 0, e = E.size();
+  while (i != e && (isalnum(E[i]) || E[i] == '_' || E[i] == '$' ||
+                    E[i] == '.'))
+    ++i;
+  if (i == e)
+    return e != 0;
+  if (E[i] != '(' && E[i] != '[')
+    return false;
+  unsigned Depth = 0;
+  for (; i != e; ++i) {
+    if (E[i] == '(' || E[i] == '[')
+      ++Depth;
+    else if ((E[i] == ')' || E[i] == ']') && --Depth == 0)
+      return i == e - 1;
+  }
+  return false;
+}
+
+static std::string parenJs(const std::string &E) {
+  return isJsAtomic(E) ? E : "(" + E + ")";
+}
+
+/// isJsSigned32 - Return true if the given expression is in the 32-bit sign
+/// extended form whatever its operands are: if its outermost operation is a
+/// bitwise one other than ">>>", or "~~".
+static bool isJsSigned32(const std::string &E) {
+  // The precedence of the loosest binding operator at the top level, from 1
+  // for "|" to 8 for the multiplicative ones.
+  unsigned Lowest = ~0U, Depth = 0;
+  bool UnsignedShift = false;
+  for (size_t i = 0, e = E.size(); i != e; ++i) {
+    unsigned Precedence;
+    bool Unsigned = false;
+    switch (E[i]) {
+    case '(': case '[': ++Depth; continue;
+    case ')': case ']': --Depth; continue;
+    case '?': case ',':
+      if (!Depth)
+        return false;
+      continue;
+    case '|': Precedence = 1; break;
+    case '^': Precedence = 2; break;
+    case '&': Precedence = 3; break;
+    case '=':
+    case '!':
+      if (i + 1 == e || E[i + 1] != '=') {
+        // An assignment, or a logical not.
+        if (E[i] == '=' && !Depth)
+          return false;
+        continue;
+      }
+      Precedence = 4;
+      while (i + 1 != e && E[i + 1] == '=')
+        ++i;
+      break;
+    case '<':
+    case '>':
+      if (i + 1 != e && E[i + 1] == E[i]) {
+        Precedence = 6;
+        Unsigned = i + 2 != e && E[i + 2] == '>';
+        i += Unsigned ? 2 : 1;
+      } else {
+        Precedence = 5;
+        if (i + 1 != e && E[i + 1] == '=')
+          ++i;
+      }
+      break;
+    case '+': case '-': Precedence = 7; break;
+    case '*': case '/': case '%': Precedence = 8; break;
+    default: continue;
+    }
+    if (Depth)
+      continue;
+    if (Precedence < Lowest) {
+      Lowest = Precedence;
+      UnsignedShift = Unsigned;
+    } else if (Precedence == Lowest) {
+      UnsignedShift |= Unsigned;
+    }
+  }
+  if (Lowest <= 3)
+    return true;
+  if (Lowest == 6)
+    return !UnsignedShift;
+  return Lowest == ~0U && E.compare(0, 2, "~~") == 0;
+}
+
+/// stripJsInt32 - Return the operand of the given "X|0" coercion, for an
+/// operation that converts its operand to int32 itself, or the expression
+/// if it is not one.
+static std::string stripJsInt32(const std::string &E) {
+  size_t e = E.size();
+  if (e > 2 && E.compare(e - 2, 2, "|0") == 0 &&
+      isJsAtomic(E.substr(0, e - 2)))
+    return E.substr(0, e - 2);
+  return E;
+}
+
+static std::string formatJsInt(int64_t V) {
+  return V < 0 ? "(" + itostr(V) + ")" : itostr(V);
+}
+
+static std::string formatJsDouble(double V) {
+  if (IsNAN(V))
+    return "NaN";
+  if (IsInf(V))
+    return V < 0 ? "(-Infinity)" : "Infinity";
+  char Buffer[32];
+  snprintf(Buffer, sizeof(Buffer), "%.15g", V);
+  if (strtod(Buffer, 0) != V)
+    snprintf(Buffer, sizeof(Buffer), "%.17g", V);
+  std::string S = Buffer;
+  if (S.find_first_of(".e") == std::string::npos)
+    S += ".0";
+  return S[0] == '-' ? "(" + S + ")" : S;
+}
+
+/// coerceJs - Annotate the given expression with the type of its value.  An
+/// expression that already has the annotation is returned as it is.
+static std::string coerceJs(const std::string &E, const Type *Ty) {
+  if (Ty->isFloatTy()) {
+    if (E.compare(0, 12, "Math_fround(") == 0 && isJsAtomic(E))
+      return E;
+    return "Math_fround(" + E + ")";
+  }
+  if (Ty->isDoubleTy() || getJsIntWidth(Ty) == 64) {
+    if (E[0] == '+' && isJsAtomic(E.substr(1)))
+      return E;
+    return "+" + parenJs(E);
+  }
+  if (getJsIntWidth(Ty))
+    return isJsSigned32(E) ? E : parenJs(E) + "|0";
+  return E;
+}
+
+/// normalizeJs - Bring the given integer expression of the given width into
+/// its sign extended form.  The 32-bit form also truncates doubles.  The
+/// bitwise operators convert their operands to int32 themselves, which makes
+/// a "|0" coercion of the expression redundant under the narrower forms.
+static std::string normalizeJs(const std::string &E, unsigned Width) {
+  if (Width == 32)
+    return isJsSigned32(E) ? E : parenJs(E) + "|0";
+  if (Width == 1)
+    return parenJs(stripJsInt32(E)) + "&1";
+  std::string Shift = utostr(32 - Width);
+  return parenJs(stripJsInt32(E)) + "<<" + Shift + ">>" + Shift;
+}
+
+/// unsignedJs - Return the zero extended value of the given atomic integer
+/// expression of the given width.
+static std::string unsignedJs(const std::string &E, unsigned Width) {
+  if (Width == 1)
+    return E;
+  if (Width == 32)
+    return "(" + E + ">>>0)";
+  if (Width == 64)
+    return "i64_u(" + E + ")";
+  return "(" + E + " & " + utostr((1U << Width) - 1) + ")";
+}
+
+static std::string getJsZero(const Type *Ty) {
+  if (Ty->isFloatTy())
+    return "Math_fround(0)";
+  if (Ty->isDoubleTy() || getJsIntWidth(Ty) == 64)
+    return "0.0";
+  return "0";
+}
+
+/// getJsHeap - Return the heap view through which aligned values of the given
+/// type are accessed, and the log2 of its element size.
+static const char *getJsHeap(const Type *Ty, unsigned &Shift) {
+  switch (Ty->getTypeID()) {
+  case Type::FloatTyID:   Shift = 2; return "HEAPF32";
+  case Type::DoubleTyID:  Shift = 3; return "HEAPF64";
+  case Type::PointerTyID: Shift = 2; return "HEAP32";
+  case Type::IntegerTyID:
+    switch (cast<IntegerType>(Ty)->getBitWidth()) {
+    case 1:
+    case 8:  Shift = 0; return "HEAP8";
+    case 16: Shift = 1; return "HEAP16";
+    case 32: Shift = 2; return "HEAP32";
+    }
+  default:
+    return 0;
+  }
+}
+
+/// getJsHeapElement - Return the element of the given heap view at the
+/// address Ptr + Offset.
+static std::string getJsHeapElement(const char *Heap, unsigned Shift,
+                                    const std::string &Ptr, unsigned Offset) {
+  std::string Index = parenJs(Ptr);
+  if (Offset)
+    Index += " + " + utostr(Offset) + " ";
+  return std::string(Heap) + "[" + Index + ">>" + utostr(Shift) + "]";
+}
+
+/// lowerIntrinsics - Lower the intrinsic calls of F that the code generator
+/// does not implement directly, as the C backend does.  Return true if F was
+/// changed.
+bool JsWriter::lowerIntrinsics(Function &F) {
+  bool Changed = false;
+  for (Function::iterator BB = F.begin(), EE = F.end(); BB != EE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; )
+      if (CallInst *CI = dyn_cast<CallInst>(I++))
+        if (Function *Callee = CI->getCalledFunction())
+          switch (Callee->getIntrinsicID()) {
+          case Intrinsic::not_intrinsic:
+          case Intrinsic::memcpy:
+          case Intrinsic::memmove:
+          case Intrinsic::memset:
+          case Intrinsic::vastart:
+          case Intrinsic::vacopy:
+          case Intrinsic::vaend:
+          case Intrinsic::stacksave:
+          case Intrinsic::stackrestore:
+          case Intrinsic::dbg_declare:
+          case Intrinsic::dbg_value:
+          case Intrinsic::lifetime_start:
+          case Intrinsic::lifetime_end:
+          case Intrinsic::invariant_start:
+          case Intrinsic::invariant_end:
+          case Intrinsic::objectsize:
+          case Intrinsic::memory_barrier:
+          case Intrinsic::prefetch:
+          case Intrinsic::pcmarker:
+          case Intrinsic::trap:
+          case Intrinsic::eh_exception:
+          case Intrinsic::eh_selector:
+          case Intrinsic::eh_typeid_for:
+            // We directly implement these intrinsics
+            break;
+          default: {
+            Instruction *Before = 0;
+            if (CI != &BB->front())
+              Before = prior(BasicBlock::iterator(CI));
+
+            IL->LowerIntrinsicCall(CI);
+            Changed = true;
+            if (Before) {        // Move iterator to instruction after call
+              I = Before; ++I;
+            } else {
+              I = BB->begin();
+            }
+            break;
+          }
+          }
+  return Changed;
+}
+
+/// colorLocals - Assign the values of the function with the given blocks to
+/// the locals that they share.  Values share a local only if they have the
+/// same initializer, which stands for their type in javascript.
+void JsWriter::colorLocals(const BlockList &Blocks) {
+  JsLocalColoring Coloring(Blocks, getJsZero, JsCoalescePhis, JsReuseLocals);
+  const DenseMap<const Value*, const Value*> &Reps =
+    Coloring.getRepresentatives();
+  for (DenseMap<const Value*, const Value*>::const_iterator I = Reps.begin(),
+       E = Reps.end(); I != E; ++I)
+    if (I->first != I->second)
+      LocalRepresentatives[I->first] = I->second;
+}
+
+/// layoutGlobals - Assign the function table indices of the functions whose
+/// address is taken and the addresses of the global variables, then build
+/// the static data image from their initializers.
+///
+/// The intertype only holds the global variables that it would otherwise
+/// print, and has no function tables: pointers to functions and to the other
+/// global variables are relocations.
+void JsWriter::layoutGlobals(Module &M) {
+  if (CodeGen)
+    layoutFunctionTables(M);
+
+  uint64_t Top = JS_GLOBAL_BASE;
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (!CodeGen && !I->hasLocalLinkage() && !I->hasHiddenVisibility())
+      continue;
+    const Type *Ty = I->getType()->getElementType();
+    Top = RoundUpToAlignment(Top, std::max(TD->getPreferredAlignment(I),
+                                           I->getAlignment()));
+    GlobalAddresses[I] = Top;
+    Top += TD->getTypeAllocSize(Ty);
+  }
+  assert(Top < (1ULL << 31) && "Static data too large!");
+  StaticData.assign(Top - JS_GLOBAL_BASE, 0);
+  StackBase = RoundUpToAlignment(Top, 16);
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (GlobalAddresses.count(I))
+      layoutConstant(I->getInitializer(), GlobalAddresses[I]);
+}
+
+/// getJsSignatureChar - Return the letter of the javascript type of the given
+/// result or parameter type in the name of a function table.
+static char getJsSignatureChar(const Type *Ty) {
+  if (Ty->isVoidTy())
+    return 'v';
+  if (Ty->isFloatTy())
+    return 'f';
+  if (Ty->isDoubleTy() || getJsIntWidth(Ty) == 64)
+    return 'd';
+  return 'i';
+}
+
+/// getJsSignature - Return the signature of the given function type: the
+/// letters of its result and parameter types, with the pointer to the
+/// variadic arguments last.  Function types with the same signature are
+/// called the same way, and share a function table.
+static std::string getJsSignature(const FunctionType *FTy) {
+  std::string Sig(1, getJsSignatureChar(FTy->getReturnType()));
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    Sig += getJsSignatureChar(FTy->getParamType(i));
+  if (FTy->isVarArg())
+    Sig += 'i';
+  return Sig;
+}
+
+/// getJsCalledType - Return the type through which the functions of the given
+/// type are called.  With -js-stream, the i64 legalization only gives the
+/// functions and calls that are read lazily their legal types as they are
+/// emitted.
+static const FunctionType *getJsCalledType(const FunctionType *FTy) {
+  return JsLegalizeI64 ? getJsLegalI64Type(FTy) : FTy;
+}
+
+/// layoutFunctionTables - Give every function whose address is taken an
+/// index in the table of its signature, and create the tables that the
+/// indirect calls of the module index, even if no function has their
+/// signature.  The tables are padded with null entries to a power of two.
+void JsWriter::layoutFunctionTables(Module &M) {
+  if (Facts)
+    for (std::set<const FunctionType*>::const_iterator
+         I = Facts->IndirectCalls.begin(), E = Facts->IndirectCalls.end();
+         I != E; ++I) {
+      std::vector<const Function*> &Table =
+        FunctionTables[getJsSignature(getJsCalledType(*I))];
+      if (Table.empty())
+        Table.push_back(0);
+    }
+
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (Facts ? Facts->AddressTaken.count(F) : F->hasAddressTaken()) {
+      std::vector<const Function*> &Table =
+        FunctionTables[getJsSignature(getJsCalledType(F->getFunctionType()))];
+      if (Table.empty())
+        Table.push_back(0);
+      FunctionIndices[F] = Table.size();
+      Table.push_back(F);
+    }
+
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+           ++I) {
+        CallSite CS(I);
+        if (!CS)
+          continue;
+        const Value *Callee = CS.getCalledValue()->stripPointerCasts();
+        if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(Callee))
+          if (const GlobalValue *GV = GA->resolveAliasedGlobal(false))
+            Callee = GV;
+        if (isa<Function>(Callee) || isa<InlineAsm>(Callee))
+          continue;
+        const FunctionType *FTy = cast<FunctionType>(
+          cast<PointerType>(CS.getCalledValue()->getType())->getElementType());
+        std::vector<const Function*> &Table =
+          FunctionTables[getJsSignature(FTy)];
+        if (Table.empty())
+          Table.push_back(0);
+      }
+  }
+
+  for (std::map<std::string, std::vector<const Function*> >::iterator
+       I = FunctionTables.begin(), E = FunctionTables.end(); I != E; ++I)
+    I->second.resize(NextPowerOf2(I->second.size() - 1), 0);
+}
+
+/// replaceFunction - Give NF, which the i64 legalization put in the place of
+/// F when its body was read with -js-stream, the name and the table entry of
+/// F.
+void JsWriter::replaceFunction(const Function *F, const Function *NF) {
+  DenseMap<const GlobalValue*, std::string>::iterator N = GlobalNames.find(F);
+  if (N != GlobalNames.end()) {
+    std::string Name = N->second;
+    GlobalNames.erase(N);
+    GlobalNames[NF] = Name;
+  }
+  DenseMap<const Value*, std::string>::iterator M = MinifiedNames.find(F);
+  if (M != MinifiedNames.end()) {
+    std::string Name = M->second;
+    MinifiedNames.erase(M);
+    MinifiedNames[NF] = Name;
+  }
+  DenseMap<const Function*, unsigned>::iterator I = FunctionIndices.find(F);
+  if (I != FunctionIndices.end()) {
+    unsigned Index = I->second;
+    FunctionIndices.erase(I);
+    FunctionIndices[NF] = Index;
+    FunctionTables[getJsSignature(NF->getFunctionType())][Index] = NF;
+  }
+}
+
+static void writeBase64(raw_ostream &Out, const unsigned char *Data,
+                        size_t Size) {
+  static const char Digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < Size; i += 3) {
+    unsigned Bits = Data[i] << 16;
+    if (i + 1 < Size)
+      Bits |= Data[i + 1] << 8;
+    if (i + 2 < Size)
+      Bits |= Data[i + 2];
+    Out << Digits[Bits >> 18] << Digits[(Bits >> 12) & 63]
+        << (i + 1 < Size ? Digits[(Bits >> 6) & 63] : '=')
+        << (i + 2 < Size ? Digits[Bits & 63] : '=');
+  }
+}
+
+/// writeMemoryImageFile - Write the first Size bytes of the static data to
+/// the file given by -js-mem-init-file.
+void JsWriter::writeMemoryImageFile(size_t Size) {
+  std::string Error;
+  raw_fd_ostream File(JsMemInitFile.c_str(), Error, raw_fd_ostream::F_Binary);
+  if (!Error.empty())
+    report_fatal_error("Cannot open the javascript memory image '" +
+                       JsMemInitFile + "': " + Error);
+  if (Size)
+    File.write((const char*)&StaticData[0], Size);
+}
+
+/// printMemoryInitializer - Output the memory image of the global variables
+/// of the intertype, the addresses of the variables in it, and the pointers
+/// in it that the consumer has to relocate.  Trailing zeros are left out of
+/// the image, the consumer clears the memory up to its size.
+void JsWriter::printMemoryInitializer(Module &M) {
+  size_t Size = StaticData.size();
+  while (Size && !StaticData[Size - 1])
+    --Size;
+
+  printSeparator();
+  FOut << "{ \"intertype\": \"memoryInitializer\", \"base\": "
+       << (unsigned)JS_GLOBAL_BASE << ", \"size\": " << StaticData.size()
+       << ", ";
+  if (!JsMemInitFile.empty()) {
+    writeMemoryImageFile(Size);
+    FOut << "\"file\": \"";
+    FOut.write_escaped(JsMemInitFile);
+  } else {
+    FOut << "\"data\": \"";
+    if (Size)
+      writeBase64(FOut, &StaticData[0], Size);
+  }
+  FOut << "\" }";
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    DenseMap<const GlobalValue*, uint64_t>::const_iterator A =
+      GlobalAddresses.find(I);
+    if (A == GlobalAddresses.end())
+      continue;
+    printSeparator();
+    FOut << "{ \"ident\": \"" << GetValueName(I)
+         << "\", \"intertype\": \"globalVariable\", \"lineNum\": "
+         << LineNumber++ << ", \"type\": ";
+    writeType(I->getType(), FOut);
+    FOut << ", \"address\": " << A->second << " }";
+  }
+
+  if (Relocations.empty())
+    return;
+  printSeparator();
+  FOut << "{ \"intertype\": \"relocations\", \"relocations\": [";
+  for (unsigned i = 0, e = Relocations.size(); i != e; ++i) {
+    const JsRelocation &R = Relocations[i];
+    FOut << (i ? ", " : "") << "{ \"address\": " << R.Address
+         << ", \"target\": \"" << GetValueName(R.Target)
+         << "\", \"offset\": " << R.Offset << " }";
+  }
+  FOut << "]}";
+}
+
+void JsWriter::writeStaticBytes(uint64_t Address, uint64_t Value,
+                                unsigned Size) {
+  for (unsigned i = 0; i != Size && i != 8; ++i)
+    StaticData[Address - JS_GLOBAL_BASE + i] = (Value >> (i * 8)) & 0xff;
+}
+
+/// layoutConstant - Write the bytes of the given initializer at the given
+/// address of the static data image.
+void JsWriter::layoutConstant(const Constant *C, uint64_t Address) {
+  if (isa<ConstantAggregateZero>(C) || isa<UndefValue>(C) ||
+      isa<ConstantPointerNull>(C))
+    return;
+
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+    const APInt &V = CI->getValue();
+    unsigned Size = TD->getTypeStoreSize(CI->getType());
+    for (unsigned i = 0; i < Size; i += 8)
+      writeStaticBytes(Address + i, V.getRawData()[i / 8],
+                       std::min(Size - i, 8U));
+    return;
+  }
+
+  if (const ConstantFP *CFP = dyn_cast<ConstantFP>(C)) {
+    if (CFP->getType()->isFloatTy())
+      writeStaticBytes(Address, FloatToBits(CFP->getValueAPF().convertToFloat()),
+                       4);
+    else if (CFP->getType()->isDoubleTy())
+      writeStaticBytes(Address,
+                       DoubleToBits(CFP->getValueAPF().convertToDouble()), 8);
+    else
+      unsupportedJs(C, "floating point type");
+    return;
+  }
+
+  if (isa<ConstantArray>(C) || isa<ConstantVector>(C)) {
+    const SequentialType *Ty = cast<SequentialType>(C->getType());
+    uint64_t Size = TD->getTypeAllocSize(Ty->getElementType());
+    for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+      layoutConstant(cast<Constant>(C->getOperand(i)), Address + i * Size);
+    return;
+  }
+
+  if (const ConstantStruct *CS = dyn_cast<ConstantStruct>(C)) {
+    const StructLayout *SL = TD->getStructLayout(CS->getType());
+    for (unsigned i = 0, e = CS->getNumOperands(); i != e; ++i)
+      layoutConstant(CS->getOperand(i), Address + SL->getElementOffset(i));
+    return;
+  }
+
+  const GlobalValue *Base;
+  int64_t Offset;
+  if (!evaluateAddress(C, Base, Offset))
+    unsupportedJs(C, "constant in a global initializer");
+  if (Base) {
+    JsRelocation R = { Address, Base, Offset };
+    Relocations.push_back(R);
+    return;
+  }
+  writeStaticBytes(Address, Offset, TD->getTypeStoreSize(C->getType()));
+}
+
+/// evaluateAddress - Evaluate the given constant as an offset from the global
+/// Base, which is not in the static data, or as a plain number if Base is
+/// null.  Returns false if the constant is not an address or an integer.
+bool JsWriter::evaluateAddress(const Constant *C, const GlobalValue *&Base,
+                               int64_t &Offset) {
+  Base = 0;
+  Offset = 0;
+  if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(C)) {
+    const GlobalValue *GV = GA->resolveAliasedGlobal(false);
+    return GV && evaluateAddress(GV, Base, Offset);
+  }
+  if (const Function *F = dyn_cast<Function>(C)) {
+    // The intertype relocates function pointers, having no function table.
+    if (!CodeGen) {
+      Base = F;
+      return true;
+    }
+    DenseMap<const Function*, unsigned>::const_iterator I =
+      FunctionIndices.find(F);
+    if (I == FunctionIndices.end())
+      return false;
+    Offset = I->second;
+    return true;
+  }
+  if (const GlobalVariable *GV = dyn_cast<GlobalVariable>(C)) {
+    DenseMap<const GlobalValue*, uint64_t>::const_iterator I =
+      GlobalAddresses.find(GV);
+    if (I == GlobalAddresses.end())
+      Base = GV;
+    else
+      Offset = I->second;
+    return true;
+  }
+  if (isa<ConstantPointerNull>(C))
+    return true;
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+    if (CI->getBitWidth() > 64)
+      return false;
+    Offset = CI->getBitWidth() == 1 ? CI->getZExtValue() : CI->getSExtValue();
+    return true;
+  }
+
+  const ConstantExpr *CE = dyn_cast<ConstantExpr>(C);
+  if (!CE)
+    return false;
+  switch (CE->getOpcode()) {
+  case Instruction::BitCast:
+  case Instruction::IntToPtr:
+    return evaluateAddress(CE->getOperand(0), Base, Offset);
+  case Instruction::PtrToInt:
+    if (getJsIntWidth(CE->getType()) < 32)
+      return false;
+    return evaluateAddress(CE->getOperand(0), Base, Offset);
+  case Instruction::GetElementPtr: {
+    if (!evaluateAddress(CE->getOperand(0), Base, Offset))
+      return false;
+    SmallVector<Value*, 8> Indices(CE->op_begin() + 1, CE->op_end());
+    for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+      if (!isa<ConstantInt>(Indices[i]))
+        return false;
+    if (!Indices.empty())
+      Offset += TD->getIndexedOffset(CE->getOperand(0)->getType(),
+                                     &Indices[0], Indices.size());
+    return true;
+  }
+  case Instruction::Add:
+  case Instruction::Sub: {
+    const GlobalValue *LHSBase, *RHSBase;
+    int64_t LHS, RHS;
+    if (!evaluateAddress(CE->getOperand(0), LHSBase, LHS) ||
+        !evaluateAddress(CE->getOperand(1), RHSBase, RHS))
+      return false;
+    if (CE->getOpcode() == Instruction::Add) {
+      if (LHSBase && RHSBase)
+        return false;
+      Base = LHSBase ? LHSBase : RHSBase;
+      Offset = LHS + RHS;
+    } else {
+      if (RHSBase && RHSBase != LHSBase)
+        return false;
+      Base = RHSBase ? 0 : LHSBase;
+      Offset = LHS - RHS;
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+/// printJsPreamble - Output the start of the module: the heap views, the
+/// runtime functions used by the generated code, and the initial stack top.
+void JsWriter::printJsPreamble(raw_ostream &Out) {
+  Out << "var JsModule = function(global, env, buffer) {\n"
+          "var HEAP8 = new global.Int8Array(buffer);\n"
+          "var HEAP16 = new global.Int16Array(buffer);\n"
+          "var HEAP32 = new global.Int32Array(buffer);\n"
+          "var HEAPU8 = new global.Uint8Array(buffer);\n"
+          "var HEAPU16 = new global.Uint16Array(buffer);\n"
+          "var HEAPU32 = new global.Uint32Array(buffer);\n"
+          "var HEAPF32 = new global.Float32Array(buffer);\n"
+          "var HEAPF64 = new global.Float64Array(buffer);\n"
+          "var Math_imul = global.Math.imul;\n"
+          "var Math_fround = global.Math.fround;\n"
+          "var Math_floor = global.Math.floor;\n"
+          "var abort = env.abort;\n"
+          "var tempDoublePtr = " << (unsigned)JS_TEMP_DOUBLE_PTR << ";\n"
+          "var STACKTOP = " << StackBase << ";\n";
+  // Direct eval runs the code of a chunk in the scope of the module.
+  if (!JsSplit.empty())
+    Out << "var loadedChunks = [];\n"
+            "function loadChunk(chunk) { chunk = chunk|0; "
+            "if (!loadedChunks[chunk]) { loadedChunks[chunk] = 1; "
+            "eval(env.loadChunk(chunk)); } }\n";
+  // Decodes the base64 static data of -js-mem-init into the heap at p.
+  if (JsMemInit && JsMemInitFile.empty())
+    Out << "function base64Decode(s, p) { var i = 0, c = 0, b = 0, n = 0; "
+            "for (; i < s.length; i++) { c = s.charCodeAt(i); "
+            "if (c == 61) break; c = c >= 97 ? c - 71 : c >= 65 ? c - 65 : "
+            "c >= 48 ? c + 4 : c == 43 ? 62 : 63; "
+            "b = (b << 6 | c) & 4095; n += 6; "
+            "if (n >= 8) { n -= 8; HEAPU8[p++] = b >> n; } } }\n";
+
+  // The i64 runtime, on i64 values approximated by doubles.
+  Out << "function i64_hi(a) { a = +a; return ~~Math_floor(a / 4294967296.0); }\n"
+          "function i64_make(lo, hi) { lo = lo|0; hi = hi|0; "
+          "return +(lo>>>0) + 4294967296.0*+(hi|0); }\n"
+          "function i64_u(a) { a = +a; "
+          "return a < 0.0 ? a + 18446744073709551616.0 : a; }\n"
+          "function i64_s(a) { a = +a; "
+          "return a >= 9223372036854775808.0 ? a - 18446744073709551616.0 : a; }\n"
+          "function i64_trunc(a) { a = +a; "
+          "return a < 0.0 ? -Math_floor(-a) : Math_floor(a); }\n"
+          "function i64_sdiv(a, b) { return i64_trunc(a / b); }\n"
+          "function i64_udiv(a, b) { "
+          "return i64_s(Math_floor(i64_u(a) / i64_u(b))); }\n"
+          "function i64_urem(a, b) { return i64_s(i64_u(a) % i64_u(b)); }\n"
+          "function i64_and(a, b) { "
+          "return i64_make(a & b, i64_hi(a) & i64_hi(b)); }\n"
+          "function i64_or(a, b) { "
+          "return i64_make(a | b, i64_hi(a) | i64_hi(b)); }\n"
+          "function i64_xor(a, b) { "
+          "return i64_make(a ^ b, i64_hi(a) ^ i64_hi(b)); }\n"
+          "function i64_shl(a, n) { var lo = ~~a, hi = i64_hi(a); n = ~~n & 63; "
+          "if (n == 0) return +a; "
+          "if (n < 32) return i64_make(lo << n, hi << n | lo >>> (32 - n)); "
+          "return i64_make(0, lo << (n - 32)); }\n"
+          "function i64_lshr(a, n) { var lo = ~~a, hi = i64_hi(a); n = ~~n & 63; "
+          "if (n == 0) return +a; "
+          "if (n < 32) return i64_make(lo >>> n | hi << (32 - n), hi >>> n); "
+          "return i64_make(hi >>> (n - 32), 0); }\n"
+          "function i64_ashr(a, n) { var lo = ~~a, hi = i64_hi(a); n = ~~n & 63; "
+          "if (n == 0) return +a; "
+          "if (n < 32) return i64_make(lo >>> n | hi << (32 - n), hi >> n); "
+          "return i64_make(hi >> (n - 32), hi >> 31); }\n";
+
+  // The division of the i64 legalization, on halves: the quotient or the
+  // remainder, signed or not, of ahi:alo by bhi:blo.  Like the functions
+  // that return an i64, it returns the low half and stores the high half at
+  // JS_TEMP_RET_PTR.  Values below 2^53 are divided as doubles, the others
+  // bit by bit.
+  std::string TempRet = "HEAP32[" + utostr(JS_TEMP_RET_PTR >> 2) + "]";
+  Out << "function i64_divmod(alo, ahi, blo, bhi, sgn, rem) { "
+         "var qneg = 0, rneg = 0, a = 0.0, b = 0.0, r = 0.0, "
+         "qlo = 0, qhi = 0, rlo = 0, rhi = 0, c = 0, i = 0; "
+         "if (sgn && (ahi|0) < 0) { qneg = rneg = 1; "
+         "ahi = ~ahi + (alo == 0) | 0; alo = -alo|0; } "
+         "if (sgn && (bhi|0) < 0) { qneg ^= 1; "
+         "bhi = ~bhi + (blo == 0) | 0; blo = -blo|0; } "
+         "if ((ahi>>>0) < 2097152 && (bhi>>>0) < 2097152) { "
+         "a = (ahi>>>0)*4294967296.0 + (alo>>>0); "
+         "b = (bhi>>>0)*4294967296.0 + (blo>>>0); "
+         "r = a % b; a = rem ? r : (a - r) / b; "
+         "rlo = a|0; rhi = a / 4294967296.0 | 0; } else { "
+         "for (i = 63; i >= 0; i--) { c = rhi >>> 31; "
+         "rhi = rhi << 1 | rlo >>> 31; "
+         "rlo = rlo << 1 | (i >= 32 ? ahi >>> (i - 32) : alo >>> i) & 1; "
+         "if (c || (rhi>>>0) > (bhi>>>0) || "
+         "rhi == bhi && (rlo>>>0) >= (blo>>>0)) { "
+         "rhi = rhi - bhi - ((rlo>>>0) < (blo>>>0)) | 0; rlo = rlo - blo | 0; "
+         "if (i >= 32) qhi |= 1 << (i - 32); else qlo |= 1 << i; } } "
+         "if (!rem) { rlo = qlo; rhi = qhi; } } "
+         "if (rem ? rneg : qneg) { rhi = ~rhi + (rlo == 0) | 0; "
+         "rlo = -rlo|0; } "
+      << TempRet << " = rhi; return rlo|0; }\n";
+}
+
+/// printJsEpilogue - Output the end of the module: the imported symbols, the
+/// static data, the function table and the exported functions.
+void JsWriter::printJsEpilogue(Module &M) {
+  // Intrinsic lowering may have added declarations, so the imports are only
+  // known now.  Being assigned before the module returns, they are set
+  // before any generated function can run.  The runtime helpers of the i64
+  // legalization are declared as intrinsics too.
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->getName().startswith("llvm.") && isJsImport(F))
+      FOut << "var " << getJsName(F) << " = env." << getJsName(F) << ";\n";
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (isJsImport(I))
+      FOut << "var " << getJsName(I) << " = env." << getJsName(I) << "|0;\n";
+  if (const Function *Selector =
+        M.getFunction(Intrinsic::getName(Intrinsic::eh_selector)))
+    if (isJsImport(Selector))
+      FOut << "var eh_selector = env.eh_selector;\n";
+
+  // Trailing zeros need not be written, the heap starts out zeroed.
+  size_t Size = StaticData.size();
+  while (Size && !StaticData[Size - 1])
+    --Size;
+  // With -js-mem-init the data is a base64 string or a file that the
+  // environment loads, instead of an array literal of 3 to 4 bytes a byte.
+  if (JsMemInit && !JsMemInitFile.empty()) {
+    writeMemoryImageFile(Size);
+    if (Size) {
+      FOut << "HEAPU8.set(new global.Uint8Array(env.loadMemoryImage(\"";
+      FOut.write_escaped(JsMemInitFile);
+      FOut << "\")), " << (unsigned)JS_GLOBAL_BASE << ");\n";
+    }
+  } else if (JsMemInit && Size) {
+    FOut << "base64Decode(\"";
+    writeBase64(FOut, &StaticData[0], Size);
+    FOut << "\", " << (unsigned)JS_GLOBAL_BASE << ");\n";
+  } else if (Size) {
+    FOut << "HEAPU8.set([";
+    for (size_t i = 0; i != Size; ++i) {
+      if (i)
+        FOut << ',';
+      FOut << (unsigned)StaticData[i];
+    }
+    FOut << "], " << (unsigned)JS_GLOBAL_BASE << ");\n";
+  }
+  for (unsigned i = 0, e = Relocations.size(); i != e; ++i) {
+    const JsRelocation &R = Relocations[i];
+    std::string Value = getJsName(R.Target);
+    if (R.Offset)
+      Value = "(" + Value + " + " + formatJsInt(R.Offset) + ")|0";
+    FOut << "HEAP32[" << R.Address << " >> 2] = " << Value << ";\n";
+  }
+
+  for (std::map<std::string, std::vector<const Function*> >::iterator
+       I = FunctionTables.begin(), E = FunctionTables.end(); I != E; ++I) {
+    const std::vector<const Function*> &Table = I->second;
+    FOut << "var FUNCTION_TABLE_" << I->first << " = [";
+    for (unsigned i = 0, e = Table.size(); i != e; ++i)
+      FOut << (i ? ", " : "") << (Table[i] ? getJsName(Table[i]) : "abort");
+    FOut << "];\n";
+  }
+
+  FOut << "return {";
+  bool First = true;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (isJsDefinition(F) && !F->hasLocalLinkage() &&
+        !F->hasAvailableExternallyLinkage()) {
+      FOut << (First ? " " : ", ") << getJsName(F) << ": " << getJsName(F);
+      First = false;
+    }
+  FOut << " };\n};\n";
+  if (SourceMap)
+    FOut << "//# sourceMappingURL=" << sys::path::filename(JsSourceMapFile)
+         << "\n";
+}
+
+/// splitModule - Partition the functions of M into the chunks of -js-split.
+void JsWriter::splitModule(Module &M) {
+  SmallPtrSet<const Function*, 32> Startup;
+  JsChunkPartition::findStartupFunctions(M, getAnalysis<ProfileInfo>(),
+                                         Startup);
+  Partition = new JsChunkPartition(M, Startup, JsSplitChunkSize);
+  ChunkFiles.resize(Partition->getNumChunks());
+}
+
+/// writeJsFunction - Output the code of the function F, whose instructions
+/// start at the given locations, or its stub if F is moved to a chunk.
+void JsWriter::writeJsFunction(const Function &F, StringRef Code,
+                               const std::vector<JsSourceLocation> &Locations) {
+  if (Partition && Partition->getChunk(&F))
+    printJsChunkFunction(F, Code);
+  else
+    writeJsCode(Code, &Locations);
+}
+
+/// writeJsCode - Output code of the module, and map the given locations in
+/// it in the source map.  Consecutive instructions with the same location
+/// share their mapping.
+void JsWriter::writeJsCode(StringRef Code,
+                           const std::vector<JsSourceLocation> *Locations) {
+  FOut << Code;
+  if (!SourceMap)
+    return;
+  uint64_t Offset = 0;
+  DebugLoc Prev;
+  for (unsigned i = 0, e = Locations ? Locations->size() : 0; i != e; ++i) {
+    const JsSourceLocation &L = (*Locations)[i];
+    if (L.Loc == Prev)
+      continue;
+    Prev = L.Loc;
+    DIScope Scope(L.Loc.getScope(TheModule->getContext()));
+    std::string Source = Scope.getFilename();
+    if (!Source.empty() && !sys::path::is_absolute(Source) &&
+        !Scope.getDirectory().empty())
+      Source = Scope.getDirectory().str() + "/" + Source;
+    SourceMap->addText(Code.slice(Offset, L.Offset));
+    Offset = L.Offset;
+    SourceMap->addMapping(Source, L.Loc.getLine(), L.Loc.getCol());
+  }
+  SourceMap->addText(Code.substr(Offset));
+}
+
+/// printJsChunkFunction - Output the stub of the function F, whose code is
+/// written to its chunk instead.  The stub loads the chunk, which replaces F
+/// and its entries in the function tables, and calls the replacement.
+void JsWriter::printJsChunkFunction(const Function &F, StringRef Code) {
+  unsigned Chunk = Partition->getChunk(&F);
+  std::string Name = getJsName(&F);
+  std::string Args;
+  for (Function::const_arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    Args += (AI == F.arg_begin() ? "" : ", ") + GetValueName(AI);
+  if (F.isVarArg())
+    Args += F.arg_empty() ? "args" : ", args";
+  writeJsCode("function " + Name + "(" + Args + ") {\n"
+              "  loadChunk(" + utostr(Chunk) + ");\n"
+              "  return " + Name + "(" + Args + ");\n"
+              "}\n", 0);
+
+  raw_fd_ostream *&File = ChunkFiles[Chunk];
+  if (!File) {
+    std::string FileName = JsSplit + utostr(Chunk) + ".js";
+    std::string Error;
+    File = new raw_fd_ostream(FileName.c_str(), Error);
+    if (!Error.empty())
+      report_fatal_error("Cannot open the javascript chunk '" + FileName +
+                         "': " + Error);
+  }
+  // Code is a function declaration, which is turned into an expression.
+  *File << Name << " = " << Code.substr(0, Code.size() - 1) << ";\n";
+  DenseMap<const Function*, unsigned>::const_iterator I =
+    FunctionIndices.find(&F);
+  if (I != FunctionIndices.end())
+    *File << "FUNCTION_TABLE_" << getJsSignature(F.getFunctionType()) << "["
+          << I->second << "] = " << Name << ";\n";
+}
+
+/// getJsName - Return the javascript name of the given function or imported
+/// global variable.  The prefix keeps it apart from the locals and from the
+/// names of the runtime, unless the name is minified.
+std::string JsWriter::getJsName(const GlobalValue *GV) {
+  // Minified names are never taken by locals or by the runtime.
+  if (MinifiedNames.count(GV))
+    return getGlobalName(GV);
+  return "_" + getGlobalName(GV);
+}
+
+/// getJsValue - Return an atomic expression for the given operand.
+std::string JsWriter::getJsValue(const Value *V) {
+  if (const Constant *C = dyn_cast<Constant>(V))
+    return getJsConstant(C);
+  return GetValueName(V);
+}
+
+std::string JsWriter::getJsConstant(const Constant *C) {
+  const Type *Ty = C->getType();
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+    if (CI->getBitWidth() > 64)
+      unsupportedJs(C, "integer type");
+    if (CI->getBitWidth() == 1)
+      return CI->isZero() ? "0" : "1";
+    return formatJsInt(CI->getSExtValue());
+  }
+
+  if (const ConstantFP *CFP = dyn_cast<ConstantFP>(C)) {
+    if (Ty->isFloatTy())
+      return "Math_fround(" +
+             formatJsDouble(CFP->getValueAPF().convertToFloat()) + ")";
+    if (!Ty->isDoubleTy())
+      unsupportedJs(C, "floating point type");
+    return formatJsDouble(CFP->getValueAPF().convertToDouble());
+  }
+
+  if (isa<UndefValue>(C) || isa<ConstantAggregateZero>(C)) {
+    if (!Ty->isSingleValueType() || Ty->isVectorTy())
+      unsupportedJs(C, "aggregate value");
+    return getJsZero(Ty);
+  }
+
+  const GlobalValue *Base;
+  int64_t Offset;
+  if (evaluateAddress(C, Base, Offset)) {
+    if (!Base)
+      return formatJsInt(Offset);
+    std::string Name = getJsName(Base);
+    if (!Offset)
+      return Name;
+    return "((" + Name + " + " + formatJsInt(Offset) + ")|0)";
+  }
+
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C))
+    return "(" + getJsExpr(CE, CE->getOpcode()) + ")";
+  unsupportedJs(C, "constant");
+  return "";
+}
+
+/// getJsExpr - Return the expression that computes the given instruction or
+/// constant expression.
+std::string JsWriter::getJsExpr(const User *U, unsigned Opcode) {
+  const Type *Ty = U->getType();
+
+  if (Instruction::isCast(Opcode))
+    return getJsCast(Opcode, U->getOperand(0), Ty);
+
+  switch (Opcode) {
+  case Instruction::GetElementPtr:
+    return getJsGEP(U);
+
+  case Instruction::Select: {
+    // Both values have the type of the result, except for the integer
+    // constants of the i64 doubles.
+    std::string Select = getJsValue(U->getOperand(0)) + " ? " +
+                         getJsValue(U->getOperand(1)) + " : " +
+                         getJsValue(U->getOperand(2));
+    return getJsIntWidth(Ty) == 64 ? coerceJs(Select, Ty) : Select;
+  }
+
+  case Instruction::ICmp: {
+    const Type *OpTy = U->getOperand(0)->getType();
+    unsigned Width = getJsIntWidth(OpTy);
+    if (!Width || Width > 64)
+      unsupportedJs(U, "comparison");
+    CmpInst::Predicate Predicate = isa<CmpInst>(U)
+      ? cast<CmpInst>(U)->getPredicate()
+      : (CmpInst::Predicate)cast<ConstantExpr>(U)->getPredicate();
+    std::string A = getJsValue(U->getOperand(0));
+    std::string B = getJsValue(U->getOperand(1));
+    if (ICmpInst::isUnsigned((ICmpInst::Predicate)Predicate)) {
+      A = unsignedJs(A, Width);
+      B = unsignedJs(B, Width);
+    }
+    const char *Op = 0;
+    switch (Predicate) {
+    case ICmpInst::ICMP_EQ:  Op = " == "; break;
+    case ICmpInst::ICMP_NE:  Op = " != "; break;
+    case ICmpInst::ICMP_SLT:
+    case ICmpInst::ICMP_ULT: Op = " < "; break;
+    case ICmpInst::ICMP_SLE:
+    case ICmpInst::ICMP_ULE: Op = " <= "; break;
+    case ICmpInst::ICMP_SGT:
+    case ICmpInst::ICMP_UGT: Op = " > "; break;
+    case ICmpInst::ICMP_SGE:
+    case ICmpInst::ICMP_UGE: Op = " >= "; break;
+    default: llvm_unreachable("Illegal ICmp predicate");
+    }
+    return "(" + A + Op + B + ")|0";
+  }
+
+  case Instruction::FCmp: {
+    CmpInst::Predicate Predicate = isa<CmpInst>(U)
+      ? cast<CmpInst>(U)->getPredicate()
+      : (CmpInst::Predicate)cast<ConstantExpr>(U)->getPredicate();
+    std::string A = getJsValue(U->getOperand(0));
+    std::string B = getJsValue(U->getOperand(1));
+    // The ordered comparisons of javascript are false if an operand is NaN,
+    // the unordered ones are their negated inverses.
+    switch (Predicate) {
+    case FCmpInst::FCMP_FALSE: return "0";
+    case FCmpInst::FCMP_TRUE:  return "1";
+    case FCmpInst::FCMP_OEQ:   return "(" + A + " == " + B + ")|0";
+    case FCmpInst::FCMP_OGT:   return "(" + A + " > " + B + ")|0";
+    case FCmpInst::FCMP_OGE:   return "(" + A + " >= " + B + ")|0";
+    case FCmpInst::FCMP_OLT:   return "(" + A + " < " + B + ")|0";
+    case FCmpInst::FCMP_OLE:   return "(" + A + " <= " + B + ")|0";
+    case FCmpInst::FCMP_ONE:
+      return "(" + A + " < " + B + ") | (" + A + " > " + B + ")";
+    case FCmpInst::FCMP_ORD:
+      return "(" + A + " == " + A + ") & (" + B + " == " + B + ")";
+    case FCmpInst::FCMP_UNO:
+      return "(" + A + " != " + A + ") | (" + B + " != " + B + ")";
+    case FCmpInst::FCMP_UEQ:
+      return "(" + A + " == " + B + ") | (" + A + " != " + A + ") | (" +
+             B + " != " + B + ")";
+    case FCmpInst::FCMP_UNE:   return "(" + A + " != " + B + ")|0";
+    case FCmpInst::FCMP_ULT:   return "(" + A + " >= " + B + ") ^ 1";
+    case FCmpInst::FCMP_ULE:   return "(" + A + " > " + B + ") ^ 1";
+    case FCmpInst::FCMP_UGT:   return "(" + A + " <= " + B + ") ^ 1";
+    case FCmpInst::FCMP_UGE:   return "(" + A + " < " + B + ") ^ 1";
+    default: llvm_unreachable("Illegal FCmp predicate");
+    }
+  }
+  }
+
+  if (!Instruction::isBinaryOp(Opcode))
+    unsupportedJs(U, "operation");
+
+  std::string A = getJsValue(U->getOperand(0));
+  std::string B = getJsValue(U->getOperand(1));
+  if (Ty->isFloatingPointTy()) {
+    const char *Op = 0;
+    switch (Opcode) {
+    case Instruction::FAdd: Op = " + "; break;
+    case Instruction::FSub: Op = " - "; break;
+    case Instruction::FMul: Op = " * "; break;
+    case Instruction::FDiv: Op = " / "; break;
+    case Instruction::FRem: Op = " % "; break;
+    default: llvm_unreachable("Illegal floating point opcode");
+    }
+    if (!Ty->isFloatTy() && !Ty->isDoubleTy())
+      unsupportedJs(U, "floating point type");
+    return coerceJs(A + Op + B, Ty);
+  }
+
+  unsigned Width = getJsIntWidth(Ty);
+  if (!Width || Width > 64)
+    unsupportedJs(U, "integer type");
+
+  if (Width == 64) {
+    switch (Opcode) {
+    case Instruction::Add:  return "+(" + A + " + " + B + ")";
+    case Instruction::Sub:  return "+(" + A + " - " + B + ")";
+    case Instruction::Mul:  return "+(" + A + " * " + B + ")";
+    case Instruction::SDiv: return "i64_sdiv(" + A + ", " + B + ")";
+    case Instruction::UDiv: return "i64_udiv(" + A + ", " + B + ")";
+    case Instruction::SRem: return "+(" + A + " % " + B + ")";
+    case Instruction::URem: return "i64_urem(" + A + ", " + B + ")";
+    case Instruction::And:  return "i64_and(" + A + ", " + B + ")";
+    case Instruction::Or:   return "i64_or(" + A + ", " + B + ")";
+    case Instruction::Xor:  return "i64_xor(" + A + ", " + B + ")";
+    case Instruction::Shl:  return "i64_shl(" + A + ", " + B + ")";
+    case Instruction::LShr: return "i64_lshr(" + A + ", " + B + ")";
+    case Instruction::AShr:
+      // The high word, which the i64 legalization reads from whole values.
+      if (const ConstantInt *CI = dyn_cast<ConstantInt>(U->getOperand(1)))
+        if (CI->getZExtValue() == 32)
+          return "+i64_hi(" + A + ")";
+      return "i64_ashr(" + A + ", " + B + ")";
+    default: llvm_unreachable("Illegal integer opcode");
+    }
+  }
+
+  switch (Opcode) {
+  case Instruction::Add:  return normalizeJs(A + " + " + B, Width);
+  case Instruction::Sub:  return normalizeJs(A + " - " + B, Width);
+  case Instruction::Mul:
+    return normalizeJs("Math_imul(" + A + ", " + B + ")", Width);
+  case Instruction::SDiv:
+    return normalizeJs("(" + A + " / " + B + ")|0", Width);
+  case Instruction::UDiv:
+    return normalizeJs("(" + unsignedJs(A, Width) + " / " +
+                       unsignedJs(B, Width) + ")|0", Width);
+  case Instruction::SRem:
+    return normalizeJs("(" + A + " % " + B + ")|0", Width);
+  case Instruction::URem:
+    return normalizeJs("(" + unsignedJs(A, Width) + " % " +
+                       unsignedJs(B, Width) + ")|0", Width);
+  // The bitwise operations preserve the sign extended form.
+  case Instruction::And:  return A + " & " + B;
+  case Instruction::Or:   return A + " | " + B;
+  case Instruction::Xor:  return A + " ^ " + B;
+  case Instruction::Shl:  return normalizeJs(A + " << " + B, Width);
+  case Instruction::LShr:
+    // ">>>" reads its left operand as unsigned 32-bit.
+    if (Width == 32)
+      return "(" + A + " >>> " + B + ")|0";
+    return normalizeJs(unsignedJs(A, Width) + " >>> " + B, Width);
+  case Instruction::AShr: return A + " >> " + B;
+  default: llvm_unreachable("Illegal integer opcode");
+  }
+  return "";
+}
+
+std::string JsWriter::getJsCast(unsigned Opcode, const Value *V,
+                                const Type *DstTy) {
+  const Type *SrcTy = V->getType();
+  std::string A = getJsValue(V);
+  unsigned SrcWidth = getJsIntWidth(SrcTy), DstWidth = getJsIntWidth(DstTy);
+  if (SrcWidth > 64 || DstWidth > 64 || SrcTy->isVectorTy() ||
+      DstTy->isVectorTy())
+    unsupportedJs(V, "cast operand");
+
+  switch (Opcode) {
+  case Instruction::Trunc:
+    // The truncating coercions also truncate the i64 doubles.
+    return normalizeJs(A, DstWidth);
+  case Instruction::ZExt:
+    if (DstWidth == 64)
+      return "+" + unsignedJs(A, SrcWidth);
+    return SrcWidth == 1 ? A : unsignedJs(A, SrcWidth);
+  case Instruction::SExt:
+    if (SrcWidth == 1)
+      return DstWidth == 64 ? "+(0 - " + A + ")" : "(0 - " + A + ")|0";
+    return DstWidth == 64 ? "+" + A : A;
+  case Instruction::FPTrunc:
+  case Instruction::FPExt:
+    return coerceJs(A, DstTy);
+  case Instruction::FPToSI:
+  case Instruction::FPToUI:
+    if (DstWidth == 64)
+      return "i64_trunc(" + A + ")";
+    if (DstWidth == 32)
+      return "~~" + A;
+    return normalizeJs("~~" + A, DstWidth);
+  case Instruction::SIToFP:
+    return coerceJs(A, DstTy);
+  case Instruction::UIToFP:
+    return coerceJs(unsignedJs(A, SrcWidth), DstTy);
+  case Instruction::PtrToInt:
+    if (DstWidth == 64)
+      return "+(" + A + ">>>0)";
+    return DstWidth == 32 ? A : normalizeJs(A, DstWidth);
+  case Instruction::IntToPtr:
+    if (SrcWidth == 64)
+      return A + "|0";
+    return SrcWidth == 32 ? A : unsignedJs(A, SrcWidth);
+  case Instruction::BitCast:
+    if (SrcTy == DstTy || (SrcTy->isPointerTy() && DstTy->isPointerTy()))
+      return A;
+    // Reinterpret the bits through the temporary double.
+    if (SrcTy->isFloatTy() && DstWidth == 32)
+      return "(HEAPF32[tempDoublePtr>>2] = " + A +
+             ", HEAP32[tempDoublePtr>>2]|0)";
+    if (SrcWidth == 32 && DstTy->isFloatTy())
+      return "(HEAP32[tempDoublePtr>>2] = " + A +
+             ", Math_fround(HEAPF32[tempDoublePtr>>2]))";
+    if (SrcTy->isDoubleTy() && DstWidth == 64)
+      return "(HEAPF64[tempDoublePtr>>3] = " + A +
+             ", +(HEAP32[tempDoublePtr>>2]>>>0) + "
+             "4294967296.0*+HEAP32[tempDoublePtr + 4 >> 2])";
+    if (SrcWidth == 64 && DstTy->isDoubleTy())
+      return "(HEAP32[tempDoublePtr>>2] = " + A +
+             "|0, HEAP32[tempDoublePtr + 4 >> 2] = i64_hi(" + A +
+             "), +HEAPF64[tempDoublePtr>>3])";
+    break;
+  default:
+    break;
+  }
+  unsupportedJs(V, "cast operand");
+  return "";
+}
+
+/// getJsGEP - Return the address computed by the given getelementptr, with
+/// its constant indices folded into a single offset.
+std::string JsWriter::getJsGEP(const User *U) {
+  std::string Expr = getJsValue(U->getOperand(0));
+  int64_t Offset = 0;
+  bool Variable = false;
+  for (gep_type_iterator GTI = gep_type_begin(U), E = gep_type_end(U);
+       GTI != E; ++GTI) {
+    const Value *Idx = GTI.getOperand();
+    if (const StructType *STy = dyn_cast<StructType>(*GTI)) {
+      unsigned Field = cast<ConstantInt>(Idx)->getZExtValue();
+      Offset += TD->getStructLayout(STy)->getElementOffset(Field);
+      continue;
+    }
+    uint64_t Size = TD->getTypeAllocSize(GTI.getIndexedType());
+    if (const ConstantInt *CI = dyn_cast<ConstantInt>(Idx)) {
+      Offset += CI->getSExtValue() * (int64_t)Size;
+      continue;
+    }
+    std::string Index = getJsValue(Idx);
+    if (getJsIntWidth(Idx->getType()) == 64)
+      Index = "(" + Index + "|0)";
+    if (Size == 0)
+      continue;
+    if (Size != 1) {
+      if (isPowerOf2_64(Size))
+        Index = "(" + Index + " << " + utostr(Log2_64(Size)) + ")";
+      else
+        Index = "Math_imul(" + Index + ", " + utostr(Size) + ")";
+    }
+    Expr += " + " + Index;
+    Variable = true;
+  }
+  // Addresses wrap around at 32 bits.
+  Offset = (int32_t)Offset;
+  if (Offset > 0)
+    Expr += " + " + itostr(Offset);
+  else if (Offset < 0)
+    Expr += " - " + itostr(-Offset);
+  else if (!Variable)
+    return Expr;
+  return "(" + Expr + ")|0";
+}
 
-  // print the basic blocks
-  Function::iterator BB = F.begin(), E = F.end();
-  if(BB != E) {
-    if (Loop *L = LI->getLoopFor(BB)) {
-      if (L->getHeader() == BB && L->getParentLoop() == 0)
-        printLoop(L);
+/// getJsLoad - Return the expression that loads a value of the given type
+/// from Ptr + Offset.  Values that are not naturally aligned are copied to
+/// the temporary double first, in units of their alignment.
+std::string JsWriter::getJsLoad(const Type *Ty, const std::string &Ptr,
+                                unsigned Offset, unsigned Align) {
+  if (getJsIntWidth(Ty) == 64) {
+    unsigned WordAlign = std::min(Align, 4U);
+    std::string Lo = getJsLoad(Type::getInt32Ty(Ty->getContext()), Ptr,
+                               Offset, WordAlign);
+    std::string Hi = getJsLoad(Type::getInt32Ty(Ty->getContext()), Ptr,
+                               Offset + 4, WordAlign);
+    return "+(" + parenJs(Lo) + ">>>0) + 4294967296.0*" + parenJs(Hi);
+  }
+
+  unsigned Shift;
+  const char *Heap = getJsHeap(Ty, Shift);
+  if (!Heap)
+    unsupportedJs(Constant::getNullValue(Ty), "memory access of type");
+  std::string Value;
+  if (Align >= (1U << Shift)) {
+    Value = getJsHeapElement(Heap, Shift, Ptr, Offset);
+  } else {
+    unsigned ChunkShift = Log2_32(Align);
+    const char *ChunkHeap = ChunkShift == 0 ? "HEAP8" :
+                            ChunkShift == 1 ? "HEAP16" : "HEAP32";
+    Value = "(";
+    for (unsigned i = 0, e = 1U << Shift; i < e; i += Align)
+      Value += getJsHeapElement(ChunkHeap, ChunkShift, "tempDoublePtr", i) +
+               " = " + getJsHeapElement(ChunkHeap, ChunkShift, Ptr,
+                                        Offset + i) + ", ";
+    Value += getJsHeapElement(Heap, Shift, "tempDoublePtr", 0) + ")";
+  }
+  if (Ty->isIntegerTy(1))
+    return Value + "&1";
+  return coerceJs(Value, Ty);
+}
+
+/// getJsStore - Return the statement that stores the atomic expression Val of
+/// the given type to Ptr + Offset.
+std::string JsWriter::getJsStore(const Type *Ty, const std::string &Ptr,
+                                 unsigned Offset, unsigned Align,
+                                 const std::string &Val) {
+  if (getJsIntWidth(Ty) == 64) {
+    unsigned WordAlign = std::min(Align, 4U);
+    const Type *WordTy = Type::getInt32Ty(Ty->getContext());
+    return getJsStore(WordTy, Ptr, Offset, WordAlign, "~~" + Val) + "; " +
+           getJsStore(WordTy, Ptr, Offset + 4, WordAlign,
+                      "i64_hi(" + Val + ")");
+  }
+
+  unsigned Shift;
+  const char *Heap = getJsHeap(Ty, Shift);
+  if (!Heap)
+    unsupportedJs(Constant::getNullValue(Ty), "memory access of type");
+  if (Align >= (1U << Shift))
+    return getJsHeapElement(Heap, Shift, Ptr, Offset) + " = " + Val;
+
+  unsigned ChunkShift = Log2_32(Align);
+  const char *ChunkHeap = ChunkShift == 0 ? "HEAP8" :
+                          ChunkShift == 1 ? "HEAP16" : "HEAP32";
+  std::string Code = getJsHeapElement(Heap, Shift, "tempDoublePtr", 0) +
+                     " = " + Val;
+  for (unsigned i = 0, e = 1U << Shift; i < e; i += Align)
+    Code += "; " + getJsHeapElement(ChunkHeap, ChunkShift, Ptr, Offset + i) +
+            " = " + getJsHeapElement(ChunkHeap, ChunkShift, "tempDoublePtr",
+                                     i);
+  return Code;
+}
+
+/// printJsAggregateStore - Output the stores of the scalar elements of the
+/// given aggregate constant, which is stored to Ptr + Offset.
+void JsWriter::printJsAggregateStore(const Constant *C, const std::string &Ptr,
+                                     unsigned Offset, unsigned Align,
+                                     const char *Indent, raw_ostream &Out) {
+  const Type *Ty = C->getType();
+  if (Ty->isSingleValueType()) {
+    Out << Indent << getJsStore(Ty, Ptr, Offset, MinAlign(Align, Offset),
+                                getJsConstant(C)) << ";\n";
+    return;
+  }
+  const CompositeType *CTy = cast<CompositeType>(Ty);
+  const StructType *STy = dyn_cast<StructType>(Ty);
+  unsigned NumElements = STy ? STy->getNumElements()
+                             : cast<ArrayType>(Ty)->getNumElements();
+  for (unsigned i = 0; i != NumElements; ++i) {
+    const Constant *Elt = isa<ConstantAggregateZero>(C) || isa<UndefValue>(C)
+      ? getNullValue(CTy->getTypeAtIndex(i))
+      : cast<Constant>(C->getOperand(i));
+    unsigned EltOffset = STy
+      ? TD->getStructLayout(STy)->getElementOffset(i)
+      : i * TD->getTypeAllocSize(CTy->getTypeAtIndex(i));
+    printJsAggregateStore(Elt, Ptr, Offset + EltOffset, Align, Indent, Out);
+  }
+}
+
+/// getJsAlignment - Return the alignment of a memory access, defaulting to
+/// the ABI alignment of its type.
+static unsigned getJsAlignment(const TargetData *TD, const Type *Ty,
+                               unsigned Align) {
+  return Align ? Align : TD->getABITypeAlignment(Ty);
+}
+
+static bool compareJsLocations(const JsSourceLocation &A,
+                               const JsSourceLocation &B) {
+  return A.Offset < B.Offset;
+}
+
+void JsWriter::printJsFunction(Function &F, const BlockList &Blocks,
+                               raw_ostream &Out,
+                               std::vector<JsSourceLocation> *Locations) {
+  JsRelooper Relooper(Blocks, Profile);
+  JsFrameLayout Frame(Blocks, TD, JsShareStackSlots);
+  JsFunctionState S;
+  S.Relooper = &Relooper;
+  S.Frame = &Frame;
+  S.UsesStack = false;
+  S.Indent = "  ";
+  S.Locations = Locations;
+
+  Out << "function " << getJsName(&F) << "(";
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    Out << (AI == F.arg_begin() ? "" : ", ") << GetValueName(AI);
+  if (F.isVarArg())
+    Out << (F.arg_empty() ? "" : ", ") << "args";
+  Out << ") {\n";
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI) {
+    std::string Name = GetValueName(AI);
+    Out << "  " << Name << " = " << coerceJs(Name, AI->getType()) << ";\n";
+  }
+  if (F.isVarArg())
+    Out << "  args = args|0;\n";
+
+  // Collect the locals, and find out whether the function uses the stack.
+  // Values that share a local are declared once.
+  std::string Locals;
+  std::set<std::string> Declared;
+  bool UsesArgBuffer = false, UsesExceptions = false;
+  for (BlockList::const_iterator BI = Blocks.begin(), BE = Blocks.end();
+       BI != BE; ++BI) {
+    unsigned NumPHIs = 0;
+    for (BasicBlock::iterator II = (*BI)->begin(), IE = (*BI)->end();
+         II != IE; ++II) {
+      if (isa<PHINode>(II))
+        ++NumPHIs;
+      if (isa<AllocaInst>(II))
+        S.UsesStack = true;
+      if (const IntrinsicInst *Intr = dyn_cast<IntrinsicInst>(II)) {
+        if (Intr->getIntrinsicID() == Intrinsic::stacksave)
+          S.UsesStack = true;
+        if (Intr->getIntrinsicID() == Intrinsic::eh_exception)
+          UsesExceptions = true;
+      }
+      if (const InvokeInst *Invoke = dyn_cast<InvokeInst>(II))
+        if (!Invoke->doesNotThrow())
+          UsesExceptions = true;
+      if (isa<UnwindInst>(II))
+        UsesExceptions = true;
+      // The variadic intrinsics, like llvm.eh.selector, take their arguments
+      // directly.
+      if ((isa<CallInst>(II) || isa<InvokeInst>(II)) &&
+          !isa<IntrinsicInst>(II)) {
+        CallSite CS(II);
+        const FunctionType *FTy = cast<FunctionType>(
+          cast<PointerType>(CS.getCalledValue()->getType())->getElementType());
+        if (FTy->isVarArg() && CS.arg_size() > FTy->getNumParams())
+          UsesArgBuffer = S.UsesStack = true;
+      }
+      if (II->getType()->isVoidTy())
+        continue;
+      std::string Name = GetValueName(II);
+      if (Declared.insert(Name).second)
+        Locals += ", " + Name + " = " + getJsZero(II->getType());
+    }
+    // Phis that are assigned together may need temporaries.
+    if (NumPHIs > 1)
+      for (BasicBlock::iterator II = (*BI)->begin(); isa<PHINode>(II); ++II) {
+        std::string Name = GetValueName(II) + "$phi";
+        if (Declared.insert(Name).second)
+          Locals += ", " + Name + " = " + getJsZero(II->getType());
+      }
+  }
+  if (UsesArgBuffer)
+    Locals += ", argbuf = 0";
+  if (S.UsesStack)
+    Locals += ", sp = 0";
+  if (Relooper.usesDispatch())
+    Locals += ", label = 0";
+  if (UsesExceptions)
+    Locals += ", exn = 0, ehsp = 0";
+
+  if (!Locals.empty())
+    Out << "  var " << StringRef(Locals).substr(2) << ";\n";
+  if (S.UsesStack)
+    Out << "  sp = STACKTOP;\n";
+  if (Frame.getFrameSize())
+    Out << "  STACKTOP = (STACKTOP + " << Frame.getFrameSize() << ")|0;\n";
+
+  printJsShape(Relooper.getRoot(), S, Out);
+  Out << "}\n";
+
+  // The code of a terminator comes before that of the shapes nested in it,
+  // but its location was recorded after theirs.
+  if (Locations)
+    std::stable_sort(Locations->begin(), Locations->end(),
+                     compareJsLocations);
+}
+
+/// printJsShape - Output a statement of the structured form of the current
+/// function.
+void JsWriter::printJsShape(const JsShape *Shape, JsFunctionState &S,
+                            raw_ostream &Out) {
+  std::string Indent = S.Indent;
+  switch (Shape->Kind) {
+  case JsShape::Simple: {
+    BasicBlock *BB = S.Relooper->getBlock(Shape->Node);
+    if (!BB) {
+      printJsDispatch(Shape, S, Out);
+      return;
+    }
+    for (BasicBlock::iterator II = BB->begin(), IE = --BB->end(); II != IE;
+         ++II) {
+      uint64_t Start = Out.tell();
+      printJsInstruction(*II, S, Out);
+      addJsLocation(*II, Start, S, Out);
+    }
+    uint64_t Start = Out.tell();
+    printJsTerminator(*BB->getTerminator(), Shape, S, Out);
+    addJsLocation(*BB->getTerminator(), Start, S, Out);
+    return;
+  }
+  case JsShape::Block:
+    Out << Indent << "L" << Shape->Label << ": {\n";
+    S.Indent += "  ";
+    printJsShape(Shape->Inner, S, Out);
+    S.Indent = Indent;
+    Out << Indent << "}\n";
+    printJsShape(Shape->Next, S, Out);
+    return;
+  case JsShape::Loop:
+    Out << Indent << "L" << Shape->Label << ": while (1) {\n";
+    S.Indent += "  ";
+    printJsShape(Shape->Inner, S, Out);
+    S.Indent = Indent;
+    Out << Indent << "}\n";
+    return;
+  }
+}
+
+/// printJsDispatch - Output a dispatch node of an irreducible region, which
+/// selects the entry of the region by the value of the label variable.
+void JsWriter::printJsDispatch(const JsShape *Shape, JsFunctionState &S,
+                               raw_ostream &Out) {
+  std::string Indent = S.Indent;
+  Out << Indent << "switch (label|0) {\n";
+  for (unsigned i = 0, e = Shape->Branches.size(); i != e; ++i) {
+    // The last entry is the default, so that control never falls through.
+    if (i + 1 == e)
+      Out << Indent << "default: {\n";
+    else
+      Out << Indent << "case "
+          << S.Relooper->getDispatchValue(Shape->Node, i) << ": {\n";
+    S.Indent = Indent + "  ";
+    printJsBranch(0, Shape->Branches[i], S, Out);
+    S.Indent = Indent;
+    Out << Indent << "}\n";
+  }
+  Out << Indent << "}\n";
+}
+
+/// addJsLocation - Record that the code of the instruction I, which was
+/// printed from the offset Start in the code of the function, starts after
+/// the indentation there.  Instructions that printed no code, or have no
+/// debug location, are left out.
+void JsWriter::addJsLocation(const Instruction &I, uint64_t Start,
+                             const JsFunctionState &S, raw_ostream &Out) {
+  if (!S.Locations || I.getDebugLoc().isUnknown() || Out.tell() == Start)
+    return;
+  JsSourceLocation L = { Start + S.Indent.size(), I.getDebugLoc() };
+  S.Locations->push_back(L);
+}
+
+void JsWriter::printJsInstruction(Instruction &I, const JsFunctionState &S,
+                                  raw_ostream &Out) {
+  const char *Indent = S.Indent.c_str();
+  switch (I.getOpcode()) {
+  case Instruction::PHI:
+    // Assigned on the edges that lead here.
+    return;
+
+  case Instruction::Alloca: {
+    const AllocaInst &AI = cast<AllocaInst>(I);
+    uint64_t Size = TD->getTypeAllocSize(AI.getAllocatedType());
+    unsigned Align = std::max(AI.getAlignment(),
+                              TD->getABITypeAlignment(AI.getAllocatedType()));
+    std::string Name = GetValueName(&I);
+    // The static allocas are in the frame, which starts at sp.
+    uint64_t Offset;
+    if (S.Frame->getOffset(&AI, Offset)) {
+      Out << Indent << Name << " = "
+          << (Offset ? "(sp + " + utostr(Offset) + ")|0" : "sp") << ";\n";
+      return;
+    }
+    // The stack top is kept 8 byte aligned.
+    if (Align > 8)
+      Out << Indent << "STACKTOP = (STACKTOP + " << (Align - 1) << ") & "
+          << -(int)Align << ";\n";
+    Out << Indent << Name << " = STACKTOP;\n";
+    if (const ConstantInt *CI = dyn_cast<ConstantInt>(AI.getArraySize())) {
+      Size = RoundUpToAlignment(Size * CI->getZExtValue(), 8);
+      Out << Indent << "STACKTOP = (STACKTOP + " << Size << ")|0;\n";
     } else {
-      printBasicBlock(BB);
+      std::string Count = getJsValue(AI.getArraySize());
+      Out << Indent << "STACKTOP = (STACKTOP + (Math_imul(" << Count << ", "
+          << Size << ") + 7 & -8))|0;\n";
     }
-    ++BB;
+    return;
   }
-  for(; BB != E; ++BB) {
-    if (Loop *L = LI->getLoopFor(BB)) {
-      if (L->getHeader() == BB && L->getParentLoop() == 0)
-        printLoop(L);
+
+  case Instruction::Load: {
+    const LoadInst &LI = cast<LoadInst>(I);
+    unsigned Align = getJsAlignment(TD, I.getType(), LI.getAlignment());
+    Out << Indent << GetValueName(&I) << " = "
+        << getJsLoad(I.getType(), getJsValue(LI.getPointerOperand()), 0, Align)
+        << ";\n";
+    return;
+  }
+
+  case Instruction::Store: {
+    const StoreInst &SI = cast<StoreInst>(I);
+    const Type *Ty = SI.getValueOperand()->getType();
+    unsigned Align = getJsAlignment(TD, Ty, SI.getAlignment());
+    if (!Ty->isSingleValueType()) {
+      const Constant *C = dyn_cast<Constant>(SI.getValueOperand());
+      if (!C)
+        unsupportedJs(&I, "aggregate value");
+      printJsAggregateStore(C, getJsValue(SI.getPointerOperand()), 0, Align,
+                            Indent, Out);
+      return;
+    }
+    Out << Indent
+        << getJsStore(Ty, getJsValue(SI.getPointerOperand()), 0, Align,
+                      getJsValue(SI.getValueOperand()))
+        << ";\n";
+    return;
+  }
+
+  case Instruction::Call:
+    printJsCall(I, S, Out);
+    return;
+
+  case Instruction::VAArg: {
+    // The va_list is a pointer to the next argument, in 4 byte slots.
+    const Type *Ty = I.getType();
+    std::string List = getJsValue(I.getOperand(0));
+    std::string Ptr = "(HEAP32[" + List + ">>2]|0)";
+    unsigned Align = std::max(TD->getABITypeAlignment(Ty), 4U);
+    if (Align > 4)
+      Ptr = "((" + Ptr + " + " + utostr(Align - 1) + ") & " +
+            itostr(-(int)Align) + ")";
+    uint64_t Size = RoundUpToAlignment(TD->getTypeAllocSize(Ty), 4);
+    Out << Indent << GetValueName(&I) << " = " << getJsLoad(Ty, Ptr, 0, 4)
+        << ";\n";
+    Out << Indent << "HEAP32[" << List << ">>2] = (" << Ptr << " + " << Size
+        << ")|0;\n";
+    return;
+  }
+
+  default:
+    if (!Instruction::isBinaryOp(I.getOpcode()) && !isa<CastInst>(I) &&
+        !isa<CmpInst>(I) && !isa<SelectInst>(I) &&
+        !isa<GetElementPtrInst>(I))
+      unsupportedJs(&I, "instruction");
+    Out << Indent << GetValueName(&I) << " = " << getJsExpr(&I, I.getOpcode())
+        << ";\n";
+    return;
+  }
+}
+
+/// printJsCall - Output a call, an invoke, or the implementation of one of
+/// the intrinsics that lowerIntrinsics left in place.
+void JsWriter::printJsCall(Instruction &I, const JsFunctionState &S,
+                           raw_ostream &Out) {
+  const char *Indent = S.Indent.c_str();
+  CallSite CS(&I);
+  const Value *Callee = CS.getCalledValue()->stripPointerCasts();
+  if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(Callee))
+    if (const GlobalValue *GV = GA->resolveAliasedGlobal(false))
+      Callee = GV;
+
+  if (const Function *F = dyn_cast<Function>(Callee)) {
+    switch (F->getIntrinsicID()) {
+    case Intrinsic::not_intrinsic:
+      // The i64 legalization declares its runtime helper as an intrinsic.
+      if (F->getName() == "llvm.js.i64.divmod") {
+        Out << Indent << GetValueName(&I) << " = i64_divmod(";
+        for (unsigned i = 0, e = CS.arg_size(); i != e; ++i)
+          Out << (i ? ", " : "") << getJsValue(CS.getArgument(i));
+        Out << ")|0;\n";
+        return;
+      }
+      break;
+    case Intrinsic::vastart:
+      Out << Indent << "HEAP32[" << getJsValue(CS.getArgument(0))
+          << ">>2] = args;\n";
+      return;
+    case Intrinsic::vacopy:
+      Out << Indent << "HEAP32[" << getJsValue(CS.getArgument(0))
+          << ">>2] = HEAP32[" << getJsValue(CS.getArgument(1)) << ">>2]|0;\n";
+      return;
+    case Intrinsic::stacksave:
+      Out << Indent << GetValueName(&I) << " = STACKTOP;\n";
+      return;
+    case Intrinsic::stackrestore:
+      Out << Indent << "STACKTOP = " << getJsValue(CS.getArgument(0))
+          << ";\n";
+      return;
+    case Intrinsic::objectsize:
+      // The size is unknown: 0 when asked for a minimum, -1 otherwise.
+      Out << Indent << GetValueName(&I) << " = "
+          << (cast<ConstantInt>(CS.getArgument(1))->isZero() ? "(-1)" : "0")
+          << ";\n";
+      return;
+    case Intrinsic::invariant_start:
+      Out << Indent << GetValueName(&I) << " = 0;\n";
+      return;
+    case Intrinsic::trap:
+      Out << Indent << "abort();\n";
+      return;
+    case Intrinsic::eh_exception:
+      Out << Indent << GetValueName(&I) << " = exn;\n";
+      return;
+    case Intrinsic::eh_selector:
+      // The runtime matches the exception against the clauses that follow
+      // the personality, and returns the type id of the matching catch
+      // clause, 0 for a cleanup, or a negative value for a filter.
+      Out << Indent << GetValueName(&I) << " = eh_selector("
+          << getJsValue(CS.getArgument(0));
+      for (unsigned i = 2, e = CS.arg_size(); i != e; ++i)
+        Out << ", " << getJsValue(CS.getArgument(i));
+      Out << ")|0;\n";
+      return;
+    case Intrinsic::eh_typeid_for:
+      // The type id of a type info is its address.
+      Out << Indent << GetValueName(&I) << " = "
+          << getJsValue(CS.getArgument(0)) << ";\n";
+      return;
+    case Intrinsic::memcpy:
+    case Intrinsic::memmove:
+    case Intrinsic::memset:
+      printJsMemIntrinsic(cast<MemIntrinsic>(I), Indent, Out);
+      return;
+    default:
+      // The remaining intrinsics have no effect here.
+      return;
+    }
+  }
+
+  const FunctionType *FTy = cast<FunctionType>(
+    cast<PointerType>(CS.getCalledValue()->getType())->getElementType());
+  std::string Call;
+  if (isa<Function>(Callee)) {
+    Call = getJsName(cast<GlobalValue>(Callee));
+  } else {
+    std::string Sig = getJsSignature(FTy);
+    std::map<std::string, std::vector<const Function*> >::const_iterator
+      Table = FunctionTables.find(Sig);
+    assert(Table != FunctionTables.end() && "Indirect call without a table!");
+    Call = "FUNCTION_TABLE_" + Sig + "[" + getJsValue(CS.getCalledValue()) +
+           " & " + utostr(Table->second.size() - 1) + "]";
+  }
+  Call += "(";
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    Call += (i ? ", " : "") + getJsValue(CS.getArgument(i));
+
+  // Store the variadic arguments in 4 byte slots on the stack, and pass a
+  // pointer to them.
+  if (FTy->isVarArg()) {
+    Call += FTy->getNumParams() ? ", " : "";
+    if (CS.arg_size() == FTy->getNumParams()) {
+      Call += "0";
     } else {
-      printBasicBlock(BB);
+      std::string Stores;
+      uint64_t Offset = 0;
+      for (unsigned i = FTy->getNumParams(), e = CS.arg_size(); i != e; ++i) {
+        const Value *Arg = CS.getArgument(i);
+        const Type *Ty = Arg->getType();
+        unsigned Align = std::max(TD->getABITypeAlignment(Ty), 4U);
+        Offset = RoundUpToAlignment(Offset, Align);
+        Stores += std::string(Indent) +
+                  getJsStore(Ty, "argbuf", Offset, Align, getJsValue(Arg)) +
+                  ";\n";
+        Offset += RoundUpToAlignment(TD->getTypeAllocSize(Ty), 4);
+      }
+      Out << Indent << "argbuf = STACKTOP;\n";
+      Out << Indent << "STACKTOP = (STACKTOP + "
+          << RoundUpToAlignment(Offset, 8) << ")|0;\n";
+      Out << Stores;
+      Call += "argbuf";
     }
   }
-  Out << "]}";
+  Call += ")";
+
+  const Type *RetTy = I.getType();
+  if (RetTy->isVoidTy())
+    Out << Indent << Call << ";\n";
+  else if (RetTy->isIntegerTy(1))
+    Out << Indent << GetValueName(&I) << " = " << Call << "&1;\n";
+  else
+    Out << Indent << GetValueName(&I) << " = " << coerceJs(Call, RetTy)
+        << ";\n";
+  if (FTy->isVarArg() && CS.arg_size() != FTy->getNumParams())
+    Out << Indent << "STACKTOP = argbuf;\n";
 }
 
-void JsWriter::printLoop(Loop *L) {
-  for (unsigned i = 0, e = L->getBlocks().size(); i != e; ++i) {
-    BasicBlock *BB = L->getBlocks()[i];
-    Loop *BBLoop = LI->getLoopFor(BB);
-    if (BBLoop == L)
-      printBasicBlock(BB);
-    else if (BB == BBLoop->getHeader() && BBLoop->getParentLoop() == L)
-      printLoop(BBLoop);
+/// printJsMemIntrinsic - Output a memcpy, memmove or memset.  Small ones of
+/// constant size are unrolled into stores of the widest units that their
+/// alignment allows, the others become bulk operations on the heap views:
+/// set and subarray, which copy as if through a temporary buffer and thus
+/// also implement memmove, and fill.  Aligned operations whose size is a
+/// multiple of 4 operate on HEAP32.
+void JsWriter::printJsMemIntrinsic(const MemIntrinsic &MI, const char *Indent,
+                                   raw_ostream &Out) {
+  std::string Dest = getJsValue(MI.getRawDest());
+  std::string Len = getJsValue(MI.getLength());
+  if (getJsIntWidth(MI.getLength()->getType()) == 64)
+    Len = "~~" + Len;
+  unsigned Align = std::max(MI.getAlignment(), 1U);
+  const ConstantInt *ConstLen = dyn_cast<ConstantInt>(MI.getLength());
+  uint64_t Size = ConstLen ? ConstLen->getZExtValue() : 0;
+  const MemSetInst *MS = dyn_cast<MemSetInst>(&MI);
+  const ConstantInt *ConstVal = MS ? dyn_cast<ConstantInt>(MS->getValue()) : 0;
+  std::string Src = MS ? getJsValue(MS->getValue())
+                       : getJsValue(cast<MemTransferInst>(MI).getRawSource());
+
+  if (ConstLen && Size == 0)
+    return;
+
+  // Overlapping memmoves would need the whole source to be read first.
+  if (ConstLen && Size <= JS_MEM_UNROLL_LIMIT && !isa<MemMoveInst>(MI) &&
+      (!MS || ConstVal)) {
+    uint32_t Byte = ConstVal ? ConstVal->getZExtValue() & 0xff : 0;
+    for (uint64_t Offset = 0; Offset != Size; ) {
+      unsigned Unit = std::min(std::min(Align, 4U), 1U << Log2_64(
+                                                         Size - Offset));
+      Unit = MinAlign(Unit, Offset);
+      unsigned Shift = Log2_32(Unit);
+      const char *Heap = Shift == 0 ? "HEAP8" : Shift == 1 ? "HEAP16"
+                                                           : "HEAP32";
+      std::string Value;
+      if (MS) {
+        uint32_t Splat = Byte * (0xffffffffU / 0xff);
+        Value = formatJsInt(Shift == 2 ? (int32_t)Splat :
+                            Shift == 1 ? (int16_t)Splat : (int8_t)Splat);
+      } else {
+        Value = getJsHeapElement(Heap, Shift, Src, Offset);
+      }
+      Out << Indent << getJsHeapElement(Heap, Shift, Dest, Offset) << " = "
+          << Value << ";\n";
+      Offset += Unit;
+    }
+    return;
   }
+
+  bool Words = Align >= 4 && ConstLen && Size % 4 == 0;
+  const char *Heap = Words ? "HEAP32" : "HEAPU8";
+  std::string End = "(" + Dest + " + " + Len + ")|0";
+  if (Words) {
+    Dest = Dest + ">>2";
+    End = "(" + End + ")>>2";
+  }
+  if (MS) {
+    // Only the low byte of the value is stored.  Words hold it in each of
+    // their bytes, which a variable value gets by a multiplication.
+    std::string Value;
+    if (ConstVal)
+      Value = formatJsInt(Words ?
+        (int32_t)((ConstVal->getZExtValue() & 0xff) * (0xffffffffU / 0xff)) :
+        (int32_t)(ConstVal->getZExtValue() & 0xff));
+    else if (Words)
+      Value = "Math_imul(" + Src + " & 255, 16843009)";
+    else
+      Value = Src;
+    Out << Indent << Heap << ".fill(" << Value << ", " << Dest << ", " << End
+        << ");\n";
+    return;
+  }
+  std::string SrcEnd = "(" + Src + " + " + Len + ")|0";
+  if (Words) {
+    Src = Src + ">>2";
+    SrcEnd = "(" + SrcEnd + ")>>2";
+  }
+  Out << Indent << Heap << ".set(" << Heap << ".subarray(" << Src << ", "
+      << SrcEnd << "), " << Dest << ");\n";
 }
 
-void JsWriter::printBasicBlock(BasicBlock *BB) {
-  // Output all of the instructions in the basic block...
-  for (BasicBlock::iterator II = BB->begin(), E = --BB->end(); II != E;
-       ++II, LineNumber++) {
-    Out << "{ \"ident\": \"" << GetValueName(II) << "\", ";
-    Out << "\"intertype\": \"" << II->getOpcodeName() << "\", ";
-    Out << "\"lineNum\": " << LineNumber << ", ";
-    Out << "\"operands\": ";
-    writeOperands(*II);
-    Out << "},\n";
+/// printJsBranch - Output the transfer of control from the block From along
+/// the branch B: the assignments of the phis of its destination, and the
+/// jump.  From is null for the branches of a dispatch node, whose phis have
+/// already been assigned on the way to it.
+void JsWriter::printJsBranch(BasicBlock *From, const JsBranch &B,
+                             JsFunctionState &S, raw_ostream &Out) {
+  const char *Indent = S.Indent.c_str();
+  // The phis are assigned in parallel.  The copies between values that share
+  // a local are left out, and the others are ordered so that every local is
+  // read before it is overwritten.  A cycle of copies is broken by saving a
+  // local in the temporary of its phi.
+  SmallVector<std::pair<std::string, std::string>, 8> Copies;
+  for (BasicBlock::iterator I = B.Dest->begin(); From && isa<PHINode>(I);
+       ++I) {
+    PHINode *PN = cast<PHINode>(I);
+    std::string Name = GetValueName(PN);
+    std::string Value = getJsValue(PN->getIncomingValueForBlock(From));
+    if (Name != Value)
+      Copies.push_back(std::make_pair(Name, Value));
   }
-  const TerminatorInst *terminator = BB->getTerminator();
-  Out << "{ \"intertype\": \"" << terminator->getOpcodeName() << "\", ";
-  Out << "\"lineNum\": " << LineNumber++ << ", ";
-  Out << "\"type\": \"" << terminator->getType()->getDescription() << "\", ";
-  Out << "\"operands\": ";
-  writeOperands(*terminator);
-  Out << "}";
+  while (!Copies.empty()) {
+    unsigned Ready = 0, e = Copies.size();
+    for (; Ready != e; ++Ready) {
+      unsigned j = 0;
+      while (j != e && (j == Ready || Copies[j].second != Copies[Ready].first))
+        ++j;
+      if (j == e)
+        break;
+    }
+    if (Ready == e) {
+      std::string Saved = Copies[0].first;
+      Out << Indent << Saved << "$phi = " << Saved << ";\n";
+      for (unsigned j = 1; j != e; ++j)
+        if (Copies[j].second == Saved)
+          Copies[j].second = Saved + "$phi";
+      Ready = 0;
+    }
+    Out << Indent << Copies[Ready].first << " = " << Copies[Ready].second
+        << ";\n";
+    Copies.erase(Copies.begin() + Ready);
+  }
+  if (B.SetLabel >= 0)
+    Out << Indent << "label = " << B.SetLabel << ";\n";
+  switch (B.Kind) {
+  case JsBranch::Break:
+    Out << Indent << "break L" << B.Label << ";\n";
+    return;
+  case JsBranch::Continue:
+    Out << Indent << "continue L" << B.Label << ";\n";
+    return;
+  case JsBranch::Nested:
+    printJsShape(B.Target, S, Out);
+    return;
+  }
+}
+
+/// printJsConditional - Output the two-way branch of BB on the condition
+/// Cond, "if (Cond) { True } else { False }".  Control never falls out of the
+/// code of a branch, so when the profile shows that one of the two is cold,
+/// only that one is nested in the if, and the hot one follows it as straight
+/// line code.
+void JsWriter::printJsConditional(BasicBlock *BB, const std::string &Cond,
+                                  const JsBranch &True, const JsBranch &False,
+                                  JsFunctionState &S, raw_ostream &Out) {
+  std::string Indent = S.Indent;
+  if (True.Cold != False.Cold) {
+    Out << Indent << "if (" << (True.Cold ? Cond : "!" + parenJs(Cond))
+        << ") {\n";
+    S.Indent = Indent + "  ";
+    printJsBranch(BB, True.Cold ? True : False, S, Out);
+    S.Indent = Indent;
+    Out << Indent << "}\n";
+    printJsBranch(BB, True.Cold ? False : True, S, Out);
+    return;
+  }
+  Out << Indent << "if (" << Cond << ") {\n";
+  S.Indent = Indent + "  ";
+  printJsBranch(BB, True, S, Out);
+  S.Indent = Indent;
+  Out << Indent << "} else {\n";
+  S.Indent = Indent + "  ";
+  printJsBranch(BB, False, S, Out);
+  S.Indent = Indent;
+  Out << Indent << "}\n";
+}
+
+static bool compareJsCaseRanges(const JsCaseRange &A,
+                                const JsCaseRange &B) {
+  return A.Low < B.Low;
+}
+
+/// getJsCaseTest - Return the test of Cond against the case values Low to
+/// High.  A range is tested with a single unsigned comparison.
+static std::string getJsCaseTest(const std::string &Cond, int64_t Low,
+                                 int64_t High) {
+  if (Low == High)
+    return Cond + " == " + formatJsInt(Low);
+  std::string Offset = Low ? "(" + Cond + " - " + formatJsInt(Low) + ")"
+                           : Cond;
+  return "(" + Offset + ">>>0) <= " + itostr(High - Low);
+}
+
+/// printJsSwitch - Output the switch SI, lowered in the way
+/// SelectionDAGBuilder lowers the switches of the native targets.  Its case
+/// values are sorted into ranges of consecutive values with the same
+/// destination, and printJsCaseTree tests them.  Control never falls out of
+/// the code of a branch, so the default destination simply follows the
+/// tests.  Switches on i64 values, which are doubles, are emitted as they
+/// are.
+void JsWriter::printJsSwitch(SwitchInst &SI, const JsShape *Shape,
+                             JsFunctionState &S, raw_ostream &Out) {
+  std::string Indent = S.Indent;
+  BasicBlock *BB = SI.getParent();
+  const std::vector<JsBranch> &Branches = Shape->Branches;
+  const Type *CondTy = SI.getCondition()->getType();
+  std::string Cond = getJsValue(SI.getCondition());
+
+  if (getJsIntWidth(CondTy) > 32) {
+    Out << Indent << "switch (" << coerceJs(Cond, CondTy) << ") {\n";
+    // Case 0 is the default destination.  Cases with the same destination
+    // share its code.
+    for (unsigned i = 1, e = SI.getNumCases(); i != e; ++i) {
+      BasicBlock *Succ = SI.getSuccessor(i);
+      bool Seen = false;
+      for (unsigned j = 1; j != i && !Seen; ++j)
+        Seen = SI.getSuccessor(j) == Succ;
+      if (Seen)
+        continue;
+      Out << Indent;
+      for (unsigned j = i; j != e; ++j)
+        if (SI.getSuccessor(j) == Succ)
+          Out << "case " << getJsConstant(SI.getCaseValue(j)) << ": ";
+      Out << "{\n";
+      S.Indent = Indent + "  ";
+      printJsBranch(BB, Branches[i], S, Out);
+      S.Indent = Indent;
+      Out << Indent << "}\n";
+    }
+    Out << Indent << "default: {\n";
+    S.Indent = Indent + "  ";
+    printJsBranch(BB, Branches[0], S, Out);
+    S.Indent = Indent;
+    Out << Indent << "}\n";
+    Out << Indent << "}\n";
+    return;
+  }
+
+  // i1 values are 0 or 1, and the narrower integers are sign extended.
+  std::vector<JsCaseRange> Ranges;
+  for (unsigned i = 1, e = SI.getNumCases(); i != e; ++i) {
+    const ConstantInt *CI = SI.getCaseValue(i);
+    JsCaseRange R;
+    R.Low = R.High = CI->getBitWidth() == 1 ? (int64_t)CI->getZExtValue()
+                                            : CI->getSExtValue();
+    R.Succ = i;
+    Ranges.push_back(R);
+  }
+  std::sort(Ranges.begin(), Ranges.end(), compareJsCaseRanges);
+  unsigned NumRanges = 0;
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i) {
+    if (NumRanges && Ranges[NumRanges - 1].High + 1 == Ranges[i].Low &&
+        SI.getSuccessor(Ranges[NumRanges - 1].Succ) ==
+          SI.getSuccessor(Ranges[i].Succ)) {
+      Ranges[NumRanges - 1].High = Ranges[i].High;
+      continue;
+    }
+    Ranges[NumRanges++] = Ranges[i];
+  }
+  Ranges.resize(NumRanges);
+
+  if (!Ranges.empty())
+    printJsCaseTree(BB, Cond, Ranges, 0, Ranges.size(), Shape, S, Out);
+  printJsBranch(BB, Branches[0], S, Out);
+}
+
+/// printJsCaseTree - Output the tests of Cond against the case ranges Begin
+/// to End, which fall out of their code if none of the cases is taken.  As in
+/// SelectionDAGBuilder, up to three ranges are compared one by one, the
+/// ranges that span fewer values than a mask has bits and that lead to at
+/// most three destinations are tested with masks, and ranges that are dense
+/// enough become a switch statement, which the engines compile into a jump
+/// table.  Other ranges are split in two where the gap between the values
+/// is widest compared to the density of the halves, and searched in a
+/// balanced binary tree.
+void JsWriter::printJsCaseTree(BasicBlock *BB, const std::string &Cond,
+                               const std::vector<JsCaseRange> &Ranges,
+                               unsigned Begin, unsigned End,
+                               const JsShape *Shape, JsFunctionState &S,
+                               raw_ostream &Out) {
+  std::string Indent = S.Indent;
+  std::string Nested = Indent + "  ";
+  const std::vector<JsBranch> &Branches = Shape->Branches;
+  const SwitchInst &SI = cast<SwitchInst>(*BB->getTerminator());
+  int64_t Low = Ranges[Begin].Low, High = Ranges[End - 1].High;
+
+  // The ranges of every destination, in the order of their first values.
+  std::vector<unsigned> Dests;
+  std::vector<std::vector<unsigned> > DestRanges;
+  uint64_t NumValues = 0;
+  unsigned NumCompares = 0;
+  for (unsigned i = Begin; i != End; ++i) {
+    unsigned d = 0;
+    while (d != Dests.size() &&
+           SI.getSuccessor(Dests[d]) != SI.getSuccessor(Ranges[i].Succ))
+      ++d;
+    if (d == Dests.size()) {
+      Dests.push_back(Ranges[i].Succ);
+      DestRanges.resize(d + 1);
+    }
+    DestRanges[d].push_back(i);
+    NumValues += Ranges[i].High - Ranges[i].Low + 1;
+    NumCompares += Ranges[i].Low == Ranges[i].High ? 1 : 2;
+  }
+
+  if (End - Begin <= 3) {
+    for (unsigned d = 0, de = Dests.size(); d != de; ++d) {
+      std::string Test;
+      for (unsigned r = 0, re = DestRanges[d].size(); r != re; ++r) {
+        const JsCaseRange &R = Ranges[DestRanges[d][r]];
+        Test += (r ? " | " : "") + getJsCaseTest(Cond, R.Low, R.High);
+      }
+      Out << Indent << "if (" << Test << ") {\n";
+      S.Indent = Nested;
+      printJsBranch(BB, Branches[Dests[d]], S, Out);
+      S.Indent = Indent;
+      Out << Indent << "}\n";
+    }
+    return;
+  }
+
+  uint64_t Span = High - Low + 1;
+  if (Span <= JS_BIT_TEST_WIDTH && Dests.size() <= 3 &&
+      ((Dests.size() == 1 && NumCompares >= 3) ||
+       (Dests.size() == 2 && NumCompares >= 5) ||
+       (Dests.size() == 3 && NumCompares >= 6))) {
+    // The values are counted from 0 if they all fit in the mask, which saves
+    // the subtraction.
+    int64_t Base = Low >= 0 && High < JS_BIT_TEST_WIDTH ? 0 : Low;
+    std::string Offset = Base ? "(" + Cond + " - " + formatJsInt(Base) + ")"
+                              : Cond;
+    // The destination with the most values is tested first.
+    std::vector<std::pair<unsigned, unsigned> > Masks;
+    for (unsigned d = 0, de = Dests.size(); d != de; ++d) {
+      uint32_t Mask = 0;
+      for (unsigned r = 0, re = DestRanges[d].size(); r != re; ++r) {
+        const JsCaseRange &R = Ranges[DestRanges[d][r]];
+        for (int64_t V = R.Low; V <= R.High; ++V)
+          Mask |= 1U << (V - Base);
+      }
+      Masks.push_back(std::make_pair(Mask, d));
+    }
+    for (unsigned i = 1, e = Masks.size(); i != e; ++i)
+      for (unsigned j = i; j && CountPopulation_32(Masks[j].first) >
+                                CountPopulation_32(Masks[j - 1].first); --j)
+        std::swap(Masks[j], Masks[j - 1]);
+
+    Out << Indent << "if ((" << Offset << ">>>0) <= " << (High - Base)
+        << ") {\n";
+    for (unsigned i = 0, e = Masks.size(); i != e; ++i) {
+      Out << Nested << "if ((1 << " << Offset << ") & "
+          << formatJsInt((int32_t)Masks[i].first) << ") {\n";
+      S.Indent = Nested + "  ";
+      printJsBranch(BB, Branches[Dests[Masks[i].second]], S, Out);
+      S.Indent = Indent;
+      Out << Nested << "}\n";
+    }
+    Out << Indent << "}\n";
+    return;
+  }
+
+  if (NumValues >= JS_MIN_JUMP_TABLE_SIZE &&
+      NumValues >= Span * JS_MIN_JUMP_TABLE_DENSITY) {
+    Out << Indent << "switch (" << Cond << "|0) {\n";
+    for (unsigned d = 0, de = Dests.size(); d != de; ++d) {
+      Out << Indent;
+      for (unsigned r = 0, re = DestRanges[d].size(); r != re; ++r) {
+        const JsCaseRange &R = Ranges[DestRanges[d][r]];
+        for (int64_t V = R.Low; V <= R.High; ++V)
+          Out << "case " << formatJsInt(V) << ": ";
+      }
+      Out << "{\n";
+      S.Indent = Nested;
+      printJsBranch(BB, Branches[Dests[d]], S, Out);
+      S.Indent = Indent;
+      Out << Indent << "}\n";
+    }
+    Out << Indent << "}\n";
+    return;
+  }
+
+  // Split before the range that maximizes the metric of
+  // SelectionDAGBuilder, starting from the middle.  A half of a single range
+  // is always dense, so each half keeps at least a quarter of the ranges,
+  // which bounds the depth of the tree.
+  unsigned Pivot = (Begin + End) / 2;
+  unsigned MinHalf = (End - Begin) / 4;
+  double BestMetric = 0;
+  uint64_t LeftValues = 0;
+  for (unsigned i = Begin; i + 1 != End; ++i) {
+    LeftValues += Ranges[i].High - Ranges[i].Low + 1;
+    if (i + 1 - Begin < MinHalf || End - (i + 1) < MinHalf)
+      continue;
+    uint64_t Gap = Ranges[i + 1].Low - Ranges[i].High;
+    double LeftDensity = (double)LeftValues / (Ranges[i].High - Low + 1);
+    double RightDensity = (double)(NumValues - LeftValues) /
+                          (High - Ranges[i + 1].Low + 1);
+    double Metric = Log2_64(Gap) * (LeftDensity + RightDensity);
+    if (Metric > BestMetric) {
+      BestMetric = Metric;
+      Pivot = i + 1;
+    }
+  }
+
+  Out << Indent << "if (" << Cond << " < " << formatJsInt(Ranges[Pivot].Low)
+      << ") {\n";
+  S.Indent = Nested;
+  printJsCaseTree(BB, Cond, Ranges, Begin, Pivot, Shape, S, Out);
+  S.Indent = Indent;
+  Out << Indent << "} else {\n";
+  S.Indent = Nested;
+  printJsCaseTree(BB, Cond, Ranges, Pivot, End, Shape, S, Out);
+  S.Indent = Indent;
+  Out << Indent << "}\n";
+}
+
+void JsWriter::printJsTerminator(TerminatorInst &I, const JsShape *Shape,
+                                 JsFunctionState &S, raw_ostream &Out) {
+  std::string Indent = S.Indent;
+  std::string Nested = Indent + "  ";
+  BasicBlock *BB = I.getParent();
+  const std::vector<JsBranch> &Branches = Shape->Branches;
+  switch (I.getOpcode()) {
+  case Instruction::Ret: {
+    if (S.UsesStack)
+      Out << Indent << "STACKTOP = sp;\n";
+    const ReturnInst &RI = cast<ReturnInst>(I);
+    if (!RI.getNumOperands()) {
+      Out << Indent << "return;\n";
+      return;
+    }
+    const Value *V = RI.getReturnValue();
+    Out << Indent << "return " << coerceJs(getJsValue(V), V->getType())
+        << ";\n";
+    return;
+  }
+
+  case Instruction::Br: {
+    const BranchInst &BI = cast<BranchInst>(I);
+    if (BI.isUnconditional()) {
+      printJsBranch(BB, Branches[0], S, Out);
+      return;
+    }
+    printJsConditional(BB, getJsValue(BI.getCondition()), Branches[0],
+                       Branches[1], S, Out);
+    return;
+  }
+
+  case Instruction::Switch:
+    printJsSwitch(cast<SwitchInst>(I), Shape, S, Out);
+    return;
+
+  case Instruction::Invoke: {
+    // Calls that cannot throw need no handler.
+    if (cast<InvokeInst>(I).doesNotThrow()) {
+      printJsCall(I, S, Out);
+      printJsBranch(BB, Branches[0], S, Out);
+      return;
+    }
+    // Only the exceptions of the program, the pointers that its runtime
+    // throws, are caught.  The frames that they unwound may have left
+    // STACKTOP anywhere.
+    Out << Indent << "exn = 0;\n";
+    Out << Indent << "ehsp = STACKTOP;\n";
+    Out << Indent << "try {\n";
+    S.Indent = Nested;
+    printJsCall(I, S, Out);
+    S.Indent = Indent;
+    Out << Indent << "} catch (e) {\n";
+    Out << Nested << "if (typeof e != \"number\") throw e;\n";
+    Out << Nested << "exn = e|0;\n";
+    Out << Nested << "STACKTOP = ehsp;\n";
+    Out << Indent << "}\n";
+    printJsConditional(BB, "exn", Branches[1], Branches[0], S, Out);
+    return;
+  }
+
+  case Instruction::Unwind:
+    // Resume the propagation of the exception that was caught last.  There
+    // is no exception to throw if none was, and throwing 0 would look like a
+    // normal return to the invoke that catches it.
+    Out << Indent << "if (!exn) abort();\n";
+    Out << Indent << "throw exn;\n";
+    return;
+
+  case Instruction::Unreachable: {
+    Out << Indent << "abort();\n";
+    // Control must not fall out of the labeled block or loop around the
+    // block.
+    const Type *RetTy = BB->getParent()->getReturnType();
+    Out << Indent << "return"
+        << (RetTy->isVoidTy() ? "" : " " + getJsZero(RetTy)) << ";\n";
+    return;
+  }
+
+  default:
+    unsupportedJs(&I, "instruction");
+  }
+}
+
+//===----------------------------------------------------------------------===//
+//                       Streaming emission
+//===----------------------------------------------------------------------===//
+
+namespace {
+  /// JsMaterializer - Read the bodies of a module that is read lazily, for
+  /// the passes that work on the whole module.  Without -js-stream it runs
+  /// before all the others.
+  class JsMaterializer : public ModulePass {
+  public:
+    static char ID;
+    JsMaterializer() : ModulePass(ID) {}
+
+    virtual const char *getPassName() const {
+      return "Javascript backend module reader";
+    }
+
+    virtual bool runOnModule(Module &M) {
+      std::string ErrInfo;
+      if (M.MaterializeAll(&ErrInfo))
+        report_fatal_error("Cannot read the module: " + ErrInfo);
+      return false;
+    }
+  };
+
+  /// JsStreamer - With -js-stream, emit the functions of a module that is
+  /// read lazily one at a time, so that the memory of the backend is that of
+  /// the module without its bodies plus the largest body, or the bodies of a
+  /// batch of -js-threads.  The namer has read every body once already, for
+  /// the facts of the whole module.  Each body is read again right before
+  /// the i64 legalization and the writer run on it, and the writer releases
+  /// it once it is written out.  A function whose type the i64 legalization
+  /// changes is only replaced at that point.
+  class JsStreamer : public ModulePass {
+    JsWriter *Writer;
+    bool Legalize;
+
+  public:
+    static char ID;
+    JsStreamer(JsWriter *W, bool Legalize)
+      : ModulePass(ID), Writer(W), Legalize(Legalize) {}
+
+    virtual const char *getPassName() const {
+      return "Javascript backend streaming emission";
+    }
+
+    virtual bool runOnModule(Module &M);
+  };
+}
+
+char JsMaterializer::ID = 0;
+char JsStreamer::ID = 0;
+
+bool JsStreamer::runOnModule(Module &M) {
+  // The pass manager owns the writer from here on.
+  FunctionPassManager FPM(&M);
+  if (const TargetData *TD = getAnalysisIfAvailable<TargetData>())
+    FPM.add(new TargetData(*TD));
+  if (Legalize)
+    FPM.add(createJsLegalizeI64Pass());
+  FPM.add(Writer);
+
+  FPM.doInitialization();
+  // The replaced functions are only deleted once no body is read any more,
+  // as the reader still knows them.
+  std::vector<Function*> Replaced;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ) {
+    Function *F = I++;
+    if (F->hasAvailableExternallyLinkage() ||
+        (F->isDeclaration() && !F->isMaterializable()))
+      continue;
+    std::string ErrInfo;
+    if (F->Materialize(&ErrInfo))
+      report_fatal_error("Cannot read the body of '" + F->getName() + "': " +
+                         ErrInfo);
+    if (Legalize)
+      if (Function *NF = legalizeJsI64Signature(F)) {
+        Writer->replaceFunction(F, NF);
+        Replaced.push_back(F);
+        F = NF;
+      }
+    FPM.run(*F);
+  }
+  FPM.doFinalization();
+
+  for (unsigned i = 0, e = Replaced.size(); i != e; ++i)
+    delete Replaced[i];
+  return true;
 }
 
 //===----------------------------------------------------------------------===//
 //                       External Interface declaration
 //===----------------------------------------------------------------------===//
 
+/// addJsScopeRestrictions - Internalize the symbols that are not listed in
+/// the file of -js-exports, as LTOCodeGenerator::applyScopeRestrictions does,
+/// so that the whole-program passes that follow can remove and optimize the
+/// code and data that the exports do not use.  The file holds the names of
+/// the symbols in the module, separated by whitespace.
+static void addJsScopeRestrictions(PassManagerBase &PM) {
+  error_code EC;
+  OwningPtr<MemoryBuffer> File(MemoryBuffer::getFile(JsExports.c_str(), EC));
+  if (!File)
+    report_fatal_error("Cannot open the javascript export list '" +
+                       JsExports + "': " + EC.message());
+
+  std::vector<std::string> Names(1, "main");
+  for (std::pair<StringRef, StringRef> Token = getToken(File->getBuffer());
+       !Token.first.empty(); Token = getToken(Token.second))
+    Names.push_back(Token.first);
+  std::vector<const char*> ExportList;
+  for (unsigned i = 0, e = Names.size(); i != e; ++i)
+    ExportList.push_back(Names[i].c_str());
+
+  PM.add(createInternalizePass(ExportList));
+  PM.add(createGlobalDCEPass());
+  PM.add(createGlobalOptimizerPass());
+  PM.add(createIPConstantPropagationPass());
+}
+
 bool JsTargetMachine::addPassesToEmitFile(PassManagerBase &PM,
 					  formatted_raw_ostream &o,
 					  CodeGenFileType FileType,
 					  CodeGenOpt::Level OptLevel,
 					  bool DisableVerify) {
-  if (FileType != TargetMachine::CGFT_AssemblyFile) return true;
+  // Object files hold the binary form of the intertype stream, which the code
+  // generator does not have.
+  if (FileType != TargetMachine::CGFT_AssemblyFile &&
+      FileType != TargetMachine::CGFT_ObjectFile) return true;
+  bool Binary = FileType == TargetMachine::CGFT_ObjectFile;
+  if (Binary && JsCodeGen)
+    return true;
+  // Streaming needs every pass ahead of the writer to work one function at a
+  // time.
+  if (JsStream) {
+    if (OptLevel != CodeGenOpt::None || !JsExports.empty() ||
+        (JsCodeGen && (!JsSplit.empty() || !JsProfile.empty() ||
+                       JsProfileInstrument)))
+      report_fatal_error("-js-stream is only supported at -O0, and without "
+                         "-js-exports, -js-split, -js-profile and "
+                         "-js-profile-instrument");
+    if (JsCodeGen && JsLegalizeI64)
+      PM.add(createJsLegalizeI64SignaturesPass());
+    JsBackendNameAllUsedStructsAndMergeFunctions *Namer =
+      new JsBackendNameAllUsedStructsAndMergeFunctions(JsTypeTable || Binary,
+                                                       true);
+    PM.add(Namer);
+    PM.add(new JsStreamer(new JsWriter(o, getTargetData(),
+                                       Namer->getTypeTable(),
+                                       Namer->getBodyFacts(), Binary,
+                                       JsCodeGen),
+                          JsCodeGen && JsLegalizeI64));
+    return false;
+  }
+
+  PM.add(new JsMaterializer());
+  if (!JsExports.empty())
+    addJsScopeRestrictions(PM);
+  JsBackendNameAllUsedStructsAndMergeFunctions *Namer;
   switch(OptLevel) {
   case CodeGenOpt::None:
-    PM.add(new JsBackendNameAllUsedStructsAndMergeFunctions());
-    PM.add(new JsWriter(o));
+    if (JsCodeGen && JsLegalizeI64) {
+      PM.add(createJsLegalizeI64SignaturesPass());
+      PM.add(createJsLegalizeI64Pass());
+    }
+    PM.add(Namer = new JsBackendNameAllUsedStructsAndMergeFunctions(
+                                             JsTypeTable || Binary, false));
+    if (JsCodeGen && JsProfileInstrument) {
+      PM.add(createOptimalEdgeProfilerPass());
+      PM.add(createJsProfilingPass());
+    }
+    if (JsCodeGen && !JsProfile.empty())
+      PM.add(createProfileLoaderPass(JsProfile));
+    PM.add(new JsWriter(o, getTargetData(), Namer->getTypeTable(), 0, Binary,
+                        JsCodeGen));
     break;
   default:
+    if (JsCodeGen)
+      PM.add(createJsCtorEvalPass(getTargetData()));
     PM.add(createGCLoweringPass());
-    PM.add(createLowerInvokePass());
-    PM.add(createCFGSimplificationPass());   // clean up after lower invoke.
-    PM.add(new JsBackendNameAllUsedStructsAndMergeFunctions());
-    PM.add(new JsWriter(o));
+    // The code generator keeps invokes, and emits them as try/catch regions.
+    // Those of calls that cannot throw are turned into plain calls first.
+    // The intertype has no invokes.
+    if (JsCodeGen)
+      PM.add(createPruneEHPass());
+    else
+      PM.add(createLowerInvokePass());
+    PM.add(createCFGSimplificationPass());   // clean up after lowering.
+    // Only the allocas that cannot be promoted to values are left in the
+    // stack frames.
+    if (JsCodeGen)
+      PM.add(createScalarReplAggregatesPass());
+    if (JsCodeGen && JsLegalizeI64) {
+      PM.add(createJsLegalizeI64SignaturesPass());
+      PM.add(createJsLegalizeI64Pass());
+    }
+    PM.add(Namer = new JsBackendNameAllUsedStructsAndMergeFunctions(
+                                             JsTypeTable || Binary, false));
+    if (JsCodeGen && JsProfileInstrument) {
+      PM.add(createOptimalEdgeProfilerPass());
+      PM.add(createJsProfilingPass());
+    }
+    if (JsCodeGen && !JsProfile.empty())
+      PM.add(createProfileLoaderPass(JsProfile));
+    PM.add(new JsWriter(o, getTargetData(), Namer->getTypeTable(), 0, Binary,
+                        JsCodeGen));
     PM.add(createGCInfoDeleter());
   }
 
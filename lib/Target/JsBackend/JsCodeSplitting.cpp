@@ -0,0 +1,189 @@
+//===-- JsCodeSplitting.cpp - Lazily loaded chunks of the JsBackend -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the partition of the functions of a module into the
+// chunks of the split output of the javascript code generator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsCodeSplitting.h"
+#include "llvm/Constants.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Support/CallSite.h"
+#include <vector>
+using namespace llvm;
+
+namespace {
+  /// JsCallNode - A defined function in the call graph of the partition, or
+  /// the root, which calls every function.
+  struct JsCallNode {
+    const Function *F;
+    unsigned Size;
+    std::vector<JsCallNode*> Callees;
+    std::vector<JsCallNode*> Callers;
+  };
+}
+
+namespace llvm {
+  template <> struct GraphTraits<JsCallNode*> {
+    typedef JsCallNode NodeType;
+    typedef std::vector<JsCallNode*>::iterator ChildIteratorType;
+
+    static NodeType *getEntryNode(JsCallNode *N) { return N; }
+    static ChildIteratorType child_begin(NodeType *N) {
+      return N->Callees.begin();
+    }
+    static ChildIteratorType child_end(NodeType *N) {
+      return N->Callees.end();
+    }
+  };
+}
+
+/// getDirectCallee - Return the function that the given instruction calls
+/// directly, or null if it is not a call or not a direct one.
+static const Function *getDirectCallee(const Instruction *I) {
+  ImmutableCallSite CS(I);
+  if (!CS)
+    return 0;
+  return dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+}
+
+JsChunkPartition::JsChunkPartition(Module &M,
+                               const SmallPtrSet<const Function*, 32> &Startup,
+                               unsigned ChunkSize)
+  : NumChunks(1) {
+  // Build the call graph of the defined functions.  The root makes every
+  // function reachable, and comes out as the last SCC.
+  std::vector<JsCallNode> Nodes;
+  DenseMap<const Function*, unsigned> Numbers;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration() && !F->hasAvailableExternallyLinkage()) {
+      Numbers[F] = Nodes.size();
+      Nodes.push_back(JsCallNode());
+      Nodes.back().F = F;
+      Nodes.back().Size = 0;
+    }
+  JsCallNode Root;
+  Root.F = 0;
+  Root.Size = 0;
+  for (unsigned i = 0, e = Nodes.size(); i != e; ++i) {
+    JsCallNode &N = Nodes[i];
+    Root.Callees.push_back(&N);
+    for (Function::const_iterator BB = N.F->begin(), BE = N.F->end();
+         BB != BE; ++BB)
+      for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end();
+           I != IE; ++I) {
+        ++N.Size;
+        DenseMap<const Function*, unsigned>::iterator Callee =
+          Numbers.find(getDirectCallee(I));
+        if (Callee == Numbers.end())
+          continue;
+        N.Callees.push_back(&Nodes[Callee->second]);
+        Nodes[Callee->second].Callers.push_back(&N);
+      }
+  }
+
+  // The SCCs come out from the callees to the callers, and are assigned in
+  // the reverse order, so that the callers of an SCC are assigned first.
+  std::vector<std::vector<JsCallNode*> > SCCs;
+  for (scc_iterator<JsCallNode*> I = scc_begin(&Root); !I.isAtEnd(); ++I)
+    if ((*I)[0] != &Root)
+      SCCs.push_back(*I);
+
+  std::vector<unsigned> ChunkSizes(1, 0);
+  unsigned OpenChunk = 0;
+  for (unsigned s = SCCs.size(); s-- != 0; ) {
+    const std::vector<JsCallNode*> &SCC = SCCs[s];
+    unsigned Size = 0;
+    bool IsStartup = false;
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+      Size += SCC[i]->Size;
+      IsStartup |= Startup.count(SCC[i]->F);
+    }
+    if (IsStartup)
+      continue;
+
+    // Find the chunk of the callers, ignoring the startup code and the calls
+    // within the SCC, which are not assigned yet.
+    unsigned CallerChunk = 0;
+    bool SingleCaller = true;
+    for (unsigned i = 0, e = SCC.size(); i != e && SingleCaller; ++i)
+      for (unsigned c = 0, ce = SCC[i]->Callers.size(); c != ce; ++c) {
+        unsigned Chunk = getChunk(SCC[i]->Callers[c]->F);
+        if (!Chunk || Chunk == CallerChunk)
+          continue;
+        if (CallerChunk) {
+          SingleCaller = false;
+          break;
+        }
+        CallerChunk = Chunk;
+      }
+
+    unsigned Chunk;
+    if (SingleCaller && CallerChunk &&
+        ChunkSizes[CallerChunk] + Size <= ChunkSize) {
+      Chunk = CallerChunk;
+    } else if (OpenChunk && ChunkSizes[OpenChunk] + Size <= ChunkSize) {
+      Chunk = OpenChunk;
+    } else {
+      Chunk = OpenChunk = NumChunks++;
+      ChunkSizes.push_back(0);
+    }
+    ChunkSizes[Chunk] += Size;
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i)
+      Chunks[SCC[i]->F] = Chunk;
+  }
+}
+
+void JsChunkPartition::findStartupFunctions(Module &M, ProfileInfo &PI,
+                                   SmallPtrSet<const Function*, 32> &Startup) {
+  // The functions that ran in the profile.
+  bool HasProfile = false;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    double Count = PI.getExecutionCount(F);
+    if (Count == ProfileInfo::MissingValue)
+      continue;
+    HasProfile = true;
+    if (Count > 0)
+      Startup.insert(F);
+  }
+  if (HasProfile)
+    return;
+
+  // Without a profile: main and the static constructors, and the functions
+  // that the startup functions always call.
+  std::vector<const Function*> Worklist;
+  if (const Function *Main = M.getFunction("main"))
+    Worklist.push_back(Main);
+  if (const GlobalVariable *Ctors = M.getNamedGlobal("llvm.global_ctors"))
+    if (Ctors->hasInitializer())
+      if (const ConstantArray *CA =
+            dyn_cast<ConstantArray>(Ctors->getInitializer()))
+        for (unsigned i = 0, e = CA->getNumOperands(); i != e; ++i)
+          if (const ConstantStruct *CS =
+                dyn_cast<ConstantStruct>(CA->getOperand(i)))
+            if (const Function *F = dyn_cast<Function>(
+                  CS->getOperand(1)->stripPointerCasts()))
+              Worklist.push_back(F);
+  while (!Worklist.empty()) {
+    const Function *F = Worklist.back();
+    Worklist.pop_back();
+    if (F->isDeclaration() || !Startup.insert(F))
+      continue;
+    const BasicBlock &Entry = F->getEntryBlock();
+    for (BasicBlock::const_iterator I = Entry.begin(), IE = Entry.end();
+         I != IE; ++I)
+      if (const Function *Callee = getDirectCallee(I))
+        Worklist.push_back(Callee);
+  }
+}
@@ -0,0 +1,71 @@
+//===-- JsCodeSplitting.h - Lazily loaded chunks of the JsBackend -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the code splitting of the javascript code generator,
+// which moves the functions that do not run at startup out of the main module
+// into chunks that are only loaded when one of their functions is first
+// called.
+//
+// The startup functions are those that the profile shows to have run or,
+// without a profile, main, the static constructors and the functions that
+// they always call, i.e. from their entry blocks, transitively.  They stay in
+// chunk 0, the main module, along with the whole call-graph SCCs that contain
+// them.
+//
+// The other SCCs are visited from the callers to the callees, and each joins
+// the chunk of its callers when they are all in a single cold chunk that has
+// room for it.  SCCs that are called from several chunks, or only from the
+// startup code, fill up the chunk that was opened last, and a new chunk is
+// opened when that one is full.  Most calls thus stay within their chunk, and
+// a chunk is loaded along with the code that its entry points call.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSCODESPLITTING_H
+#define JSCODESPLITTING_H
+
+#include "llvm/Analysis/ProfileInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace llvm {
+
+class Module;
+
+/// JsChunkPartition - An assignment of the defined functions of a module to
+/// the chunks of the split output of the code generator.
+class JsChunkPartition {
+  DenseMap<const Function*, unsigned> Chunks;
+  unsigned NumChunks;
+
+public:
+  /// JsChunkPartition - Partition the functions of M into chunks of about
+  /// ChunkSize instructions.  The functions in Startup stay in chunk 0.
+  JsChunkPartition(Module &M, const SmallPtrSet<const Function*, 32> &Startup,
+                   unsigned ChunkSize);
+
+  /// findStartupFunctions - Add the functions of M that run at startup to
+  /// Startup, according to the profile in PI if it has one.
+  static void findStartupFunctions(Module &M, ProfileInfo &PI,
+                                   SmallPtrSet<const Function*, 32> &Startup);
+
+  /// getChunk - Return the chunk of the given function, which is 0 if it
+  /// stays in the main module.
+  unsigned getChunk(const Function *F) const {
+    DenseMap<const Function*, unsigned>::const_iterator I = Chunks.find(F);
+    return I == Chunks.end() ? 0 : I->second;
+  }
+
+  /// getNumChunks - Return the number of chunks, including the main module.
+  unsigned getNumChunks() const { return NumChunks; }
+};
+
+} // End llvm namespace
+
+#endif
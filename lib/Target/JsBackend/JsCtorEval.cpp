@@ -0,0 +1,665 @@
+//===-- JsCtorEval.cpp - Static constructor evaluation of the JsBackend ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the evaluation of the static constructors of a module
+// for the javascript code generator.  The constructors that can be evaluated
+// at compile time are run on a model of the memory of the module, and their
+// stores are folded into the initializers of the global variables, which the
+// code generator emits as static data, so that the program does not run them
+// at startup.
+//
+// GlobalOpt evaluates constructors the same way, but gives up on loops, on
+// memory intrinsics and on stores of aggregates, which leaves out most of
+// the constructors of C++ tables.  Here the memory of a global is a tree of
+// values, which stays the initializer until a store splits out the elements
+// that it writes to, so that a store costs the depth of the accessed element
+// rather than the size of the global.  Addresses are resolved from their byte
+// offsets with the data layout, which handles the casts and the i8 arithmetic
+// of the frontends.  The evaluation of a constructor gives up after a fixed
+// number of instructions instead of at the first loop.
+//
+// The constructors are evaluated in the order in which they run, up to the
+// first one that cannot be, and the evaluated ones are removed from
+// llvm.global_ctors.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "js-ctor-eval"
+#include "JsTargetMachine.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumCtorsEvaluated, "Number of static constructors evaluated");
+STATISTIC(NumGlobalsInitialized, "Number of initializers folded from them");
+
+/// JS_CTOR_EVAL_STEPS - The number of instructions that the evaluation of a
+/// constructor may execute, including those of the functions it calls.
+static const unsigned JS_CTOR_EVAL_STEPS = 1 << 20;
+
+namespace {
+  /// JsMemoryValue - The value of a global variable, or of an element of one,
+  /// during the evaluation: a constant, or the values of the elements of an
+  /// aggregate once one of them was stored to.
+  struct JsMemoryValue {
+    Constant *Value;
+    std::vector<JsMemoryValue> Elements;
+
+    explicit JsMemoryValue(Constant *C = 0) : Value(C) {}
+  };
+
+  /// JsLocation - An accessed element of a global variable: the path of the
+  /// element indices from the global to the element, and its type.
+  struct JsLocation {
+    GlobalVariable *GV;
+    SmallVector<unsigned, 4> Path;
+    const Type *Ty;
+  };
+
+  class JsCtorEval : public ModulePass {
+    const TargetData *TargetLayout;
+    const TargetData *TD;
+
+    // The memory that the constructor wrote to, by global variable.  The
+    // values of the other globals are their initializers.
+    std::map<GlobalVariable*, JsMemoryValue> Memory;
+
+    // The globals that stand for the allocas of the evaluated functions,
+    // which are not part of the module.
+    std::vector<GlobalVariable*> Temporaries;
+    SmallPtrSet<GlobalVariable*, 8> IsTemporary;
+
+    // The constants that may be committed to the initializers.
+    SmallPtrSet<Constant*, 32> Committable;
+
+    std::vector<Function*> CallStack;
+    unsigned Steps;
+
+  public:
+    static char ID;
+    explicit JsCtorEval(const TargetData *Layout)
+      : ModulePass(ID), TargetLayout(Layout), TD(0) {}
+
+    virtual const char *getPassName() const {
+      return "Javascript static constructor evaluation";
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    bool evaluateCtor(Function *F);
+    bool evaluateFunction(Function *F, const SmallVectorImpl<Constant*> &Args,
+                          Constant *&RetVal);
+    bool evaluateMemIntrinsic(MemIntrinsic *MI,
+                              DenseMap<Value*, Constant*> &Values);
+
+    bool getLocation(Constant *Ptr, const Type *AccessTy, uint64_t Size,
+                     JsLocation &L);
+    Constant *load(const JsLocation &L);
+    bool store(const JsLocation &L, Constant *Val);
+    bool isCommittable(Constant *C);
+    void commit();
+    void releaseTemporaries();
+  };
+}
+
+char JsCtorEval::ID = 0;
+
+ModulePass *llvm::createJsCtorEvalPass(const TargetData *Layout) {
+  return new JsCtorEval(Layout);
+}
+
+static unsigned getNumElements(const Type *Ty) {
+  if (const StructType *STy = dyn_cast<StructType>(Ty))
+    return STy->getNumElements();
+  return cast<ArrayType>(Ty)->getNumElements();
+}
+
+static const Type *getElementType(const Type *Ty, unsigned i) {
+  if (const StructType *STy = dyn_cast<StructType>(Ty))
+    return STy->getElementType(i);
+  return cast<ArrayType>(Ty)->getElementType();
+}
+
+/// getElement - Return element i of the aggregate constant C, or null if C is
+/// a constant expression.
+static Constant *getElement(Constant *C, unsigned i) {
+  if (isa<ConstantArray>(C) || isa<ConstantStruct>(C))
+    return cast<Constant>(C->getOperand(i));
+  if (isa<UndefValue>(C))
+    return UndefValue::get(getElementType(C->getType(), i));
+  if (isa<ConstantAggregateZero>(C))
+    return Constant::getNullValue(getElementType(C->getType(), i));
+  return 0;
+}
+
+/// materialize - Return the constant of the given type that the memory value
+/// V holds.
+static Constant *materialize(const JsMemoryValue &V, const Type *Ty) {
+  if (V.Value)
+    return V.Value;
+  std::vector<Constant*> Elements;
+  Elements.reserve(V.Elements.size());
+  for (unsigned i = 0, e = V.Elements.size(); i != e; ++i)
+    Elements.push_back(materialize(V.Elements[i], getElementType(Ty, i)));
+  if (const StructType *STy = dyn_cast<StructType>(Ty))
+    return ConstantStruct::get(STy, Elements);
+  return ConstantArray::get(cast<ArrayType>(Ty), Elements);
+}
+
+/// getLocation - Find the element of a global variable that the pointer Ptr
+/// points to.  The element is the outermost one at the address that has the
+/// type AccessTy, or, if AccessTy is null, the given size.
+bool JsCtorEval::getLocation(Constant *Ptr, const Type *AccessTy,
+                             uint64_t Size, JsLocation &L) {
+  int64_t Offset = 0;
+  while (ConstantExpr *CE = dyn_cast<ConstantExpr>(Ptr)) {
+    if (CE->getOpcode() == Instruction::BitCast) {
+      Ptr = CE->getOperand(0);
+    } else if (CE->getOpcode() == Instruction::GetElementPtr) {
+      SmallVector<Value*, 8> Indices(CE->op_begin() + 1, CE->op_end());
+      for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+        if (!isa<ConstantInt>(Indices[i]))
+          return false;
+      Ptr = CE->getOperand(0);
+      Offset += (int64_t)TD->getIndexedOffset(Ptr->getType(), Indices.data(),
+                                              Indices.size());
+    } else {
+      return false;
+    }
+  }
+  L.GV = dyn_cast<GlobalVariable>(Ptr);
+  if (!L.GV)
+    return false;
+  L.Ty = L.GV->getType()->getElementType();
+  if (Offset < 0 || (uint64_t)Offset >= TD->getTypeAllocSize(L.Ty))
+    return false;
+
+  uint64_t Off = Offset;
+  while (Off || (AccessTy ? L.Ty != AccessTy
+                          : TD->getTypeAllocSize(L.Ty) != Size)) {
+    unsigned i;
+    if (const StructType *STy = dyn_cast<StructType>(L.Ty)) {
+      const StructLayout *SL = TD->getStructLayout(STy);
+      i = SL->getElementContainingOffset(Off);
+      Off -= SL->getElementOffset(i);
+    } else if (const ArrayType *ATy = dyn_cast<ArrayType>(L.Ty)) {
+      uint64_t EltSize = TD->getTypeAllocSize(ATy->getElementType());
+      if (!EltSize || Off / EltSize >= ATy->getNumElements())
+        return false;
+      i = Off / EltSize;
+      Off -= i * EltSize;
+    } else {
+      // A scalar accessed at an offset, or as another type.
+      return false;
+    }
+    L.Path.push_back(i);
+    L.Ty = getElementType(L.Ty, i);
+  }
+  return true;
+}
+
+/// load - Return the value of the given element, or null if it is not known.
+Constant *JsCtorEval::load(const JsLocation &L) {
+  std::map<GlobalVariable*, JsMemoryValue>::iterator I = Memory.find(L.GV);
+  if (I == Memory.end()) {
+    if (!L.GV->hasDefinitiveInitializer())
+      return 0;
+    Constant *C = L.GV->getInitializer();
+    for (unsigned i = 0, e = L.Path.size(); i != e && C; ++i)
+      C = getElement(C, L.Path[i]);
+    return C;
+  }
+
+  const JsMemoryValue *V = &I->second;
+  const Type *Ty = L.GV->getType()->getElementType();
+  unsigned i = 0, e = L.Path.size();
+  for (; i != e && !V->Value; ++i) {
+    V = &V->Elements[L.Path[i]];
+    Ty = getElementType(Ty, L.Path[i]);
+  }
+  if (!V->Value)
+    return materialize(*V, Ty);
+  Constant *C = V->Value;
+  for (; i != e && C; ++i)
+    C = getElement(C, L.Path[i]);
+  return C;
+}
+
+/// store - Write Val to the given element, splitting the values of the
+/// aggregates that contain it into their elements.  Return false if the
+/// store cannot be committed.
+bool JsCtorEval::store(const JsLocation &L, Constant *Val) {
+  bool Temporary = IsTemporary.count(L.GV);
+  if (!Temporary &&
+      (!L.GV->hasUniqueInitializer() || L.GV->isConstant() ||
+       !isCommittable(Val)))
+    return false;
+
+  std::map<GlobalVariable*, JsMemoryValue>::iterator I = Memory.find(L.GV);
+  if (I == Memory.end())
+    I = Memory.insert(std::make_pair(L.GV,
+                        JsMemoryValue(L.GV->getInitializer()))).first;
+
+  JsMemoryValue *V = &I->second;
+  const Type *Ty = L.GV->getType()->getElementType();
+  for (unsigned i = 0, e = L.Path.size(); i != e; ++i) {
+    if (V->Value) {
+      unsigned NumElements = getNumElements(Ty);
+      V->Elements.reserve(NumElements);
+      for (unsigned j = 0; j != NumElements; ++j) {
+        Constant *C = getElement(V->Value, j);
+        if (!C)
+          return false;
+        V->Elements.push_back(JsMemoryValue(C));
+      }
+      V->Value = 0;
+    }
+    V = &V->Elements[L.Path[i]];
+    Ty = getElementType(Ty, L.Path[i]);
+  }
+  V->Value = Val;
+  V->Elements.clear();
+  return true;
+}
+
+/// isCommittable - Whether the constant C may be part of an initializer: it
+/// must not refer to the allocas of the evaluation, and must be a constant
+/// that the code generator emits, as for GlobalOpt, whose relocations are an
+/// address and a constant offset.
+bool JsCtorEval::isCommittable(Constant *C) {
+  if (Committable.count(C))
+    return true;
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(C)) {
+    if (IsTemporary.count(GV))
+      return false;
+  } else if (isa<ConstantArray>(C) || isa<ConstantStruct>(C) ||
+             isa<ConstantVector>(C)) {
+    for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+      if (!isCommittable(cast<Constant>(C->getOperand(i))))
+        return false;
+  } else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(C)) {
+    switch (CE->getOpcode()) {
+    case Instruction::BitCast:
+    case Instruction::IntToPtr:
+    case Instruction::PtrToInt:
+      break;
+    case Instruction::GetElementPtr:
+      for (unsigned i = 1, e = CE->getNumOperands(); i != e; ++i)
+        if (!isa<ConstantInt>(CE->getOperand(i)))
+          return false;
+      break;
+    case Instruction::Add:
+      if (!isa<ConstantInt>(CE->getOperand(1)))
+        return false;
+      break;
+    default:
+      return false;
+    }
+    if (!isCommittable(CE->getOperand(0)))
+      return false;
+  }
+  Committable.insert(C);
+  return true;
+}
+
+/// getVal - Return the value of V in the evaluated function.
+static Constant *getVal(DenseMap<Value*, Constant*> &Values, Value *V) {
+  if (Constant *C = dyn_cast<Constant>(V))
+    return C;
+  Constant *C = Values[V];
+  assert(C && "Instruction does not dominate its use!");
+  return C;
+}
+
+/// evaluateMemIntrinsic - Evaluate a memcpy, memmove or memset that writes
+/// a whole element of a global, from a whole element of the same type, or of
+/// the bytes of its value.
+bool JsCtorEval::evaluateMemIntrinsic(MemIntrinsic *MI,
+                                      DenseMap<Value*, Constant*> &Values) {
+  ConstantInt *Len = dyn_cast<ConstantInt>(getVal(Values, MI->getLength()));
+  if (!Len || MI->isVolatile())
+    return false;
+  uint64_t Size = Len->getZExtValue();
+  if (!Size)
+    return true;
+  JsLocation Dest;
+  if (!getLocation(getVal(Values, MI->getRawDest()), 0, Size, Dest))
+    return false;
+
+  Constant *Val;
+  if (MemTransferInst *MTI = dyn_cast<MemTransferInst>(MI)) {
+    JsLocation Src;
+    if (!getLocation(getVal(Values, MTI->getRawSource()), Dest.Ty, Size, Src))
+      return false;
+    Val = load(Src);
+  } else {
+    ConstantInt *Byte = dyn_cast<ConstantInt>(
+      getVal(Values, cast<MemSetInst>(MI)->getValue()));
+    if (!Byte)
+      return false;
+    const Type *Ty = Dest.Ty;
+    const ArrayType *ATy = dyn_cast<ArrayType>(Ty);
+    if (ATy)
+      Ty = ATy->getElementType();
+    if (Byte->isZero())
+      Val = Constant::getNullValue(Dest.Ty);
+    else if (const IntegerType *ITy = dyn_cast<IntegerType>(Ty)) {
+      if (ITy->getBitWidth() % 8)
+        return false;
+      APInt Bits = Byte->getValue().zext(ITy->getBitWidth());
+      for (unsigned i = 8; i < ITy->getBitWidth(); i *= 2)
+        Bits |= Bits.shl(i);
+      Val = ConstantInt::get(ITy, Bits);
+      if (ATy)
+        Val = ConstantArray::get(ATy, std::vector<Constant*>(
+                                        ATy->getNumElements(), Val));
+    } else {
+      return false;
+    }
+  }
+  return Val && store(Dest, Val);
+}
+
+/// evaluateFunction - Evaluate a call of F with the given arguments, and set
+/// RetVal to its result.  Return false if the call cannot be evaluated.
+bool JsCtorEval::evaluateFunction(Function *F,
+                                  const SmallVectorImpl<Constant*> &Args,
+                                  Constant *&RetVal) {
+  if (std::find(CallStack.begin(), CallStack.end(), F) != CallStack.end())
+    return false;
+  CallStack.push_back(F);
+
+  DenseMap<Value*, Constant*> Values;
+  unsigned ArgNo = 0;
+  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); AI != E;
+       ++AI, ++ArgNo)
+    Values[AI] = Args[ArgNo];
+
+  BasicBlock::iterator CurInst = F->begin()->begin();
+  while (true) {
+    if (++Steps > JS_CTOR_EVAL_STEPS)
+      return false;
+    Constant *InstResult = 0;
+
+    if (StoreInst *SI = dyn_cast<StoreInst>(CurInst)) {
+      if (SI->isVolatile())
+        return false;
+      Constant *Val = getVal(Values, SI->getOperand(0));
+      JsLocation L;
+      if (!getLocation(getVal(Values, SI->getOperand(1)), Val->getType(), 0,
+                       L) ||
+          !store(L, Val))
+        return false;
+    } else if (LoadInst *LI = dyn_cast<LoadInst>(CurInst)) {
+      if (LI->isVolatile())
+        return false;
+      JsLocation L;
+      if (!getLocation(getVal(Values, LI->getOperand(0)), LI->getType(), 0,
+                       L) ||
+          !(InstResult = load(L)))
+        return false;
+    } else if (BinaryOperator *BO = dyn_cast<BinaryOperator>(CurInst)) {
+      InstResult = ConstantExpr::get(BO->getOpcode(),
+                                     getVal(Values, BO->getOperand(0)),
+                                     getVal(Values, BO->getOperand(1)));
+    } else if (CmpInst *CI = dyn_cast<CmpInst>(CurInst)) {
+      InstResult = ConstantExpr::getCompare(CI->getPredicate(),
+                                            getVal(Values, CI->getOperand(0)),
+                                            getVal(Values, CI->getOperand(1)));
+    } else if (CastInst *CI = dyn_cast<CastInst>(CurInst)) {
+      InstResult = ConstantExpr::getCast(CI->getOpcode(),
+                                         getVal(Values, CI->getOperand(0)),
+                                         CI->getType());
+    } else if (SelectInst *SI = dyn_cast<SelectInst>(CurInst)) {
+      InstResult = ConstantExpr::getSelect(getVal(Values, SI->getOperand(0)),
+                                           getVal(Values, SI->getOperand(1)),
+                                           getVal(Values, SI->getOperand(2)));
+    } else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(CurInst)) {
+      Constant *P = getVal(Values, GEP->getOperand(0));
+      SmallVector<Constant*, 8> GEPOps;
+      for (User::op_iterator i = GEP->op_begin() + 1, e = GEP->op_end();
+           i != e; ++i)
+        GEPOps.push_back(getVal(Values, *i));
+      InstResult = GEP->isInBounds() ?
+        ConstantExpr::getInBoundsGetElementPtr(P, GEPOps.data(), GEPOps.size()) :
+        ConstantExpr::getGetElementPtr(P, GEPOps.data(), GEPOps.size());
+    } else if (ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(CurInst)) {
+      InstResult = ConstantExpr::getExtractValue(
+        getVal(Values, EVI->getAggregateOperand()), EVI->idx_begin(),
+        EVI->getNumIndices());
+    } else if (InsertValueInst *IVI = dyn_cast<InsertValueInst>(CurInst)) {
+      InstResult = ConstantExpr::getInsertValue(
+        getVal(Values, IVI->getAggregateOperand()),
+        getVal(Values, IVI->getInsertedValueOperand()), IVI->idx_begin(),
+        IVI->getNumIndices());
+    } else if (AllocaInst *AI = dyn_cast<AllocaInst>(CurInst)) {
+      if (AI->isArrayAllocation())
+        return false;
+      const Type *Ty = AI->getAllocatedType();
+      GlobalVariable *Tmp =
+        new GlobalVariable(Ty, false, GlobalValue::InternalLinkage,
+                           UndefValue::get(Ty), AI->getName());
+      Temporaries.push_back(Tmp);
+      IsTemporary.insert(Tmp);
+      InstResult = Tmp;
+    } else if (CallInst *CI = dyn_cast<CallInst>(CurInst)) {
+      if (isa<DbgInfoIntrinsic>(CI)) {
+        ++CurInst;
+        continue;
+      }
+      if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(CI))
+        if (II->getIntrinsicID() == Intrinsic::lifetime_start ||
+            II->getIntrinsicID() == Intrinsic::lifetime_end) {
+          ++CurInst;
+          continue;
+        }
+      if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(CI)) {
+        if (!evaluateMemIntrinsic(MI, Values))
+          return false;
+        ++CurInst;
+        continue;
+      }
+
+      Function *Callee =
+        dyn_cast<Function>(getVal(Values, CI->getCalledValue()));
+      if (!Callee)
+        return false;
+      SmallVector<Constant*, 8> Formals;
+      CallSite CS(CI);
+      for (CallSite::arg_iterator i = CS.arg_begin(), e = CS.arg_end();
+           i != e; ++i)
+        Formals.push_back(getVal(Values, *i));
+
+      if (Callee->isDeclaration()) {
+        InstResult = ConstantFoldCall(Callee, Formals.data(), Formals.size());
+        if (!InstResult)
+          return false;
+      } else {
+        if (Callee->getFunctionType()->isVarArg() ||
+            !evaluateFunction(Callee, Formals, InstResult))
+          return false;
+      }
+    } else if (isa<TerminatorInst>(CurInst)) {
+      BasicBlock *NewBB;
+      if (BranchInst *BI = dyn_cast<BranchInst>(CurInst)) {
+        if (BI->isUnconditional()) {
+          NewBB = BI->getSuccessor(0);
+        } else {
+          ConstantInt *Cond =
+            dyn_cast<ConstantInt>(getVal(Values, BI->getCondition()));
+          if (!Cond)
+            return false;
+          NewBB = BI->getSuccessor(!Cond->getZExtValue());
+        }
+      } else if (SwitchInst *SI = dyn_cast<SwitchInst>(CurInst)) {
+        ConstantInt *Val =
+          dyn_cast<ConstantInt>(getVal(Values, SI->getCondition()));
+        if (!Val)
+          return false;
+        NewBB = SI->getSuccessor(SI->findCaseValue(Val));
+      } else if (ReturnInst *RI = dyn_cast<ReturnInst>(CurInst)) {
+        if (RI->getNumOperands())
+          RetVal = getVal(Values, RI->getOperand(0));
+        CallStack.pop_back();
+        return true;
+      } else {
+        return false;
+      }
+
+      // The phis of the new block read the values of the old one, all at
+      // once.
+      BasicBlock *OldBB = CurInst->getParent();
+      SmallVector<std::pair<PHINode*, Constant*>, 8> Phis;
+      CurInst = NewBB->begin();
+      for (; PHINode *PN = dyn_cast<PHINode>(CurInst); ++CurInst)
+        Phis.push_back(std::make_pair(PN,
+                         getVal(Values, PN->getIncomingValueForBlock(OldBB))));
+      for (unsigned i = 0, e = Phis.size(); i != e; ++i)
+        Values[Phis[i].first] = Phis[i].second;
+      continue;
+    } else {
+      return false;
+    }
+
+    if (!CurInst->use_empty()) {
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(InstResult))
+        InstResult = ConstantFoldConstantExpression(CE, TD);
+      Values[CurInst] = InstResult;
+    }
+    ++CurInst;
+  }
+}
+
+/// commit - Fold the memory of the evaluated constructor into the
+/// initializers of the globals that it wrote to.
+void JsCtorEval::commit() {
+  for (std::map<GlobalVariable*, JsMemoryValue>::iterator I = Memory.begin(),
+       E = Memory.end(); I != E; ++I) {
+    GlobalVariable *GV = I->first;
+    if (IsTemporary.count(GV))
+      continue;
+    GV->setInitializer(materialize(I->second,
+                                   GV->getType()->getElementType()));
+    ++NumGlobalsInitialized;
+  }
+}
+
+/// releaseTemporaries - Delete the globals of the allocas.  The program may
+/// have kept their addresses in other allocas, or in the values of the
+/// evaluation, which are dropped.
+void JsCtorEval::releaseTemporaries() {
+  Memory.clear();
+  Committable.clear();
+  IsTemporary.clear();
+  while (!Temporaries.empty()) {
+    GlobalVariable *Tmp = Temporaries.back();
+    Temporaries.pop_back();
+    if (!Tmp->use_empty())
+      Tmp->replaceAllUsesWith(Constant::getNullValue(Tmp->getType()));
+    delete Tmp;
+  }
+}
+
+/// evaluateCtor - Evaluate the constructor F, and commit its stores if it
+/// can be.
+bool JsCtorEval::evaluateCtor(Function *F) {
+  Steps = 0;
+  Constant *RetVal;
+  bool Evaluated = evaluateFunction(F, SmallVector<Constant*, 0>(), RetVal);
+  if (Evaluated) {
+    DEBUG(dbgs() << "Evaluated the static constructor " << F->getName()
+                 << " into " << Memory.size() << " globals\n");
+    commit();
+  }
+  CallStack.clear();
+  releaseTemporaries();
+  return Evaluated;
+}
+
+bool JsCtorEval::runOnModule(Module &M) {
+  GlobalVariable *Ctors = M.getNamedGlobal("llvm.global_ctors");
+  if (!Ctors || !Ctors->hasInitializer())
+    return false;
+  ConstantArray *CA = dyn_cast<ConstantArray>(Ctors->getInitializer());
+  if (!CA)
+    return false;
+
+  // The data layout of the code generator.
+  OwningPtr<TargetData> ModuleLayout;
+  if (M.getDataLayout().empty()) {
+    TD = TargetLayout;
+  } else {
+    ModuleLayout.reset(new TargetData(&M));
+    TD = ModuleLayout.get();
+  }
+
+  // The constructors run in order, so only those before the first one that
+  // cannot be evaluated are.  Those of other priorities keep theirs.
+  unsigned NumEvaluated = 0;
+  std::vector<Function*> Evaluated;
+  for (unsigned e = CA->getNumOperands(); NumEvaluated != e; ++NumEvaluated) {
+    ConstantStruct *CS = dyn_cast<ConstantStruct>(CA->getOperand(NumEvaluated));
+    if (!CS)
+      break;
+    ConstantInt *Priority = dyn_cast<ConstantInt>(CS->getOperand(0));
+    Function *F = dyn_cast<Function>(CS->getOperand(1));
+    if (!Priority || Priority->getZExtValue() != 65535 || !F ||
+        F->isDeclaration() || F->getFunctionType()->getNumParams() ||
+        !evaluateCtor(F))
+      break;
+    Evaluated.push_back(F);
+    ++NumCtorsEvaluated;
+  }
+  TD = 0;
+  if (!NumEvaluated)
+    return false;
+
+  std::vector<Constant*> Remaining(CA->op_begin() + NumEvaluated,
+                                   CA->op_end());
+  if (!Remaining.empty()) {
+    const ArrayType *ATy =
+      ArrayType::get(CA->getType()->getElementType(), Remaining.size());
+    GlobalVariable *NewCtors =
+      new GlobalVariable(M, ATy, false, Ctors->getLinkage(),
+                         ConstantArray::get(ATy, Remaining), "", Ctors);
+    NewCtors->takeName(Ctors);
+  }
+  Ctors->eraseFromParent();
+
+  // The constructors that nothing else calls go away with the entries.
+  SmallPtrSet<Function*, 8> Erased;
+  for (unsigned i = 0, e = Evaluated.size(); i != e; ++i) {
+    Function *F = Evaluated[i];
+    if (Erased.count(F) || !F->hasLocalLinkage())
+      continue;
+    F->removeDeadConstantUsers();
+    if (F->use_empty()) {
+      Erased.insert(F);
+      F->eraseFromParent();
+    }
+  }
+  return true;
+}
@@ -0,0 +1,295 @@
+//===-- JsFrameLayout.cpp - Stack frames of the JsBackend -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the stack frame layout of the javascript code
+// generator.  The accesses of every static alloca are collected through the
+// casts and GEPs of its address.  The allocas that may have been written are
+// propagated forwards over the CFG and those that may be read backwards, and
+// the interference is found by walking every block with both.  The allocas
+// are then greedily packed into slots, the largest first, as
+// StackSlotColoring does.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsFrameLayout.h"
+#include "llvm/BasicBlock.h"
+#include "llvm/Constants.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Target/TargetData.h"
+#include <algorithm>
+using namespace llvm;
+
+namespace {
+  /// LargerAlloca - Orders the numbers of allocas by decreasing size.
+  struct LargerAlloca {
+    const std::vector<uint64_t> &Sizes;
+    LargerAlloca(const std::vector<uint64_t> &Sizes) : Sizes(Sizes) {}
+    bool operator()(unsigned A, unsigned B) const {
+      return Sizes[A] > Sizes[B];
+    }
+  };
+}
+
+JsFrameLayout::JsFrameLayout(const std::vector<BasicBlock*> &Blocks,
+                             const TargetData *TD, bool ShareSlots)
+  : FrameSize(0), NumSlots(0) {
+  if (Blocks.empty())
+    return;
+  BasicBlock *Entry = Blocks[0];
+  for (BasicBlock::iterator II = Entry->begin(), IE = Entry->end(); II != IE;
+       ++II) {
+    const AllocaInst *AI = dyn_cast<AllocaInst>(II);
+    if (!AI)
+      continue;
+    const ConstantInt *Count = dyn_cast<ConstantInt>(AI->getArraySize());
+    const Type *Ty = AI->getAllocatedType();
+    unsigned Align = std::max(AI->getAlignment(),
+                              TD->getABITypeAlignment(Ty));
+    // The stack top is only kept 8 byte aligned.
+    if (!Count || Align > 8)
+      continue;
+    unsigned A = Allocas.size();
+    Allocas.push_back(AI);
+    Sizes.push_back(TD->getTypeAllocSize(Ty) * Count->getZExtValue());
+    Alignments.push_back(Align);
+    Escapes.push_back(!collectAccesses(AI, A));
+  }
+  if (Allocas.empty())
+    return;
+
+  unsigned NumAllocas = Allocas.size();
+  Interference.assign(NumAllocas, BitVector(NumAllocas));
+  if (ShareSlots)
+    computeInterference(Blocks);
+
+  // Give every alloca the first slot with none of whose allocas it
+  // interferes.  Allocas that escape have slots of their own.
+  std::vector<unsigned> Order;
+  for (unsigned A = 0; A != NumAllocas; ++A)
+    Order.push_back(A);
+  std::stable_sort(Order.begin(), Order.end(), LargerAlloca(Sizes));
+  std::vector<std::vector<unsigned> > Slots;
+  std::vector<uint64_t> SlotSizes;
+  std::vector<unsigned> SlotAlignments, SlotNumbers(NumAllocas);
+  for (unsigned i = 0; i != NumAllocas; ++i) {
+    unsigned A = Order[i];
+    unsigned Slot = 0, e = Slots.size();
+    for (; ShareSlots && !Escapes[A] && Slot != e; ++Slot) {
+      const std::vector<unsigned> &Members = Slots[Slot];
+      unsigned m = 0, me = Members.size();
+      while (m != me && !Escapes[Members[m]] &&
+             !Interference[A].test(Members[m]))
+        ++m;
+      if (m == me)
+        break;
+    }
+    if (!ShareSlots || Escapes[A] || Slot == e) {
+      Slot = e;
+      Slots.resize(Slot + 1);
+      SlotSizes.push_back(0);
+      SlotAlignments.push_back(1);
+    }
+    Slots[Slot].push_back(A);
+    SlotSizes[Slot] = std::max(SlotSizes[Slot], Sizes[A]);
+    SlotAlignments[Slot] = std::max(SlotAlignments[Slot], Alignments[A]);
+    SlotNumbers[A] = Slot;
+  }
+
+  NumSlots = Slots.size();
+  std::vector<uint64_t> SlotOffsets;
+  for (unsigned Slot = 0; Slot != NumSlots; ++Slot) {
+    FrameSize = RoundUpToAlignment(FrameSize, SlotAlignments[Slot]);
+    SlotOffsets.push_back(FrameSize);
+    FrameSize += SlotSizes[Slot];
+  }
+  FrameSize = RoundUpToAlignment(FrameSize, 8);
+  for (unsigned A = 0; A != NumAllocas; ++A)
+    Offsets[Allocas[A]] = SlotOffsets[SlotNumbers[A]];
+}
+
+bool JsFrameLayout::getOffset(const AllocaInst *AI, uint64_t &Offset) const {
+  DenseMap<const AllocaInst*, uint64_t>::const_iterator I = Offsets.find(AI);
+  if (I == Offsets.end())
+    return false;
+  Offset = I->second;
+  return true;
+}
+
+/// collectAccesses - Record the accesses of the instructions that use Ptr,
+/// an address in the alloca A, to its memory.  Return false if the address
+/// escapes.
+bool JsFrameLayout::collectAccesses(const Value *Ptr, unsigned A) {
+  for (Value::const_use_iterator UI = Ptr->use_begin(), UE = Ptr->use_end();
+       UI != UE; ++UI) {
+    const Instruction *I = dyn_cast<Instruction>(*UI);
+    if (!I)
+      return false;
+    unsigned Access = 0;
+    if (isa<LoadInst>(I)) {
+      Access = Read;
+    } else if (const StoreInst *SI = dyn_cast<StoreInst>(I)) {
+      if (SI->getValueOperand() == Ptr)
+        return false;
+      Access = Write;
+    } else if (isa<BitCastInst>(I) || isa<GetElementPtrInst>(I)) {
+      if (!collectAccesses(I, A))
+        return false;
+      continue;
+    } else if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I)) {
+      switch (II->getIntrinsicID()) {
+      case Intrinsic::lifetime_start:
+      case Intrinsic::lifetime_end: {
+        // Only markers of the whole alloca end its contents.
+        const ConstantInt *Size = dyn_cast<ConstantInt>(II->getArgOperand(0));
+        if (Ptr->stripPointerCasts() == Allocas[A] && Size &&
+            (Size->isAllOnesValue() || Size->getZExtValue() >= Sizes[A]))
+          Access = End;
+        break;
+      }
+      case Intrinsic::memset:
+        Access = Write;
+        break;
+      case Intrinsic::memcpy:
+      case Intrinsic::memmove:
+        if (II->getArgOperand(0) == Ptr)
+          Access |= Write;
+        if (II->getArgOperand(1) == Ptr)
+          Access |= Read;
+        break;
+      default:
+        return false;
+      }
+    } else {
+      return false;
+    }
+    if (Access)
+      Accesses[I].push_back(std::make_pair(A, Access));
+  }
+  return true;
+}
+
+/// applyAccesses - Update Set, a set of allocas, across the instruction I:
+/// the accesses of kind Gen add their allocas, and lifetime markers remove
+/// them.
+void JsFrameLayout::applyAccesses(const Instruction *I, BitVector &Set,
+                                  unsigned Gen) const {
+  DenseMap<const Instruction*,
+           std::vector<std::pair<unsigned, unsigned> > >::const_iterator It =
+    Accesses.find(I);
+  if (It == Accesses.end())
+    return;
+  const std::vector<std::pair<unsigned, unsigned> > &List = It->second;
+  for (unsigned i = 0, e = List.size(); i != e; ++i) {
+    if (List[i].second & End)
+      Set.reset(List[i].first);
+    else if (List[i].second & Gen)
+      Set.set(List[i].first);
+  }
+}
+
+/// computeInterference - Find the allocas that are written while another is
+/// live.
+void JsFrameLayout::computeInterference(
+                                     const std::vector<BasicBlock*> &Blocks) {
+  unsigned NumAllocas = Allocas.size();
+  unsigned NumBlocks = Blocks.size();
+  DenseMap<const BasicBlock*, unsigned> BlockNumbers;
+  for (unsigned b = 0; b != NumBlocks; ++b)
+    BlockNumbers[Blocks[b]] = b;
+
+  // The allocas that may have been written on entry to each block.
+  std::vector<BitVector> WrittenIn(NumBlocks, BitVector(NumAllocas));
+  std::vector<BitVector> WrittenOut(NumBlocks, BitVector(NumAllocas));
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned b = 0; b != NumBlocks; ++b) {
+      BasicBlock *BB = Blocks[b];
+      BitVector Written(NumAllocas);
+      for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE;
+           ++PI) {
+        DenseMap<const BasicBlock*, unsigned>::iterator Pred =
+          BlockNumbers.find(*PI);
+        if (Pred != BlockNumbers.end())
+          Written |= WrittenOut[Pred->second];
+      }
+      WrittenIn[b] = Written;
+      for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+           ++II)
+        applyAccesses(II, Written, Write);
+      if (Written != WrittenOut[b]) {
+        WrittenOut[b] = Written;
+        Changed = true;
+      }
+    }
+  }
+
+  // The allocas that may be read after the end of each block.
+  std::vector<BitVector> ReadIn(NumBlocks, BitVector(NumAllocas));
+  std::vector<BitVector> ReadOut(NumBlocks, BitVector(NumAllocas));
+  Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned b = NumBlocks; b-- != 0; ) {
+      BasicBlock *BB = Blocks[b];
+      BitVector ReadLater(NumAllocas);
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI) {
+        DenseMap<const BasicBlock*, unsigned>::iterator Succ =
+          BlockNumbers.find(*SI);
+        if (Succ != BlockNumbers.end())
+          ReadLater |= ReadIn[Succ->second];
+      }
+      ReadOut[b] = ReadLater;
+      for (BasicBlock::iterator II = BB->end(); II != BB->begin(); )
+        applyAccesses(--II, ReadLater, Read);
+      if (ReadLater != ReadIn[b]) {
+        ReadIn[b] = ReadLater;
+        Changed = true;
+      }
+    }
+  }
+
+  for (unsigned b = 0; b != NumBlocks; ++b) {
+    BasicBlock *BB = Blocks[b];
+    std::vector<const Instruction*> Insts;
+    for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+         ++II)
+      if (Accesses.count(II))
+        Insts.push_back(II);
+
+    std::vector<BitVector> ReadAfter(Insts.size());
+    BitVector ReadLater(ReadOut[b]);
+    for (unsigned i = Insts.size(); i-- != 0; ) {
+      ReadAfter[i] = ReadLater;
+      applyAccesses(Insts[i], ReadLater, Read);
+    }
+
+    BitVector Written(WrittenIn[b]);
+    for (unsigned i = 0, e = Insts.size(); i != e; ++i) {
+      const std::vector<std::pair<unsigned, unsigned> > &List =
+        Accesses[Insts[i]];
+      for (unsigned j = 0, je = List.size(); j != je; ++j) {
+        if (!(List[j].second & Write))
+          continue;
+        unsigned A = List[j].first;
+        BitVector Live(Written);
+        Live &= ReadAfter[i];
+        for (int L = Live.find_first(); L >= 0; L = Live.find_next(L))
+          if ((unsigned)L != A) {
+            Interference[A].set(L);
+            Interference[L].set(A);
+          }
+      }
+      applyAccesses(Insts[i], Written, Write);
+    }
+  }
+}
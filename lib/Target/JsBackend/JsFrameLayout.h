@@ -0,0 +1,91 @@
+//===-- JsFrameLayout.h - Stack frames of the JsBackend ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the stack frame layout of the javascript code generator.
+// The static allocas of a function, those of constant size in its entry
+// block, get fixed offsets in a frame that the function allocates with a
+// single bump of STACKTOP when it is entered, and that the restore of
+// STACKTOP on return frees.
+//
+// Allocas share a slot of the frame when their contents are never live at
+// the same time, in the way StackSlotColoring shares spill slots.  The
+// contents of an alloca are live at a point if the alloca may have been
+// written before it and may be read after it, and lifetime markers end them.
+// Two allocas interfere if one is written where the other is live.  An
+// alloca whose address escapes, to a call or into memory, may be accessed
+// anywhere, so it gets a slot of its own.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSFRAMELAYOUT_H
+#define JSFRAMELAYOUT_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include <vector>
+
+namespace llvm {
+
+class AllocaInst;
+class BasicBlock;
+class Instruction;
+class TargetData;
+class Value;
+
+/// JsFrameLayout - The offsets of the static allocas of a function from the
+/// start of its stack frame.
+class JsFrameLayout {
+  /// JsFrameAccess - The ways in which an instruction accesses the memory of
+  /// an alloca.
+  enum JsFrameAccess {
+    Read = 1,
+    Write = 2,
+    /// End - A lifetime marker, before and after which the contents do not
+    /// matter.
+    End = 4
+  };
+
+  std::vector<const AllocaInst*> Allocas;
+  std::vector<uint64_t> Sizes;
+  std::vector<unsigned> Alignments;
+  std::vector<bool> Escapes;
+  DenseMap<const Instruction*, std::vector<std::pair<unsigned, unsigned> > >
+    Accesses;
+  std::vector<BitVector> Interference;
+  DenseMap<const AllocaInst*, uint64_t> Offsets;
+  uint64_t FrameSize;
+  unsigned NumSlots;
+
+public:
+  /// JsFrameLayout - Lay out the frame of the function with the given
+  /// blocks, the first of which is its entry.  With ShareSlots, allocas that
+  /// do not interfere share slots.
+  JsFrameLayout(const std::vector<BasicBlock*> &Blocks, const TargetData *TD,
+                bool ShareSlots);
+
+  /// getOffset - Return true if AI is in the frame, and set Offset to its
+  /// offset from the start of the frame.  The other allocas are allocated
+  /// when they are reached.
+  bool getOffset(const AllocaInst *AI, uint64_t &Offset) const;
+
+  /// getFrameSize - Return the size of the frame, a multiple of 8 bytes.
+  uint64_t getFrameSize() const { return FrameSize; }
+
+  /// getNumSlots - Return the number of slots that the allocas share.
+  unsigned getNumSlots() const { return NumSlots; }
+
+private:
+  bool collectAccesses(const Value *Ptr, unsigned A);
+  void computeInterference(const std::vector<BasicBlock*> &Blocks);
+  void applyAccesses(const Instruction *I, BitVector &Set, unsigned Gen) const;
+};
+
+} // End llvm namespace
+
+#endif
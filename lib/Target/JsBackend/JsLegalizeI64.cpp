@@ -0,0 +1,1107 @@
+//===-- JsLegalizeI64.cpp - Split i64 values for the JsBackend ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the i64 legalization of the javascript code generator.
+// Javascript numbers only hold 53-bit integers exactly, so the code generator
+// approximates i64 values by doubles and emulates their bitwise operations in
+// its runtime.  This pass rewrites the i64 arithmetic, comparisons, shifts,
+// loads and stores of a function into operations on the low and high i32
+// halves of the values, which the code generator emits as exact int
+// arithmetic.
+//
+// The values that are not split here, like the results of operations without
+// an expansion, are split where they are defined, and the halves of a split
+// value are joined back into an i64 before the instructions that still need
+// the whole value.  When the known bits of a value show that its high half is
+// zero or the sign extension of its low half, the high half is not computed
+// at all.  Divisions that do not fit in i32 call a runtime helper that divides
+// the halves.
+//
+// The arguments and results of functions are split by a module pass that
+// runs first: an i64 argument is passed as its low and high halves, and an
+// i64 result is returned as its low half, with the high half stored to the
+// heap word at JS_TEMP_RET_PTR, where the caller reads it right after the
+// call.  The halves are joined as an i64 in the callee and after the call,
+// and this pass splits those joins back into the halves.  The functions of a
+// module that is read lazily are replaced as their bodies are read, with
+// legalizeJsI64Signature, and their calls are rewritten by this pass.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "js-legalize-i64"
+#include "JsTargetMachine.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+using namespace llvm;
+
+STATISTIC(NumLegalized, "Number of i64 instructions split into i32 halves");
+STATISTIC(NumJoined,    "Number of split i64 values joined for other uses");
+STATISTIC(NumSignatures, "Number of functions passed i64 values as halves");
+
+namespace {
+  /// JsLegalizeI64Inserter - Remember the instructions that the builder of
+  /// the pass creates, so that the ones left unused can be deleted.
+  class JsLegalizeI64Inserter : public IRBuilderDefaultInserter<true> {
+    std::vector<Instruction*> *Created;
+    SmallPtrSet<Value*, 64> *CreatedSet;
+
+  public:
+    JsLegalizeI64Inserter(std::vector<Instruction*> *Created = 0,
+                          SmallPtrSet<Value*, 64> *CreatedSet = 0)
+      : Created(Created), CreatedSet(CreatedSet) {}
+
+  protected:
+    void InsertHelper(Instruction *I, const Twine &Name, BasicBlock *BB,
+                      BasicBlock::iterator InsertPt) const {
+      IRBuilderDefaultInserter<true>::InsertHelper(I, Name, BB, InsertPt);
+      Created->push_back(I);
+      CreatedSet->insert(I);
+    }
+  };
+
+  typedef IRBuilder<true, ConstantFolder, JsLegalizeI64Inserter> BuilderTy;
+
+  /// Halves - The low and high i32 halves of an i64 value.
+  typedef std::pair<Value*, Value*> Halves;
+
+  class JsLegalizeI64 : public FunctionPass {
+    const TargetData *TD;
+    const IntegerType *Int32Ty, *Int64Ty;
+    BuilderTy *Builder;
+
+    /// Split - The halves of the i64 values split so far.
+    DenseMap<Value*, Halves> Split;
+
+    /// Legalized - The instructions that are replaced by their expansions,
+    /// in the order in which they were expanded.
+    std::vector<Instruction*> Legalized;
+    SmallPtrSet<Instruction*, 32> LegalizedSet;
+
+    /// Results - The replacements of the expanded instructions that do not
+    /// produce an i64.
+    DenseMap<Instruction*, Value*> Results;
+
+    std::vector<Instruction*> Created;
+    SmallPtrSet<Value*, 64> CreatedSet;
+
+  public:
+    static char ID;
+    JsLegalizeI64() : FunctionPass(ID) {}
+
+    virtual const char *getPassName() const {
+      return "Javascript i64 legalization";
+    }
+
+    virtual bool runOnFunction(Function &F);
+
+  private:
+    bool isLegalizable(Instruction *I);
+    bool isSplittable(Value *V) const;
+    bool hasZeroHigh(Value *V) const;
+    bool isSignExtended(Value *V) const;
+
+    Halves getHalves(Value *V);
+    Halves splitValue(Value *V);
+    Value *getKnownHigh(Value *V, Value *Lo);
+    Value *joinHalves(const Halves &H, const Twine &Name);
+
+    void legalize(Instruction *I);
+    Halves legalizeMul(const Halves &A, const Halves &B, bool NeedHigh);
+    Halves legalizeShift(unsigned Opcode, const Halves &A, Value *Amount);
+    Value *legalizeICmp(ICmpInst *I, const Halves &A, const Halves &B);
+    void legalizeGEPIndices(GetElementPtrInst *GEP);
+
+    void replaceLegalized();
+    void deleteUnusedCreated();
+
+    Value *createAdd(Value *A, Value *B);
+    Value *createMul(Value *A, Value *B);
+
+    ConstantInt *getInt32(uint64_t V) const {
+      return ConstantInt::get(Int32Ty, V);
+    }
+  };
+
+  /// JsLegalizeI64Signatures - Rewrite the functions whose arguments or result
+  /// are i64, and the calls to them, so that every i64 crosses the call as
+  /// i32 halves.
+  class JsLegalizeI64Signatures : public ModulePass {
+  public:
+    static char ID;
+    JsLegalizeI64Signatures() : ModulePass(ID) {}
+
+    virtual const char *getPassName() const {
+      return "Javascript i64 signature legalization";
+    }
+
+    virtual bool runOnModule(Module &M);
+  };
+}
+
+/// getTempRetPtr - Return the heap word through which functions return the
+/// high half of their i64 results.
+static Constant *getTempRetPtr(const IntegerType *Int32Ty) {
+  return ConstantExpr::getIntToPtr(ConstantInt::get(Int32Ty, JS_TEMP_RET_PTR),
+                                   Int32Ty->getPointerTo());
+}
+
+/// getCalledType - Return the function type through which the given call is
+/// made.
+static const FunctionType *getCalledType(CallSite CS) {
+  return cast<FunctionType>(
+    cast<PointerType>(CS.getCalledValue()->getType())->getElementType());
+}
+
+static bool isIllegal(const FunctionType *FTy);
+static const FunctionType *getLegalType(const FunctionType *FTy);
+static Function *replaceFunction(Function *F);
+static bool legalizeCalls(Function &F);
+static void legalizeCall(CallSite CS);
+static Value *createJoin(IRBuilder<> &Builder, Value *Lo, Value *Hi,
+                         const Twine &Name);
+
+char JsLegalizeI64::ID = 0;
+
+FunctionPass *llvm::createJsLegalizeI64Pass() {
+  return new JsLegalizeI64();
+}
+
+bool JsLegalizeI64::runOnFunction(Function &F) {
+  TD = getAnalysisIfAvailable<TargetData>();
+  LLVMContext &Context = F.getContext();
+  Int32Ty = Type::getInt32Ty(Context);
+  Int64Ty = Type::getInt64Ty(Context);
+  BuilderTy TheBuilder(Context, ConstantFolder(Context),
+                       JsLegalizeI64Inserter(&Created, &CreatedSet));
+  Builder = &TheBuilder;
+
+  // The bodies of a module that is read lazily are read after the signature
+  // pass has run, so their calls are rewritten here.  Those of an invoke may
+  // split its edge to the normal destination.
+  bool Changed = legalizeCalls(F);
+
+  // Visit the blocks in reverse post order, so that the operands of every
+  // instruction but a phi are split before it.  The incoming values of the
+  // phis are added once every block has been visited.
+  std::vector<PHINode*> Phis;
+  ReversePostOrderTraversal<Function*> RPOT(&F);
+  for (ReversePostOrderTraversal<Function*>::rpo_iterator BI = RPOT.begin(),
+       BE = RPOT.end(); BI != BE; ++BI)
+    for (BasicBlock::iterator II = (*BI)->begin(), IE = (*BI)->end();
+         II != IE; ++II) {
+      Instruction *I = II;
+      if (CreatedSet.count(I))
+        continue;
+      if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I)) {
+        legalizeGEPIndices(GEP);
+        continue;
+      }
+      if (!isLegalizable(I))
+        continue;
+      Legalized.push_back(I);
+      LegalizedSet.insert(I);
+      if (PHINode *PN = dyn_cast<PHINode>(I)) {
+        Builder->SetInsertPoint(PN->getParent(), PN);
+        PHINode *Lo = Builder->CreatePHI(Int32Ty, PN->getName() + ".lo");
+        PHINode *Hi = Builder->CreatePHI(Int32Ty, PN->getName() + ".hi");
+        Lo->reserveOperandSpace(PN->getNumIncomingValues());
+        Hi->reserveOperandSpace(PN->getNumIncomingValues());
+        Split[PN] = Halves(Lo, Hi);
+        Phis.push_back(PN);
+        continue;
+      }
+      legalize(I);
+    }
+
+  for (unsigned p = 0, pe = Phis.size(); p != pe; ++p) {
+    PHINode *PN = Phis[p];
+    Halves H = Split[PN];
+    PHINode *Lo = cast<PHINode>(H.first), *Hi = cast<PHINode>(H.second);
+    for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i) {
+      Halves In = getHalves(PN->getIncomingValue(i));
+      Lo->addIncoming(In.first, PN->getIncomingBlock(i));
+      Hi->addIncoming(In.second, PN->getIncomingBlock(i));
+    }
+  }
+
+  Changed |= !Legalized.empty() || !Created.empty();
+  NumLegalized += Legalized.size();
+  replaceLegalized();
+  deleteUnusedCreated();
+
+  Split.clear();
+  Legalized.clear();
+  LegalizedSet.clear();
+  Results.clear();
+  Created.clear();
+  CreatedSet.clear();
+  return Changed;
+}
+
+/// isLegalizable - Return true if the given instruction has an expansion on
+/// the halves of its i64 operands.
+bool JsLegalizeI64::isLegalizable(Instruction *I) {
+  const Type *Ty = I->getType();
+  switch (I->getOpcode()) {
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::Load:
+  case Instruction::Select:
+  case Instruction::PHI:
+  case Instruction::PtrToInt:
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+    if (Ty != Int64Ty)
+      return false;
+    break;
+  case Instruction::ZExt:
+  case Instruction::SExt:
+    if (Ty != Int64Ty ||
+        cast<IntegerType>(I->getOperand(0)->getType())->getBitWidth() > 32)
+      return false;
+    break;
+  case Instruction::Trunc:
+  case Instruction::IntToPtr:
+  case Instruction::ICmp:
+    if (I->getOperand(0)->getType() != Int64Ty)
+      return false;
+    break;
+  case Instruction::Store:
+    if (I->getOperand(0)->getType() != Int64Ty)
+      return false;
+    break;
+  default:
+    return false;
+  }
+
+  for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE; ++OI)
+    if ((*OI)->getType() == Int64Ty && !isSplittable(*OI))
+      return false;
+  return true;
+}
+
+/// isSplittable - Return true if the given i64 value can be split.  The
+/// result of an invoke is only available in its normal destination, which
+/// it does not necessarily dominate.
+bool JsLegalizeI64::isSplittable(Value *V) const {
+  return !isa<InvokeInst>(V);
+}
+
+/// hasZeroHigh - Return true if the high half of the given i64 value is known
+/// to be zero.
+bool JsLegalizeI64::hasZeroHigh(Value *V) const {
+  return MaskedValueIsZero(V, APInt::getHighBitsSet(64, 32), TD);
+}
+
+/// isSignExtended - Return true if the high half of the given i64 value is
+/// known to be the sign extension of its low half.
+bool JsLegalizeI64::isSignExtended(Value *V) const {
+  return ComputeNumSignBits(V, TD) > 32;
+}
+
+/// getHalves - Return the halves of the given i64 value, splitting it if it
+/// has not been split yet.
+Halves JsLegalizeI64::getHalves(Value *V) {
+  DenseMap<Value*, Halves>::iterator I = Split.find(V);
+  if (I != Split.end())
+    return I->second;
+  Halves H = splitValue(V);
+  Split[V] = H;
+  return H;
+}
+
+/// splitValue - Split an i64 value that is not expanded by this pass, right
+/// after its definition.
+Halves JsLegalizeI64::splitValue(Value *V) {
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(V)) {
+    const APInt &Val = CI->getValue();
+    return Halves(ConstantInt::get(Int32Ty, Val.trunc(32)),
+                  ConstantInt::get(Int32Ty, Val.lshr(32).trunc(32)));
+  }
+  if (isa<UndefValue>(V))
+    return Halves(UndefValue::get(Int32Ty), UndefValue::get(Int32Ty));
+
+  BasicBlock *SavedBB = Builder->GetInsertBlock();
+  BasicBlock::iterator SavedPt = Builder->GetInsertPoint();
+  if (Argument *A = dyn_cast<Argument>(V)) {
+    BasicBlock *Entry = &A->getParent()->getEntryBlock();
+    Builder->SetInsertPoint(Entry, Entry->getFirstNonPHI());
+  } else if (Instruction *I = dyn_cast<Instruction>(V)) {
+    BasicBlock *BB = I->getParent();
+    if (isa<PHINode>(I))
+      Builder->SetInsertPoint(BB, BB->getFirstNonPHI());
+    else
+      Builder->SetInsertPoint(BB, llvm::next(BasicBlock::iterator(I)));
+  }
+
+  // Constant expressions are folded instead of inserted.
+  Value *Lo = Builder->CreateTrunc(V, Int32Ty, V->getName() + ".lo");
+  Value *Hi = getKnownHigh(V, Lo);
+  if (!Hi)
+    Hi = Builder->CreateTrunc(Builder->CreateAShr(V, 32), Int32Ty,
+                              V->getName() + ".hi");
+
+  if (SavedBB)
+    Builder->SetInsertPoint(SavedBB, SavedPt);
+  return Halves(Lo, Hi);
+}
+
+/// getKnownHigh - Return the high half of the given i64 value with the given
+/// low half if its known bits determine it, or null.
+Value *JsLegalizeI64::getKnownHigh(Value *V, Value *Lo) {
+  if (hasZeroHigh(V))
+    return getInt32(0);
+  if (isSignExtended(V))
+    return Builder->CreateAShr(Lo, 31);
+  return 0;
+}
+
+/// joinHalves - Build the i64 with the given halves.  The high half is
+/// shifted in with a multiplication, which the code generator emits exactly,
+/// while it calls into its runtime for shifts.
+Value *JsLegalizeI64::joinHalves(const Halves &H, const Twine &Name) {
+  ++NumJoined;
+  Value *Hi = Builder->CreateSExt(H.second, Int64Ty);
+  Value *Lo = Builder->CreateZExt(H.first, Int64Ty);
+  Value *Shifted =
+    Builder->CreateMul(Hi, ConstantInt::get(Int64Ty, 1ULL << 32));
+  return Builder->CreateAdd(Shifted, Lo, Name);
+}
+
+/// legalize - Expand the given instruction into operations on the halves of
+/// its i64 operands.
+void JsLegalizeI64::legalize(Instruction *I) {
+  Builder->SetInsertPoint(I->getParent(), I);
+  Builder->SetCurrentDebugLocation(I->getDebugLoc());
+
+  bool Wide = I->getType() == Int64Ty;
+  bool KnownZero = Wide && hasZeroHigh(I);
+  bool KnownSExt = Wide && !KnownZero && isSignExtended(I);
+  bool NeedHigh = !KnownZero && !KnownSExt;
+
+  Value *Lo = 0, *Hi = 0;
+  unsigned Opcode = I->getOpcode();
+  switch (Opcode) {
+  default: llvm_unreachable("Instruction without an i64 expansion");
+  case Instruction::Add:
+  case Instruction::Sub: {
+    Halves A = getHalves(I->getOperand(0)), B = getHalves(I->getOperand(1));
+    bool IsAdd = Opcode == Instruction::Add;
+    Lo = IsAdd ? Builder->CreateAdd(A.first, B.first)
+               : Builder->CreateSub(A.first, B.first);
+    if (!NeedHigh)
+      break;
+    // The carry of the addition wraps the low half below the operand, the
+    // borrow of the subtraction happens when the operand is below the other.
+    Value *Carry = IsAdd ? Builder->CreateICmpULT(Lo, A.first)
+                         : Builder->CreateICmpULT(A.first, B.first);
+    Carry = Builder->CreateZExt(Carry, Int32Ty);
+    Hi = IsAdd ? createAdd(createAdd(A.second, B.second), Carry)
+               : Builder->CreateSub(Builder->CreateSub(A.second, B.second),
+                                    Carry);
+    break;
+  }
+  case Instruction::Mul: {
+    Halves H = legalizeMul(getHalves(I->getOperand(0)),
+                           getHalves(I->getOperand(1)), NeedHigh);
+    Lo = H.first;
+    Hi = H.second;
+    break;
+  }
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor: {
+    Halves A = getHalves(I->getOperand(0)), B = getHalves(I->getOperand(1));
+    Instruction::BinaryOps Op = (Instruction::BinaryOps)Opcode;
+    Lo = Builder->CreateBinOp(Op, A.first, B.first);
+    if (NeedHigh)
+      Hi = Builder->CreateBinOp(Op, A.second, B.second);
+    break;
+  }
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr: {
+    Halves H = legalizeShift(Opcode, getHalves(I->getOperand(0)),
+                             getHalves(I->getOperand(1)).first);
+    Lo = H.first;
+    Hi = H.second;
+    break;
+  }
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::URem:
+  case Instruction::SRem: {
+    Halves A = getHalves(I->getOperand(0)), B = getHalves(I->getOperand(1));
+    bool IsSigned = Opcode == Instruction::SDiv ||
+                    Opcode == Instruction::SRem;
+    bool IsRem = Opcode == Instruction::URem || Opcode == Instruction::SRem;
+    // Divisions of values that fit in i32 are i32 divisions.  Signed ones
+    // of non-negative values are unsigned ones, and the signed quotient of
+    // i32 values overflows i32 for INT_MIN / -1.
+    if (hasZeroHigh(I->getOperand(0)) && hasZeroHigh(I->getOperand(1))) {
+      Lo = Builder->CreateBinOp(IsRem ? Instruction::URem : Instruction::UDiv,
+                                A.first, B.first);
+      Hi = getInt32(0);
+      break;
+    }
+    if (Opcode == Instruction::SRem && isSignExtended(I->getOperand(0)) &&
+        isSignExtended(I->getOperand(1))) {
+      Lo = Builder->CreateSRem(A.first, B.first);
+      Hi = Builder->CreateAShr(Lo, 31);
+      break;
+    }
+    // The others call the runtime, which returns the high half of the
+    // result like the functions do.
+    Module *M = I->getParent()->getParent()->getParent();
+    Constant *DivMod =
+      M->getOrInsertFunction("llvm.js.i64.divmod", Int32Ty, Int32Ty, Int32Ty,
+                             Int32Ty, Int32Ty, Int32Ty, Int32Ty, (Type*)0);
+    Value *Args[] = { A.first, A.second, B.first, B.second,
+                      getInt32(IsSigned), getInt32(IsRem) };
+    Lo = Builder->CreateCall(DivMod, Args, Args + 6);
+    if (NeedHigh)
+      Hi = Builder->CreateLoad(getTempRetPtr(Int32Ty));
+    break;
+  }
+  case Instruction::ICmp: {
+    Halves A = getHalves(I->getOperand(0)), B = getHalves(I->getOperand(1));
+    Results[I] = legalizeICmp(cast<ICmpInst>(I), A, B);
+    return;
+  }
+  case Instruction::Load: {
+    LoadInst *LI = cast<LoadInst>(I);
+    unsigned AddrSpace = LI->getPointerAddressSpace();
+    Value *Ptr = Builder->CreateBitCast(LI->getPointerOperand(),
+                                        Int32Ty->getPointerTo(AddrSpace));
+    unsigned Align = LI->getAlignment() ? MinAlign(LI->getAlignment(), 4) : 0;
+    LoadInst *LoLoad = Builder->CreateLoad(Ptr, LI->isVolatile());
+    LoLoad->setAlignment(Align);
+    Lo = LoLoad;
+    if (!NeedHigh && !LI->isVolatile())
+      break;
+    LoadInst *HiLoad = Builder->CreateLoad(Builder->CreateConstGEP1_32(Ptr, 1),
+                                           LI->isVolatile());
+    HiLoad->setAlignment(Align);
+    Hi = HiLoad;
+    break;
+  }
+  case Instruction::Store: {
+    StoreInst *SI = cast<StoreInst>(I);
+    Halves V = getHalves(SI->getValueOperand());
+    unsigned AddrSpace = SI->getPointerAddressSpace();
+    Value *Ptr = Builder->CreateBitCast(SI->getPointerOperand(),
+                                        Int32Ty->getPointerTo(AddrSpace));
+    unsigned Align = SI->getAlignment() ? MinAlign(SI->getAlignment(), 4) : 0;
+    Builder->CreateStore(V.first, Ptr, SI->isVolatile())->setAlignment(Align);
+    Builder->CreateStore(V.second, Builder->CreateConstGEP1_32(Ptr, 1),
+                         SI->isVolatile())->setAlignment(Align);
+    return;
+  }
+  case Instruction::ZExt:
+  case Instruction::SExt: {
+    Value *Src = I->getOperand(0);
+    bool IsZExt = Opcode == Instruction::ZExt;
+    if (Src->getType() == Int32Ty)
+      Lo = Src;
+    else
+      Lo = IsZExt ? Builder->CreateZExt(Src, Int32Ty)
+                  : Builder->CreateSExt(Src, Int32Ty);
+    // The known bits give the same high half.
+    KnownZero = IsZExt;
+    KnownSExt = !IsZExt;
+    break;
+  }
+  case Instruction::Trunc: {
+    Value *Src = getHalves(I->getOperand(0)).first;
+    Results[I] = I->getType() == Int32Ty ? Src
+                                         : Builder->CreateTrunc(Src,
+                                                                I->getType());
+    return;
+  }
+  // The javascript heap has 32-bit addresses.
+  case Instruction::PtrToInt:
+    Lo = Builder->CreatePtrToInt(I->getOperand(0), Int32Ty);
+    Hi = getInt32(0);
+    break;
+  case Instruction::IntToPtr:
+    Results[I] = Builder->CreateIntToPtr(getHalves(I->getOperand(0)).first,
+                                         I->getType());
+    return;
+  case Instruction::Select: {
+    Value *Cond = I->getOperand(0);
+    Halves A = getHalves(I->getOperand(1)), B = getHalves(I->getOperand(2));
+    Lo = Builder->CreateSelect(Cond, A.first, B.first);
+    if (NeedHigh)
+      Hi = Builder->CreateSelect(Cond, A.second, B.second);
+    break;
+  }
+  }
+
+  if (KnownZero)
+    Hi = getInt32(0);
+  else if (KnownSExt)
+    Hi = Builder->CreateAShr(Lo, 31);
+  if (CreatedSet.count(Lo) && !Lo->hasName())
+    Lo->setName(I->getName() + ".lo");
+  if (CreatedSet.count(Hi) && !Hi->hasName())
+    Hi->setName(I->getName() + ".hi");
+  Split[I] = Halves(Lo, Hi);
+}
+
+/// legalizeMul - Expand the multiplication of two i64 values.  The low
+/// halves are multiplied in 16-bit pieces to get the high half of their
+/// product, which no javascript operation computes.
+Halves JsLegalizeI64::legalizeMul(const Halves &A, const Halves &B,
+                                  bool NeedHigh) {
+  Value *Lo = Builder->CreateMul(A.first, B.first);
+  if (!NeedHigh)
+    return Halves(Lo, 0);
+
+  Value *Mask = getInt32(0xffff), *Sixteen = getInt32(16);
+  Value *A0 = Builder->CreateAnd(A.first, Mask);
+  Value *A1 = Builder->CreateLShr(A.first, Sixteen);
+  Value *B0 = Builder->CreateAnd(B.first, Mask);
+  Value *B1 = Builder->CreateLShr(B.first, Sixteen);
+  Value *P00 = createMul(A0, B0);
+  Value *P01 = createMul(A0, B1);
+  Value *P10 = createMul(A1, B0);
+  Value *P11 = createMul(A1, B1);
+  Value *Mid = createAdd(Builder->CreateLShr(P00, Sixteen),
+                         Builder->CreateAnd(P01, Mask));
+  Mid = createAdd(Mid, Builder->CreateAnd(P10, Mask));
+  Value *Hi = createAdd(P11, Builder->CreateLShr(P01, Sixteen));
+  Hi = createAdd(Hi, Builder->CreateLShr(P10, Sixteen));
+  Hi = createAdd(Hi, Builder->CreateLShr(Mid, Sixteen));
+
+  // The cross products only reach the high half.
+  Hi = createAdd(Hi, createMul(A.first, B.second));
+  Hi = createAdd(Hi, createMul(A.second, B.first));
+  return Halves(Lo, Hi);
+}
+
+static bool isZero(Value *V) {
+  return isa<Constant>(V) && cast<Constant>(V)->isNullValue();
+}
+
+/// createAdd - Add two i32 values, leaving out additions of zero, which the
+/// expansion of a multiplication by a constant is full of.
+Value *JsLegalizeI64::createAdd(Value *A, Value *B) {
+  if (isZero(A))
+    return B;
+  if (isZero(B))
+    return A;
+  return Builder->CreateAdd(A, B);
+}
+
+/// createMul - Multiply two i32 values, leaving out multiplications by zero
+/// and one.
+Value *JsLegalizeI64::createMul(Value *A, Value *B) {
+  if (isZero(A) || isZero(B))
+    return getInt32(0);
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(A))
+    if (CI->isOne())
+      return B;
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(B))
+    if (CI->isOne())
+      return A;
+  return Builder->CreateMul(A, B);
+}
+
+/// legalizeShift - Expand the shift of an i64 value by the given amount,
+/// which is the low half of the i64 amount.
+Halves JsLegalizeI64::legalizeShift(unsigned Opcode, const Halves &A,
+                                    Value *Amount) {
+  Value *Lo = A.first, *Hi = A.second;
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(Amount)) {
+    unsigned N = CI->getZExtValue() & 63;
+    if (N == 0)
+      return A;
+    if (N >= 32) {
+      Value *Rest = getInt32(N - 32);
+      switch (Opcode) {
+      case Instruction::Shl:
+        return Halves(getInt32(0), N == 32 ? Lo : Builder->CreateShl(Lo, Rest));
+      case Instruction::LShr:
+        return Halves(N == 32 ? Hi : Builder->CreateLShr(Hi, Rest),
+                      getInt32(0));
+      default:
+        return Halves(N == 32 ? Hi : Builder->CreateAShr(Hi, Rest),
+                      Builder->CreateAShr(Hi, 31));
+      }
+    }
+    Value *Shift = getInt32(N), *Back = getInt32(32 - N);
+    if (Opcode == Instruction::Shl)
+      return Halves(Builder->CreateShl(Lo, Shift),
+                    Builder->CreateOr(Builder->CreateShl(Hi, Shift),
+                                      Builder->CreateLShr(Lo, Back)));
+    Value *NewLo = Builder->CreateOr(Builder->CreateLShr(Lo, Shift),
+                                     Builder->CreateShl(Hi, Back));
+    return Halves(NewLo, Opcode == Instruction::LShr ?
+                           Builder->CreateLShr(Hi, Shift) :
+                           Builder->CreateAShr(Hi, Shift));
+  }
+
+  // Compute both the shift below 32 and the one by 32 or more, and select.
+  // The bits that cross between the halves are shifted by one and then by
+  // 31 - N, which is defined for every N below 32.
+  Value *N = Builder->CreateAnd(Amount, getInt32(63));
+  Value *Small = Builder->CreateAnd(N, getInt32(31));
+  Value *IsLarge = Builder->CreateICmpUGE(N, getInt32(32));
+  Value *Back = Builder->CreateSub(getInt32(31), Small);
+  if (Opcode == Instruction::Shl) {
+    Value *ShiftedLo = Builder->CreateShl(Lo, Small);
+    Value *Cross = Builder->CreateLShr(Builder->CreateLShr(Lo, getInt32(1)),
+                                       Back);
+    Value *ShiftedHi = Builder->CreateOr(Builder->CreateShl(Hi, Small), Cross);
+    return Halves(Builder->CreateSelect(IsLarge, getInt32(0), ShiftedLo),
+                  Builder->CreateSelect(IsLarge, ShiftedLo, ShiftedHi));
+  }
+  Value *Cross = Builder->CreateShl(Builder->CreateShl(Hi, getInt32(1)), Back);
+  Value *ShiftedLo = Builder->CreateOr(Builder->CreateLShr(Lo, Small), Cross);
+  if (Opcode == Instruction::LShr) {
+    Value *ShiftedHi = Builder->CreateLShr(Hi, Small);
+    return Halves(Builder->CreateSelect(IsLarge, ShiftedHi, ShiftedLo),
+                  Builder->CreateSelect(IsLarge, getInt32(0), ShiftedHi));
+  }
+  Value *ShiftedHi = Builder->CreateAShr(Hi, Small);
+  return Halves(Builder->CreateSelect(IsLarge, ShiftedHi, ShiftedLo),
+                Builder->CreateSelect(IsLarge, Builder->CreateAShr(Hi, 31),
+                                      ShiftedHi));
+}
+
+/// legalizeICmp - Expand the comparison of two i64 values: the high halves
+/// decide it unless they are equal, in which case the low halves are compared
+/// as unsigned.
+Value *JsLegalizeI64::legalizeICmp(ICmpInst *I, const Halves &A,
+                                   const Halves &B) {
+  ICmpInst::Predicate Pred = I->getPredicate();
+  if (I->isEquality()) {
+    Value *Diff = Builder->CreateOr(Builder->CreateXor(A.first, B.first),
+                                    Builder->CreateXor(A.second, B.second));
+    return Builder->CreateICmp(Pred, Diff, getInt32(0));
+  }
+
+  ICmpInst::Predicate HiPred, LoPred;
+  switch (Pred) {
+  default: llvm_unreachable("Illegal ICmp predicate");
+  case ICmpInst::ICMP_SLT:
+  case ICmpInst::ICMP_SLE:
+    HiPred = ICmpInst::ICMP_SLT;
+    break;
+  case ICmpInst::ICMP_SGT:
+  case ICmpInst::ICMP_SGE:
+    HiPred = ICmpInst::ICMP_SGT;
+    break;
+  case ICmpInst::ICMP_ULT:
+  case ICmpInst::ICMP_ULE:
+    HiPred = ICmpInst::ICMP_ULT;
+    break;
+  case ICmpInst::ICMP_UGT:
+  case ICmpInst::ICMP_UGE:
+    HiPred = ICmpInst::ICMP_UGT;
+    break;
+  }
+  LoPred = I->getUnsignedPredicate();
+
+  Value *LoCmp = Builder->CreateICmp(LoPred, A.first, B.first);
+  Value *HiCmp = Builder->CreateICmp(HiPred, A.second, B.second);
+  Value *HiEqual = Builder->CreateICmpEQ(A.second, B.second);
+  return Builder->CreateSelect(HiEqual, LoCmp, HiCmp);
+}
+
+/// legalizeGEPIndices - Index the given getelementptr with the low halves of
+/// its i64 indices, which is all that 32-bit addresses use of them.
+void JsLegalizeI64::legalizeGEPIndices(GetElementPtrInst *GEP) {
+  if (TD && TD->getPointerSizeInBits() != 32)
+    return;
+  for (unsigned i = 1, e = GEP->getNumOperands(); i != e; ++i) {
+    Value *Idx = GEP->getOperand(i);
+    if (Idx->getType() != Int64Ty || isa<Constant>(Idx) ||
+        !isSplittable(Idx))
+      continue;
+    GEP->setOperand(i, getHalves(Idx).first);
+  }
+}
+
+/// replaceLegalized - Replace the expanded instructions by their results,
+/// joining the halves of the i64 results that are still used as a whole,
+/// and delete them.
+void JsLegalizeI64::replaceLegalized() {
+  for (unsigned i = 0, e = Legalized.size(); i != e; ++i) {
+    Instruction *I = Legalized[i];
+    if (I->getType() != Int64Ty) {
+      if (I->getType()->isVoidTy())
+        continue;
+      Value *Result = Results[I];
+      if (CreatedSet.count(Result) && !Result->hasName())
+        Result->takeName(I);
+      I->replaceAllUsesWith(Result);
+      continue;
+    }
+
+    bool UsedWhole = false;
+    for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+         UI != UE && !UsedWhole; ++UI)
+      UsedWhole = !LegalizedSet.count(cast<Instruction>(*UI));
+    if (!UsedWhole) {
+      I->replaceAllUsesWith(UndefValue::get(Int64Ty));
+      continue;
+    }
+
+    BasicBlock *BB = I->getParent();
+    Builder->SetInsertPoint(BB, isa<PHINode>(I) ? BB->getFirstNonPHI() : I);
+    Builder->SetCurrentDebugLocation(I->getDebugLoc());
+    std::string Name = I->getName();
+    I->setName("");
+    I->replaceAllUsesWith(joinHalves(Split[I], Name));
+  }
+
+  for (unsigned i = 0, e = Legalized.size(); i != e; ++i)
+    Legalized[i]->dropAllReferences();
+  for (unsigned i = 0, e = Legalized.size(); i != e; ++i)
+    Legalized[i]->eraseFromParent();
+}
+
+/// deleteUnusedCreated - Simplify the instructions that the expansions
+/// created, and delete the ones whose results are not used, including the
+/// halves that only feed each other through phis.
+void JsLegalizeI64::deleteUnusedCreated() {
+  for (unsigned i = 0, e = Created.size(); i != e; ++i)
+    if (Value *V = SimplifyInstruction(Created[i], TD))
+      Created[i]->replaceAllUsesWith(V);
+
+  SmallPtrSet<Instruction*, 64> Live;
+  std::vector<Instruction*> Worklist;
+  for (unsigned i = 0, e = Created.size(); i != e; ++i) {
+    Instruction *I = Created[i];
+    bool IsLive = I->mayHaveSideEffects();
+    for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+         UI != UE && !IsLive; ++UI)
+      IsLive = !CreatedSet.count(*UI);
+    if (IsLive && Live.insert(I))
+      Worklist.push_back(I);
+  }
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.back();
+    Worklist.pop_back();
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI) {
+      Instruction *Op = dyn_cast<Instruction>(*OI);
+      if (Op && CreatedSet.count(Op) && Live.insert(Op))
+        Worklist.push_back(Op);
+    }
+  }
+
+  std::vector<Instruction*> Dead;
+  for (unsigned i = 0, e = Created.size(); i != e; ++i)
+    if (!Live.count(Created[i]))
+      Dead.push_back(Created[i]);
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->dropAllReferences();
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->eraseFromParent();
+}
+
+char JsLegalizeI64Signatures::ID = 0;
+
+ModulePass *llvm::createJsLegalizeI64SignaturesPass() {
+  return new JsLegalizeI64Signatures();
+}
+
+bool JsLegalizeI64Signatures::runOnModule(Module &M) {
+  // The functions whose bodies are not read yet are replaced once they are,
+  // see legalizeJsI64Signature.
+  std::vector<Function*> Illegal;
+  bool Lazy = false;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isMaterializable())
+      Lazy = true;
+    else if (!F->isIntrinsic() && isIllegal(F->getFunctionType()))
+      Illegal.push_back(F);
+  }
+
+  // The uses of the replaced functions go through bitcasts to their old
+  // types, so the direct calls are rewritten along with the indirect ones.
+  std::vector<Function*> Legal;
+  for (unsigned i = 0, e = Illegal.size(); i != e; ++i) {
+    Function *F = Illegal[i];
+    Legal.push_back(replaceFunction(F));
+    F->eraseFromParent();
+  }
+  NumSignatures += Illegal.size();
+
+  bool Changed = !Illegal.empty();
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    Changed |= legalizeCalls(*F);
+
+  // The bitcasts left without uses would make the functions look address
+  // taken.  Those of a module that is read lazily stand for the replaced
+  // functions in the bodies still to be read, and are kept.
+  if (!Lazy)
+    for (unsigned i = 0, e = Legal.size(); i != e; ++i)
+      Legal[i]->removeDeadConstantUsers();
+
+  return Changed;
+}
+
+/// legalizeJsI64Signature - Replace F by the function of the legal type.
+Function *llvm::legalizeJsI64Signature(Function *F) {
+  if (!isIllegal(F->getFunctionType()))
+    return 0;
+  Function *NF = replaceFunction(F);
+  F->removeFromParent();
+  ++NumSignatures;
+  return NF;
+}
+
+/// getJsLegalI64Type - Return the legal type of functions of the given type.
+const FunctionType *llvm::getJsLegalI64Type(const FunctionType *FTy) {
+  return isIllegal(FTy) ? getLegalType(FTy) : FTy;
+}
+
+/// isIllegal - Return true if the given function type has an i64 argument or
+/// result.  The variadic arguments are passed in memory.
+static bool isIllegal(const FunctionType *FTy) {
+  const Type *Int64Ty = Type::getInt64Ty(FTy->getContext());
+  if (FTy->getReturnType() == Int64Ty)
+    return true;
+  for (FunctionType::param_iterator I = FTy->param_begin(),
+       E = FTy->param_end(); I != E; ++I)
+    if (*I == Int64Ty)
+      return true;
+  return false;
+}
+
+/// getLegalType - Return the given function type with the i64 arguments
+/// split into halves, the low half first, and an i64 result returned as its
+/// low half.
+static const FunctionType *getLegalType(const FunctionType *FTy) {
+  const Type *Int32Ty = Type::getInt32Ty(FTy->getContext());
+  const Type *Int64Ty = Type::getInt64Ty(FTy->getContext());
+  std::vector<const Type*> Params;
+  for (FunctionType::param_iterator I = FTy->param_begin(),
+       E = FTy->param_end(); I != E; ++I) {
+    Params.push_back(*I == Int64Ty ? Int32Ty : *I);
+    if (*I == Int64Ty)
+      Params.push_back(Int32Ty);
+  }
+  const Type *RetTy = FTy->getReturnType();
+  return FunctionType::get(RetTy == Int64Ty ? Int32Ty : RetTy, Params,
+                           FTy->isVarArg());
+}
+
+/// getLegalAttributes - Return the attributes of a function or call of the
+/// given type for its legal type.  The attributes of the i64 arguments and
+/// result, like zeroext, do not apply to their halves and are dropped.
+static AttrListPtr getLegalAttributes(const AttrListPtr &PAL,
+                                      const FunctionType *FTy) {
+  const Type *Int64Ty = Type::getInt64Ty(FTy->getContext());
+  SmallVector<AttributeWithIndex, 8> Attrs;
+  for (unsigned i = 0, e = PAL.getNumSlots(); i != e; ++i) {
+    AttributeWithIndex AWI = PAL.getSlot(i);
+    if (AWI.Index == 0) {
+      if (FTy->getReturnType() == Int64Ty)
+        continue;
+    } else if (AWI.Index != ~0U) {
+      unsigned Arg = AWI.Index - 1;
+      if (Arg < FTy->getNumParams() && FTy->getParamType(Arg) == Int64Ty)
+        continue;
+      for (unsigned p = 0, pe = std::min(Arg, FTy->getNumParams()); p != pe;
+           ++p)
+        if (FTy->getParamType(p) == Int64Ty)
+          ++AWI.Index;
+    }
+    Attrs.push_back(AWI);
+  }
+  return AttrListPtr::get(Attrs.begin(), Attrs.end());
+}
+
+/// replaceFunction - Create the function of the legal type that replaces the
+/// given one, move the body over, and make the uses of F use it.  The i64
+/// arguments are joined from their halves, and the high half of the result
+/// is stored before returning the low half.
+static Function *replaceFunction(Function *F) {
+  const FunctionType *FTy = F->getFunctionType();
+  const IntegerType *Int32Ty = Type::getInt32Ty(F->getContext());
+  const IntegerType *Int64Ty = Type::getInt64Ty(F->getContext());
+  Function *NF = Function::Create(getLegalType(FTy), F->getLinkage());
+  NF->copyAttributesFrom(F);
+  NF->setAttributes(getLegalAttributes(F->getAttributes(), FTy));
+  F->getParent()->getFunctionList().insert(F, NF);
+  NF->takeName(F);
+  F->replaceAllUsesWith(ConstantExpr::getBitCast(NF, F->getType()));
+  if (F->isDeclaration())
+    return NF;
+  NF->getBasicBlockList().splice(NF->begin(), F->getBasicBlockList());
+
+  BasicBlock *Entry = &NF->getEntryBlock();
+  IRBuilder<> Builder(Entry, Entry->begin());
+  Function::arg_iterator NAI = NF->arg_begin();
+  for (Function::arg_iterator AI = F->arg_begin(), AE = F->arg_end();
+       AI != AE; ++AI, ++NAI) {
+    if (AI->getType() != Int64Ty) {
+      AI->replaceAllUsesWith(NAI);
+      NAI->takeName(AI);
+      continue;
+    }
+    Argument *Lo = NAI, *Hi = ++NAI;
+    Lo->setName(AI->getName() + ".lo");
+    Hi->setName(AI->getName() + ".hi");
+    std::string Name = AI->getName();
+    AI->setName("");
+    AI->replaceAllUsesWith(createJoin(Builder, Lo, Hi, Name));
+  }
+
+  if (FTy->getReturnType() != Int64Ty)
+    return NF;
+  Constant *TempRet = getTempRetPtr(Int32Ty);
+  for (Function::iterator BB = NF->begin(), E = NF->end(); BB != E; ++BB) {
+    ReturnInst *RI = dyn_cast<ReturnInst>(BB->getTerminator());
+    if (!RI)
+      continue;
+    Builder.SetInsertPoint(BB, RI);
+    Builder.SetCurrentDebugLocation(RI->getDebugLoc());
+    Value *V = RI->getReturnValue();
+    Builder.CreateStore(Builder.CreateTrunc(Builder.CreateLShr(V, 32),
+                                            Int32Ty),
+                        TempRet);
+    Builder.CreateRet(Builder.CreateTrunc(V, Int32Ty))
+      ->setDebugLoc(RI->getDebugLoc());
+    RI->eraseFromParent();
+  }
+  return NF;
+}
+
+/// legalizeCalls - Rewrite the calls of F that are made through an illegal
+/// function type, and return true if there were any.
+static bool legalizeCalls(Function &F) {
+  std::vector<Instruction*> Calls;
+  for (inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE; ++I) {
+    CallSite CS(&*I);
+    if (!CS || isa<InlineAsm>(CS.getCalledValue()))
+      continue;
+    const Function *Callee =
+      dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+    if (Callee && Callee->isIntrinsic())
+      continue;
+    if (isIllegal(getCalledType(CS)))
+      Calls.push_back(&*I);
+  }
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i)
+    legalizeCall(CallSite(Calls[i]));
+  return !Calls.empty();
+}
+
+/// legalizeCall - Rewrite the given call of an illegal function type into a
+/// call of the legal type, which passes the halves of the i64 arguments, and
+/// join the i64 result from the low half it returns and the high half it
+/// leaves in the heap.
+static void legalizeCall(CallSite CS) {
+  Instruction *Call = CS.getInstruction();
+  const FunctionType *FTy = getCalledType(CS);
+  const IntegerType *Int32Ty = Type::getInt32Ty(Call->getContext());
+  const IntegerType *Int64Ty = Type::getInt64Ty(Call->getContext());
+  bool WideResult = FTy->getReturnType() == Int64Ty && !Call->use_empty();
+
+  // The high half of the result is read where the result of an invoke is
+  // available, on its edge to the normal destination.
+  InvokeInst *II = dyn_cast<InvokeInst>(Call);
+  if (II && WideResult && !II->getNormalDest()->getSinglePredecessor())
+    SplitCriticalEdge(II, 0);
+
+  IRBuilder<> Builder(Call->getParent(), Call);
+  Builder.SetCurrentDebugLocation(Call->getDebugLoc());
+  unsigned AddrSpace =
+    cast<PointerType>(CS.getCalledValue()->getType())->getAddressSpace();
+  Value *Callee = Builder.CreatePointerCast(
+    CS.getCalledValue(), PointerType::get(getLegalType(FTy), AddrSpace));
+  SmallVector<Value*, 8> Args;
+  for (unsigned i = 0, e = CS.arg_size(); i != e; ++i) {
+    Value *Arg = CS.getArgument(i);
+    if (i >= FTy->getNumParams() || Arg->getType() != Int64Ty) {
+      Args.push_back(Arg);
+      continue;
+    }
+    Args.push_back(Builder.CreateTrunc(Arg, Int32Ty));
+    Args.push_back(Builder.CreateTrunc(Builder.CreateLShr(Arg, 32), Int32Ty));
+  }
+
+  Instruction *NewCall;
+  if (II) {
+    NewCall = Builder.CreateInvoke(Callee, II->getNormalDest(),
+                                   II->getUnwindDest(), Args.begin(),
+                                   Args.end());
+  } else {
+    CallInst *CI = Builder.CreateCall(Callee, Args.begin(), Args.end());
+    CI->setTailCall(cast<CallInst>(Call)->isTailCall());
+    NewCall = CI;
+  }
+  CallSite NCS(NewCall);
+  NCS.setCallingConv(CS.getCallingConv());
+  NCS.setAttributes(getLegalAttributes(CS.getAttributes(), FTy));
+
+  if (FTy->getReturnType() != Int64Ty) {
+    NewCall->takeName(Call);
+    Call->replaceAllUsesWith(NewCall);
+  } else if (WideResult) {
+    std::string Name = Call->getName();
+    Call->setName("");
+    NewCall->setName(Name + ".lo");
+    if (II) {
+      // The phis of the normal destination have it as their only
+      // predecessor, so they are the result itself.
+      BasicBlock *Normal = II->getNormalDest();
+      while (PHINode *PN = dyn_cast<PHINode>(Normal->begin())) {
+        PN->replaceAllUsesWith(PN->getIncomingValue(0));
+        PN->eraseFromParent();
+      }
+      Builder.SetInsertPoint(Normal, Normal->begin());
+    }
+    Value *Hi = Builder.CreateLoad(getTempRetPtr(Int32Ty), Name + ".hi");
+    Call->replaceAllUsesWith(createJoin(Builder, NewCall, Hi, Name));
+  }
+  Call->eraseFromParent();
+}
+
+/// createJoin - Build the i64 with the given halves, in the form that the
+/// function pass splits back into them.
+static Value *createJoin(IRBuilder<> &Builder, Value *Lo, Value *Hi,
+                         const Twine &Name) {
+  const Type *Int64Ty = Type::getInt64Ty(Lo->getContext());
+  Value *High = Builder.CreateShl(Builder.CreateZExt(Hi, Int64Ty), 32);
+  return Builder.CreateOr(Builder.CreateZExt(Lo, Int64Ty), High, Name);
+}
@@ -0,0 +1,303 @@
+//===-- JsLocalColoring.cpp - Local variable reuse for the JsBackend ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the local variable coloring of the javascript code
+// generator.  The live-out sets of the blocks are computed by the usual
+// backward dataflow, and the interference graph is built by walking every
+// block backwards from its live-out set.  The phis are then coalesced with
+// their incoming values into classes whose members do not interfere, those
+// of the back edges first, and the classes are greedily colored in the
+// order in which their first values are emitted.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsLocalColoring.h"
+#include "llvm/BasicBlock.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CFG.h"
+#include <algorithm>
+using namespace llvm;
+
+JsLocalColoring::JsLocalColoring(const std::vector<BasicBlock*> &Blocks,
+                                 std::string (*TypeClass)(const Type *),
+                                 bool CoalescePhis, bool ShareLocals)
+  : NumColors(0), NumCoalesced(0) {
+  for (unsigned b = 0, be = Blocks.size(); b != be; ++b)
+    for (BasicBlock::iterator II = Blocks[b]->begin(), IE = Blocks[b]->end();
+         II != IE; ++II)
+      if (!II->getType()->isVoidTy()) {
+        Numbers[II] = Values.size();
+        Values.push_back(II);
+      }
+
+  computeInterference(Blocks);
+
+  Leaders.resize(Values.size());
+  Members.resize(Values.size());
+  for (unsigned V = 0, e = Values.size(); V != e; ++V) {
+    Leaders[V] = V;
+    Members[V].push_back(V);
+  }
+  if (CoalescePhis)
+    coalescePhis(Blocks);
+
+  // Give every class the first color of its type class that none of the
+  // colored neighbours of its members has.  Without ShareLocals, every class
+  // has a color of its own.
+  std::vector<int> Colors(Values.size(), -1);
+  std::vector<const Value*> ColorNames;
+  std::vector<unsigned> Stamps;
+  StringMap<std::vector<unsigned> > ClassColors;
+  for (unsigned V = 0, e = Values.size(); V != e; ++V) {
+    unsigned Leader = getLeader(V);
+    if (Colors[Leader] >= 0) {
+      Representatives[Values[V]] = ColorNames[Colors[Leader]];
+      continue;
+    }
+
+    int Color = -1;
+    if (ShareLocals) {
+      const std::vector<unsigned> &Class = Members[Leader];
+      for (unsigned m = 0, me = Class.size(); m != me; ++m) {
+        const std::vector<unsigned> &Neighbours = Interference[Class[m]];
+        for (unsigned i = 0, ie = Neighbours.size(); i != ie; ++i) {
+          int NeighbourColor = Colors[getLeader(Neighbours[i])];
+          if (NeighbourColor >= 0)
+            Stamps[NeighbourColor] = V + 1;
+        }
+      }
+
+      std::vector<unsigned> &Candidates =
+        ClassColors[TypeClass(Values[V]->getType())];
+      for (unsigned i = 0, ie = Candidates.size(); i != ie && Color < 0; ++i)
+        if (Stamps[Candidates[i]] != V + 1)
+          Color = Candidates[i];
+      if (Color < 0)
+        Candidates.push_back(NumColors);
+    }
+    if (Color < 0) {
+      Color = NumColors++;
+      ColorNames.push_back(Values[V]);
+      Stamps.push_back(0);
+    }
+    Colors[Leader] = Color;
+    Representatives[Values[V]] = ColorNames[Color];
+  }
+}
+
+/// coalescePhis - Coalesce every phi with those of its incoming values that
+/// it can be.  The copies of the back edges are coalesced first, since they
+/// run on every iteration of the loops.
+void JsLocalColoring::coalescePhis(const std::vector<BasicBlock*> &Blocks) {
+  DenseMap<const BasicBlock*, unsigned> BlockNumbers;
+  for (unsigned b = 0, be = Blocks.size(); b != be; ++b)
+    BlockNumbers[Blocks[b]] = b;
+
+  for (unsigned Pass = 0; Pass != 2; ++Pass)
+    for (unsigned b = 0, be = Blocks.size(); b != be; ++b)
+      for (BasicBlock::iterator II = Blocks[b]->begin();
+           PHINode *PN = dyn_cast<PHINode>(II); ++II) {
+        int P = getNumber(PN);
+        if (P < 0)
+          continue;
+        for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i) {
+          int V = getNumber(PN->getIncomingValue(i));
+          DenseMap<const BasicBlock*, unsigned>::iterator Pred =
+            BlockNumbers.find(PN->getIncomingBlock(i));
+          if (V < 0 || Pred == BlockNumbers.end() ||
+              (Pred->second >= b) != (Pass == 0))
+            continue;
+          if (tryCoalesce(P, V))
+            ++NumCoalesced;
+        }
+      }
+}
+
+/// tryCoalesce - Merge the classes of the values A and B if no member of one
+/// interferes with a member of the other.  Return whether they are merged.
+bool JsLocalColoring::tryCoalesce(unsigned A, unsigned B) {
+  unsigned LeaderA = getLeader(A), LeaderB = getLeader(B);
+  if (LeaderA == LeaderB)
+    return true;
+  if (Members[LeaderA].size() > Members[LeaderB].size())
+    std::swap(LeaderA, LeaderB);
+  const std::vector<unsigned> &Class = Members[LeaderA];
+  for (unsigned m = 0, me = Class.size(); m != me; ++m) {
+    const std::vector<unsigned> &Neighbours = Interference[Class[m]];
+    for (unsigned i = 0, ie = Neighbours.size(); i != ie; ++i)
+      if (getLeader(Neighbours[i]) == LeaderB)
+        return false;
+  }
+  Leaders[LeaderA] = LeaderB;
+  Members[LeaderB].insert(Members[LeaderB].end(), Class.begin(), Class.end());
+  Members[LeaderA].clear();
+  return true;
+}
+
+/// getLeader - Return the root of the class of the value V.
+unsigned JsLocalColoring::getLeader(unsigned V) {
+  unsigned Leader = V;
+  while (Leaders[Leader] != Leader)
+    Leader = Leaders[Leader];
+  while (Leaders[V] != Leader) {
+    unsigned Next = Leaders[V];
+    Leaders[V] = Leader;
+    V = Next;
+  }
+  return Leader;
+}
+
+/// computeInterference - Build the interference graph of the values.
+void JsLocalColoring::computeInterference(
+                                     const std::vector<BasicBlock*> &Blocks) {
+  unsigned NumValues = Values.size();
+  unsigned NumBlocks = Blocks.size();
+  DenseMap<const BasicBlock*, unsigned> BlockNumbers;
+  for (unsigned b = 0; b != NumBlocks; ++b)
+    BlockNumbers[Blocks[b]] = b;
+
+  // The values that each block defines, those that it uses before defining
+  // them, and the incoming values of the phis of its successors, which are
+  // live out of it.
+  std::vector<BitVector> Defs(NumBlocks, BitVector(NumValues));
+  std::vector<BitVector> Uses(NumBlocks, BitVector(NumValues));
+  std::vector<BitVector> LiveOut(NumBlocks, BitVector(NumValues));
+  for (unsigned b = 0; b != NumBlocks; ++b) {
+    BasicBlock *BB = Blocks[b];
+    for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+         ++II) {
+      if (PHINode *PN = dyn_cast<PHINode>(II)) {
+        for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i) {
+          int V = getNumber(PN->getIncomingValue(i));
+          DenseMap<const BasicBlock*, unsigned>::iterator Pred =
+            BlockNumbers.find(PN->getIncomingBlock(i));
+          if (V >= 0 && Pred != BlockNumbers.end())
+            LiveOut[Pred->second].set(V);
+        }
+      } else {
+        for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+             OI != OE; ++OI) {
+          int V = getNumber(*OI);
+          if (V >= 0 && !Defs[b].test(V))
+            Uses[b].set(V);
+        }
+      }
+      int V = getNumber(II);
+      if (V >= 0)
+        Defs[b].set(V);
+    }
+  }
+
+  // Iterate to a fixed point, visiting the blocks backwards so that most
+  // live ranges propagate in a single pass.
+  std::vector<BitVector> LiveIn(NumBlocks, BitVector(NumValues));
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned b = NumBlocks; b-- != 0; ) {
+      BasicBlock *BB = Blocks[b];
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI) {
+        DenseMap<const BasicBlock*, unsigned>::iterator Succ =
+          BlockNumbers.find(*SI);
+        if (Succ != BlockNumbers.end())
+          LiveOut[b] |= LiveIn[Succ->second];
+      }
+      BitVector In(LiveOut[b]);
+      for (int V = Defs[b].find_first(); V >= 0; V = Defs[b].find_next(V))
+        In.reset(V);
+      In |= Uses[b];
+      if (In != LiveIn[b]) {
+        LiveIn[b] = In;
+        Changed = true;
+      }
+    }
+  }
+
+  Interference.resize(NumValues);
+  for (unsigned b = 0; b != NumBlocks; ++b) {
+    BasicBlock *BB = Blocks[b];
+    BitVector Live(LiveOut[b]);
+
+    // The phis of a successor are assigned together on the edge to it, after
+    // the copies have read their incoming values, which the edge does not
+    // need any more unless they are live into the successor.
+    for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+         ++SI) {
+      DenseMap<const BasicBlock*, unsigned>::iterator Succ =
+        BlockNumbers.find(*SI);
+      if (Succ == BlockNumbers.end())
+        continue;
+      for (BasicBlock::iterator II = (*SI)->begin(); isa<PHINode>(II); ++II) {
+        int P = getNumber(II);
+        if (P < 0)
+          continue;
+        addInterference(P, LiveIn[Succ->second]);
+        for (BasicBlock::iterator PI = (*SI)->begin(); PI != II; ++PI)
+          if (getNumber(PI) >= 0)
+            addInterference(P, getNumber(PI));
+      }
+    }
+
+    for (BasicBlock::iterator II = BB->end(); II != BB->begin(); ) {
+      --II;
+      if (isa<PHINode>(II))
+        break;
+      // The values that are computed by a single assignment are written
+      // after their operands are read for the last time.
+      int V = getNumber(II);
+      bool SingleAssignment =
+        isa<BinaryOperator>(II) || isa<CastInst>(II) || isa<CmpInst>(II) ||
+        isa<SelectInst>(II) || isa<GetElementPtrInst>(II) || isa<LoadInst>(II);
+      if (V >= 0 && SingleAssignment) {
+        Live.reset(V);
+        addInterference(V, Live);
+      }
+      for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+           OI != OE; ++OI) {
+        int Op = getNumber(*OI);
+        if (Op >= 0)
+          Live.set(Op);
+      }
+      if (V >= 0 && !SingleAssignment) {
+        Live.reset(V);
+        addInterference(V, Live);
+      }
+    }
+  }
+
+  for (unsigned V = 0; V != NumValues; ++V) {
+    std::vector<unsigned> &Neighbours = Interference[V];
+    std::sort(Neighbours.begin(), Neighbours.end());
+    Neighbours.erase(std::unique(Neighbours.begin(), Neighbours.end()),
+                     Neighbours.end());
+  }
+}
+
+/// addInterference - Record that the value V interferes with every value in
+/// Live.
+void JsLocalColoring::addInterference(unsigned V, const BitVector &Live) {
+  for (int L = Live.find_first(); L >= 0; L = Live.find_next(L))
+    addInterference(V, L);
+}
+
+void JsLocalColoring::addInterference(unsigned A, unsigned B) {
+  if (A == B)
+    return;
+  Interference[A].push_back(B);
+  Interference[B].push_back(A);
+}
+
+/// getNumber - Return the number of the given value, or -1 if it is not kept
+/// in a local of this function.
+int JsLocalColoring::getNumber(const Value *V) const {
+  DenseMap<const Value*, unsigned>::const_iterator I = Numbers.find(V);
+  return I == Numbers.end() ? -1 : (int)I->second;
+}
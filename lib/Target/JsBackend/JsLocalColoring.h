@@ -0,0 +1,100 @@
+//===-- JsLocalColoring.h - Local variable reuse for the JsBackend -*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the local variable coloring of the javascript code
+// generator, which lets values whose live ranges do not overlap share one
+// javascript local, in the way StackSlotColoring shares stack slots.  It
+// also takes the function out of SSA form: a phi is coalesced with its
+// incoming values where their live ranges do not overlap, in the spirit of
+// StrongPHIElimination, so that the copy that assigns the phi on the edge
+// from a predecessor goes away.
+//
+// The live ranges are computed over the CFG of the function as the code
+// generator emits it: the phis of a block are assigned in parallel on each
+// edge that leads to it, so they interfere with each other and with every
+// value that is live into the block, but not with the values that the
+// copies read.  The definition of a value also interferes with its own
+// operands, which the generated code may read again after the assignment,
+// except for the values that are computed by a single assignment.  Edges
+// are never split, since the code generator has a place for the copies of
+// every edge.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSLOCALCOLORING_H
+#define JSLOCALCOLORING_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class BasicBlock;
+class Type;
+class Value;
+
+/// JsLocalColoring - An assignment of the values that the code generator
+/// keeps in locals to a small set of javascript variables.
+///
+/// Values are only colored together when their javascript representations
+/// have the same type class, given by the initializer of the local, so that
+/// each variable keeps a single type.  The variable of a color is named after
+/// the first value that was given the color.
+class JsLocalColoring {
+  std::vector<const Value*> Values;
+  DenseMap<const Value*, unsigned> Numbers;
+  std::vector<std::vector<unsigned> > Interference;
+  DenseMap<const Value*, const Value*> Representatives;
+  unsigned NumColors, NumCoalesced;
+
+  // The coalesced values, as a union-find forest, and the members of the
+  // class of each root.
+  std::vector<unsigned> Leaders;
+  std::vector<std::vector<unsigned> > Members;
+
+public:
+  /// JsLocalColoring - Color the locals of the function with the given
+  /// blocks.  TypeClass maps a type to its class.  With CoalescePhis, the
+  /// phis share the locals of their incoming values where they can, and with
+  /// ShareLocals, the other values whose live ranges do not overlap share
+  /// locals too.
+  JsLocalColoring(const std::vector<BasicBlock*> &Blocks,
+                  std::string (*TypeClass)(const Type *), bool CoalescePhis,
+                  bool ShareLocals);
+
+  /// getRepresentatives - Return the map from every colored value to the
+  /// value whose name its variable has.
+  const DenseMap<const Value*, const Value*> &getRepresentatives() const {
+    return Representatives;
+  }
+
+  /// getNumValues - Return the number of values that were colored.
+  unsigned getNumValues() const { return Values.size(); }
+
+  /// getNumColors - Return the number of variables they were colored with.
+  unsigned getNumColors() const { return NumColors; }
+
+  /// getNumCoalesced - Return the number of phi copies that were coalesced.
+  unsigned getNumCoalesced() const { return NumCoalesced; }
+
+private:
+  void computeInterference(const std::vector<BasicBlock*> &Blocks);
+  void addInterference(unsigned V, const BitVector &Live);
+  void addInterference(unsigned A, unsigned B);
+  void coalescePhis(const std::vector<BasicBlock*> &Blocks);
+  bool tryCoalesce(unsigned A, unsigned B);
+  unsigned getLeader(unsigned V);
+  int getNumber(const Value *V) const;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,83 @@
+//===-- JsNameMinifier.cpp - Short identifiers for the JsBackend ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the name minifier of the javascript backend.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsNameMinifier.h"
+#include "llvm/ADT/STLExtras.h"
+#include <algorithm>
+using namespace llvm;
+
+static const char JsIdentifierChars[] =
+  "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$0123456789";
+
+/// JsReservedNames - The javascript keywords and literals, and the names of
+/// the runtime and of the helper variables of the code generator.
+static const char *const JsReservedNames[] = {
+  "break", "case", "catch", "class", "const", "continue", "debugger",
+  "default", "delete", "do", "else", "enum", "export", "extends", "false",
+  "finally", "for", "function", "if", "implements", "import", "in",
+  "instanceof", "interface", "let", "new", "null", "package", "private",
+  "protected", "public", "return", "static", "super", "switch", "this",
+  "throw", "true", "try", "typeof", "var", "void", "while", "with", "yield",
+  "arguments", "eval", "undefined", "NaN", "Infinity",
+  "JsModule", "global", "env", "buffer", "HEAP8", "HEAP16", "HEAP32",
+  "HEAPU8", "HEAPU16", "HEAPU32", "HEAPF32", "HEAPF64", "Math_imul",
+  "Math_fround", "Math_floor", "abort", "tempDoublePtr", "STACKTOP",
+  "i64_hi", "i64_make", "i64_u", "i64_s", "i64_trunc",
+  "i64_sdiv", "i64_udiv", "i64_urem", "i64_and", "i64_or", "i64_xor",
+  "i64_shl", "i64_lshr", "i64_ashr", "args", "argbuf", "sp", "label", "exn",
+  "ehsp", "eh_selector", "loadChunk", "loadedChunks", "chunk"
+};
+
+JsNameMinifier::JsNameMinifier() : ReserveUnderscore(false) {
+  for (unsigned i = 0, e = array_lengthof(JsReservedNames); i != e; ++i)
+    Reserved.insert(JsReservedNames[i]);
+}
+
+std::string JsNameMinifier::getIdentifier(unsigned Number) {
+  std::string Name(1, JsIdentifierChars[Number % 54]);
+  Number /= 54;
+  while (Number) {
+    --Number;
+    Name += JsIdentifierChars[Number % 64];
+    Number /= 64;
+  }
+  return Name;
+}
+
+std::string JsNameMinifier::getNextName(unsigned &Number) const {
+  while (true) {
+    std::string Name = getIdentifier(Number++);
+    // The code generator names the temporaries of phis after them, and the
+    // function tables after their signatures.
+    if (Reserved.count(Name) || StringRef(Name).endswith("$phi") ||
+        StringRef(Name).startswith("FUNCTION_TABLE_"))
+      continue;
+    if (ReserveUnderscore && Name[0] == '_')
+      continue;
+    return Name;
+  }
+}
+
+static bool hasHigherCount(const std::pair<unsigned, const Value*> &A,
+                           const std::pair<unsigned, const Value*> &B) {
+  return A.first > B.first;
+}
+
+void JsNameMinifier::assignNames(
+                        std::vector<std::pair<unsigned, const Value*> > &Counts,
+                        std::vector<std::string> &Names) const {
+  std::stable_sort(Counts.begin(), Counts.end(), hasHigherCount);
+  unsigned Number = 0;
+  for (unsigned i = 0, e = Counts.size(); i != e; ++i)
+    Names.push_back(getNextName(Number));
+}
@@ -0,0 +1,65 @@
+//===-- JsNameMinifier.h - Short identifiers for the JsBackend --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the name minifier of the javascript backend, which gives
+// the locals and internal globals of the output the shortest identifiers, in
+// the order of their use counts.
+//
+// Identifiers are numbered like a base-54 digit followed by base-64 digits:
+// the first character is a letter, '_' or '$', and the others may also be
+// digits.  Javascript keywords, the names of the runtime of the code
+// generator and the names that the output uses for other purposes are
+// reserved, and are skipped.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSNAMEMINIFIER_H
+#define JSNAMEMINIFIER_H
+
+#include "llvm/ADT/StringSet.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class Value;
+
+class JsNameMinifier {
+  StringSet<> Reserved;
+  bool ReserveUnderscore;
+
+public:
+  JsNameMinifier();
+
+  /// reserve - Never hand out the given name.
+  void reserve(StringRef Name) { Reserved.insert(Name); }
+
+  /// reserveUnderscore - Never hand out names that start with '_', which the
+  /// code generator keeps for the globals that are not minified.
+  void reserveUnderscore() { ReserveUnderscore = true; }
+
+  /// getIdentifier - Return the identifier with the given number, ignoring
+  /// the reserved names.
+  static std::string getIdentifier(unsigned Number);
+
+  /// getNextName - Return the first free identifier whose number is not
+  /// below Number, and advance Number past it.
+  std::string getNextName(unsigned &Number) const;
+
+  /// assignNames - Give the values the shortest free identifiers, the value
+  /// with the highest count first.  Values with the same count keep their
+  /// order.  The names are appended to Names in the order of Counts.
+  void assignNames(std::vector<std::pair<unsigned, const Value*> > &Counts,
+                   std::vector<std::string> &Names) const;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,192 @@
+//===-- JsProfiling.cpp - Profiling instrumentation of the JsBackend ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the profiling instrumentation of the javascript code
+// generator.  The program cannot write files, so instead of calling the
+// profiling runtime, which dumps the counters at exit, the instrumented module
+// keeps the whole llvmprof.out file in its heap, and the counters are updated
+// in place:
+//
+//   [1, 0]                      ArgumentInfo, with an empty command line
+//   [2, NF, <NF counters>]      FunctionInfo, the entry count of every
+//                               defined function, in module order
+//   [7, NE, <NE counters>]      OptEdgeInfo, the counters of the edges that
+//                               the optimal edge profiler selected
+//
+// The edge counters are those of the optimal edge profiler, which runs before
+// this pass, and whose initialization call in main is removed here.  Modules
+// without a main function are not instrumented by it, and only count the
+// entries of their functions.
+//
+// The module exports llvm_prof_data and llvm_prof_size, which return the
+// address and the size of the file in the heap, so that the host can save it
+// once the program is done, and feed it back to llvm-prof or to the profile
+// loader.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "js-profiling"
+#include "JsTargetMachine.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ProfileInfoTypes.h"
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumFunctionCounters, "Number of function entry counters");
+STATISTIC(NumEdgeCounters, "Number of edge counters");
+
+namespace {
+  class JsProfiling : public ModulePass {
+  public:
+    static char ID;
+    JsProfiling() : ModulePass(ID) {}
+
+    virtual const char *getPassName() const {
+      return "Javascript profiling instrumentation";
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    void removeInitCall(Module &M);
+    void createAccessor(Module &M, const char *Name, Constant *Result);
+  };
+}
+
+char JsProfiling::ID = 0;
+
+ModulePass *llvm::createJsProfilingPass() { return new JsProfiling(); }
+
+/// removeInitCall - Remove the call to the runtime that the optimal edge
+/// profiler inserted in main, giving its uses back the argc that it returns.
+void JsProfiling::removeInitCall(Module &M) {
+  Function *Init = M.getFunction("llvm_start_opt_edge_profiling");
+  if (!Init)
+    return;
+  while (!Init->use_empty()) {
+    CallInst *CI = cast<CallInst>(Init->use_back());
+    CI->replaceAllUsesWith(CI->getArgOperand(0));
+    CI->eraseFromParent();
+  }
+  Init->eraseFromParent();
+}
+
+/// createAccessor - Add an external function of the given name that returns
+/// the constant Result.
+void JsProfiling::createAccessor(Module &M, const char *Name,
+                                 Constant *Result) {
+  Function *F = Function::Create(
+    FunctionType::get(Result->getType(), false), GlobalValue::ExternalLinkage,
+    Name, &M);
+  BasicBlock *BB = BasicBlock::Create(M.getContext(), "entry", F);
+  ReturnInst::Create(M.getContext(), Result, BB);
+}
+
+/// getPacket - Return a packet of the given type and counters, as the
+/// profiling runtime writes it.
+static Constant *getPacket(LLVMContext &Context, unsigned PacketType,
+                           const std::vector<Constant*> &Counters) {
+  const IntegerType *Int32Ty = Type::getInt32Ty(Context);
+  Constant *Header[] = {
+    ConstantInt::get(Int32Ty, PacketType),
+    ConstantInt::get(Int32Ty, Counters.size())
+  };
+  Constant *Fields[] = {
+    ConstantArray::get(ArrayType::get(Int32Ty, 2), Header, 2),
+    ConstantArray::get(ArrayType::get(Int32Ty, Counters.size()), Counters)
+  };
+  return ConstantStruct::get(Context, Fields, 2, false);
+}
+
+bool JsProfiling::runOnModule(Module &M) {
+  LLVMContext &Context = M.getContext();
+  const IntegerType *Int32Ty = Type::getInt32Ty(Context);
+
+  // The functions that the profile loader reads counts for.
+  std::vector<Function*> Functions;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration())
+      Functions.push_back(F);
+
+  removeInitCall(M);
+
+  std::vector<Constant*> Packets;
+  std::vector<Constant*> Empty;
+  Packets.push_back(getPacket(Context, ArgumentInfo, Empty));
+  Packets.push_back(getPacket(Context, FunctionInfo,
+                   std::vector<Constant*>(Functions.size(),
+                                          ConstantInt::get(Int32Ty, 0))));
+  NumFunctionCounters += Functions.size();
+
+  GlobalVariable *Edges = M.getNamedGlobal("OptEdgeProfCounters");
+  if (Edges) {
+    // The counters start at 0, or at Uncounted for the edges whose counts
+    // are derived from the others.
+    Constant *Init = Edges->getInitializer();
+    unsigned NumEdges =
+      cast<ArrayType>(Init->getType())->getNumElements();
+    std::vector<Constant*> Counters(NumEdges, ConstantInt::get(Int32Ty, 0));
+    if (ConstantArray *CA = dyn_cast<ConstantArray>(Init))
+      for (unsigned i = 0; i != NumEdges; ++i)
+        Counters[i] = CA->getOperand(i);
+    Packets.push_back(getPacket(Context, OptEdgeInfo, Counters));
+    NumEdgeCounters += Counters.size();
+  }
+
+  Constant *Data = ConstantStruct::get(Context, Packets, false);
+  GlobalVariable *File =
+    new GlobalVariable(M, Data->getType(), false, GlobalValue::InternalLinkage,
+                       Data, "llvm_prof_file");
+
+  // The counters of a packet are field 1 of its struct, and the profiler
+  // indexes the edge counters as the array that they are.
+  Constant *Indices[4];
+  Indices[0] = ConstantInt::get(Int32Ty, 0);
+  Indices[2] = ConstantInt::get(Int32Ty, 1);
+  if (Edges) {
+    Indices[1] = ConstantInt::get(Int32Ty, 2);
+    Edges->replaceAllUsesWith(
+      ConstantExpr::getGetElementPtr(File, Indices, 3));
+    Edges->eraseFromParent();
+  }
+
+  // Count the entries of the functions where the profiler counts the entries
+  // of the blocks, after the phis and allocas.
+  Indices[1] = ConstantInt::get(Int32Ty, 1);
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    BasicBlock &Entry = Functions[i]->getEntryBlock();
+    BasicBlock::iterator InsertPos = Entry.getFirstNonPHI();
+    while (isa<AllocaInst>(InsertPos))
+      ++InsertPos;
+    Indices[3] = ConstantInt::get(Int32Ty, i);
+    Constant *Counter = ConstantExpr::getGetElementPtr(File, Indices, 4);
+    Value *Count = new LoadInst(Counter, "OldFuncCounter", InsertPos);
+    Count = BinaryOperator::Create(Instruction::Add, Count,
+                                   ConstantInt::get(Int32Ty, 1),
+                                   "NewFuncCounter", InsertPos);
+    new StoreInst(Count, Counter, InsertPos);
+  }
+
+  // The accessors come after the profiled functions, which keeps the order
+  // of the counters that of the uninstrumented module.
+  createAccessor(M, "llvm_prof_data",
+                 ConstantExpr::getPtrToInt(File, Int32Ty));
+  unsigned NumWords = 0;
+  for (unsigned i = 0, e = Packets.size(); i != e; ++i)
+    NumWords += 2 + cast<ArrayType>(
+      cast<StructType>(Packets[i]->getType())->getElementType(1))
+        ->getNumElements();
+  createAccessor(M, "llvm_prof_size", ConstantInt::get(Int32Ty, NumWords * 4));
+  return true;
+}
@@ -0,0 +1,433 @@
+//===-- JsRelooper.cpp - Structured control flow for the JsBackend --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the relooper of the javascript code generator.  Once
+// the irreducible cycles have been given a single entry, the dominator tree of
+// the CFG is turned into nested loops and labeled blocks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsRelooper.h"
+#include "llvm/BasicBlock.h"
+#include "llvm/Instructions.h"
+#include <algorithm>
+using namespace llvm;
+
+/// JS_COLD_EDGE_RATIO - A successor is cold if it is taken less than once in
+/// this many executions of its block.
+static const double JS_COLD_EDGE_RATIO = 16;
+
+JsRelooper::JsRelooper(const std::vector<BasicBlock*> &Blocks,
+                       ProfileInfo *PI)
+  : NumDispatchNodes(0), Root(0), NumLabels(0) {
+  DenseMap<const BasicBlock*, unsigned> BlockNumbers;
+  Nodes.resize(Blocks.size());
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    Nodes[i].BB = Blocks[i];
+    BlockNumbers[Blocks[i]] = i;
+  }
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    const TerminatorInst *TI = Blocks[i]->getTerminator();
+    // The unwind destination of an invoke that cannot throw is never taken.
+    const InvokeInst *II = dyn_cast<InvokeInst>(TI);
+    unsigned NumSuccs = II && II->doesNotThrow() ? 1 : TI->getNumSuccessors();
+    for (unsigned s = 0; s != NumSuccs; ++s) {
+      BasicBlock *Succ = TI->getSuccessor(s);
+      Nodes[i].Succs.push_back(BlockNumbers.lookup(Succ));
+      Nodes[i].Dests.push_back(Succ);
+      Nodes[i].SetLabels.push_back(-1);
+      Nodes[i].Weights.push_back(PI ? PI->getEdgeWeight(
+                                        ProfileInfo::getEdge(Blocks[i], Succ))
+                                    : ProfileInfo::MissingValue);
+    }
+  }
+
+  // Only the blocks that are reachable from the entry are structured.
+  std::vector<unsigned> Reachable;
+  std::vector<bool> Visited(Nodes.size());
+  Reachable.push_back(0);
+  Visited[0] = true;
+  for (unsigned i = 0; i != Reachable.size(); ++i) {
+    const std::vector<unsigned> &Succs = Nodes[Reachable[i]].Succs;
+    for (unsigned s = 0, e = Succs.size(); s != e; ++s)
+      if (!Visited[Succs[s]]) {
+        Visited[Succs[s]] = true;
+        Reachable.push_back(Succs[s]);
+      }
+  }
+
+  makeReducible(Reachable, 0);
+  computeDominators();
+
+  // Classify the edges: an edge that goes back in reverse postorder is a back
+  // edge, and its target is the header of a loop.
+  ForwardPreds.assign(Nodes.size(), 0);
+  LoopHeaders.assign(Nodes.size(), false);
+  Outlined.assign(Nodes.size(), false);
+  for (unsigned N = 0, e = Nodes.size(); N != e; ++N) {
+    if (RPONumbers[N] == ~0U)
+      continue;
+    const std::vector<unsigned> &Succs = Nodes[N].Succs;
+    for (unsigned s = 0, se = Succs.size(); s != se; ++s) {
+      unsigned Succ = Succs[s];
+      if (RPONumbers[Succ] > RPONumbers[N]) {
+        ++ForwardPreds[Succ];
+      } else {
+        assert(dominates(Succ, N) && "Irreducible control flow left!");
+        LoopHeaders[Succ] = true;
+      }
+    }
+  }
+
+  // The cold successors that would be nested in the code of their only
+  // forward predecessor are outlined, i.e. placed after it like merge nodes.
+  for (unsigned N = 0, e = Nodes.size(); N != e; ++N) {
+    if (RPONumbers[N] == ~0U)
+      continue;
+    const std::vector<unsigned> &Succs = Nodes[N].Succs;
+    for (unsigned s = 0, se = Succs.size(); s != se; ++s)
+      if (RPONumbers[Succs[s]] > RPONumbers[N] &&
+          ForwardPreds[Succs[s]] == 1 && isColdSuccessor(N, s))
+        Outlined[Succs[s]] = true;
+  }
+
+  Root = buildTree(0);
+}
+
+/// makeReducible - Give every cycle of Region a single entry, ignoring the
+/// edges into Header, which is the entry of the region itself.  Cycles with
+/// several entries get a dispatch node that becomes their only entry, and
+/// then the cycles nested in every cycle are processed in turn.
+void JsRelooper::makeReducible(const std::vector<unsigned> &Region,
+                               unsigned Header) {
+  std::vector<std::vector<unsigned> > Cycles;
+  findCycles(Region, Header, Cycles);
+
+  for (unsigned c = 0, ce = Cycles.size(); c != ce; ++c) {
+    std::vector<unsigned> &Cycle = Cycles[c];
+    std::vector<bool> InCycle(Nodes.size());
+    for (unsigned i = 0, e = Cycle.size(); i != e; ++i)
+      InCycle[Cycle[i]] = true;
+
+    // Other nodes of the region can only be reached through Header, so the
+    // edges into the cycle all come from the region.
+    std::vector<unsigned> Entries;
+    for (unsigned i = 0, e = Region.size(); i != e; ++i) {
+      unsigned N = Region[i];
+      if (InCycle[N])
+        continue;
+      const std::vector<unsigned> &Succs = Nodes[N].Succs;
+      for (unsigned s = 0, se = Succs.size(); s != se; ++s)
+        if (InCycle[Succs[s]])
+          Entries.push_back(Succs[s]);
+    }
+    std::sort(Entries.begin(), Entries.end());
+    Entries.erase(std::unique(Entries.begin(), Entries.end()), Entries.end());
+
+    if (Entries.size() == 1) {
+      makeReducible(Cycle, Entries[0]);
+      continue;
+    }
+
+    // Route all the edges into the entries through a new dispatch node.
+    unsigned Dispatch = Nodes.size();
+    Nodes.push_back(Node());
+    Nodes[Dispatch].BB = 0;
+    ++NumDispatchNodes;
+    std::vector<bool> IsEntry(Nodes.size());
+    for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+      IsEntry[Entries[i]] = true;
+      Nodes[Dispatch].Succs.push_back(Entries[i]);
+      Nodes[Dispatch].Dests.push_back(Nodes[Entries[i]].BB);
+      Nodes[Dispatch].SetLabels.push_back(-1);
+      Nodes[Dispatch].Weights.push_back(ProfileInfo::MissingValue);
+      Nodes[Dispatch].DispatchValues.push_back(Entries[i]);
+    }
+    for (unsigned i = 0, e = Region.size(); i != e; ++i) {
+      Node &From = Nodes[Region[i]];
+      for (unsigned s = 0, se = From.Succs.size(); s != se; ++s)
+        if (IsEntry[From.Succs[s]]) {
+          From.SetLabels[s] = From.Succs[s];
+          From.Succs[s] = Dispatch;
+        }
+    }
+
+    Cycle.push_back(Dispatch);
+    makeReducible(Cycle, Dispatch);
+  }
+}
+
+/// findCycles - Find the strongly connected components of Region that contain
+/// a cycle, ignoring the edges into Header.  This is Tarjan's algorithm,
+/// with an explicit stack.
+void JsRelooper::findCycles(const std::vector<unsigned> &Region,
+                            unsigned Header,
+                            std::vector<std::vector<unsigned> > &Cycles) {
+  const unsigned None = ~0U;
+  std::vector<bool> InRegion(Nodes.size());
+  for (unsigned i = 0, e = Region.size(); i != e; ++i)
+    InRegion[Region[i]] = true;
+  InRegion[Header] = false;
+
+  std::vector<unsigned> Index(Nodes.size(), None), LowLink(Nodes.size());
+  std::vector<bool> OnStack(Nodes.size());
+  std::vector<unsigned> Stack;
+  std::vector<std::pair<unsigned, unsigned> > Work;
+  unsigned NextIndex = 0;
+
+  for (unsigned r = 0, re = Region.size(); r != re; ++r) {
+    if (!InRegion[Region[r]] || Index[Region[r]] != None)
+      continue;
+    Work.push_back(std::make_pair(Region[r], 0U));
+    while (!Work.empty()) {
+      unsigned N = Work.back().first;
+      unsigned &NextSucc = Work.back().second;
+      if (NextSucc == 0 && Index[N] == None) {
+        Index[N] = LowLink[N] = NextIndex++;
+        Stack.push_back(N);
+        OnStack[N] = true;
+      }
+
+      const std::vector<unsigned> &Succs = Nodes[N].Succs;
+      if (NextSucc != Succs.size()) {
+        unsigned Succ = Succs[NextSucc++];
+        if (!InRegion[Succ])
+          continue;
+        if (Index[Succ] == None)
+          Work.push_back(std::make_pair(Succ, 0U));
+        else if (OnStack[Succ])
+          LowLink[N] = std::min(LowLink[N], Index[Succ]);
+        continue;
+      }
+
+      Work.pop_back();
+      if (!Work.empty())
+        LowLink[Work.back().first] =
+          std::min(LowLink[Work.back().first], LowLink[N]);
+      if (LowLink[N] != Index[N])
+        continue;
+
+      // N is the root of a component.
+      std::vector<unsigned> Component;
+      unsigned M;
+      do {
+        M = Stack.back();
+        Stack.pop_back();
+        OnStack[M] = false;
+        Component.push_back(M);
+      } while (M != N);
+
+      bool IsCycle = Component.size() > 1;
+      for (unsigned s = 0, se = Succs.size(); s != se && !IsCycle; ++s)
+        IsCycle = Succs[s] == N;
+      if (IsCycle) {
+        std::sort(Component.begin(), Component.end());
+        Cycles.push_back(Component);
+      }
+    }
+  }
+}
+
+/// computeDominators - Number the reachable nodes in reverse postorder and
+/// compute their immediate dominators, with the algorithm of Cooper, Harvey
+/// and Kennedy.
+void JsRelooper::computeDominators() {
+  const unsigned None = ~0U;
+  std::vector<unsigned> Order;
+  std::vector<bool> Visited(Nodes.size());
+  std::vector<std::pair<unsigned, unsigned> > Work;
+  Work.push_back(std::make_pair(0U, 0U));
+  Visited[0] = true;
+  // The successors are visited from the coldest to the hottest, so that in
+  // reverse postorder the hot ones come first.  Without a profile, they are
+  // visited in order.
+  std::vector<std::vector<unsigned> > VisitOrders(Nodes.size());
+  for (unsigned N = 0, e = Nodes.size(); N != e; ++N) {
+    std::vector<unsigned> &VisitOrder = VisitOrders[N];
+    const std::vector<double> &Weights = Nodes[N].Weights;
+    bool Known = true;
+    for (unsigned s = 0, se = Weights.size(); s != se; ++s)
+      Known &= Weights[s] != ProfileInfo::MissingValue;
+    for (unsigned s = 0, se = Weights.size(); s != se; ++s) {
+      unsigned i = VisitOrder.size();
+      while (Known && i != 0 && Weights[VisitOrder[i - 1]] > Weights[s])
+        --i;
+      VisitOrder.insert(VisitOrder.begin() + i, s);
+    }
+  }
+  while (!Work.empty()) {
+    unsigned N = Work.back().first;
+    unsigned &NextSucc = Work.back().second;
+    if (NextSucc != Nodes[N].Succs.size()) {
+      unsigned Succ = Nodes[N].Succs[VisitOrders[N][NextSucc++]];
+      if (!Visited[Succ]) {
+        Visited[Succ] = true;
+        Work.push_back(std::make_pair(Succ, 0U));
+      }
+      continue;
+    }
+    Order.push_back(N);
+    Work.pop_back();
+  }
+  std::reverse(Order.begin(), Order.end());
+
+  RPONumbers.assign(Nodes.size(), None);
+  for (unsigned i = 0, e = Order.size(); i != e; ++i)
+    RPONumbers[Order[i]] = i;
+
+  std::vector<std::vector<unsigned> > Preds(Nodes.size());
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    const std::vector<unsigned> &Succs = Nodes[Order[i]].Succs;
+    for (unsigned s = 0, se = Succs.size(); s != se; ++s)
+      Preds[Succs[s]].push_back(Order[i]);
+  }
+
+  IDoms.assign(Nodes.size(), None);
+  IDoms[0] = 0;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned i = 1, e = Order.size(); i != e; ++i) {
+      unsigned N = Order[i];
+      unsigned NewIDom = None;
+      for (unsigned p = 0, pe = Preds[N].size(); p != pe; ++p) {
+        unsigned Pred = Preds[N][p];
+        if (IDoms[Pred] == None)
+          continue;
+        if (NewIDom == None) {
+          NewIDom = Pred;
+          continue;
+        }
+        // Intersect the paths to the entry.
+        unsigned A = Pred, B = NewIDom;
+        while (A != B) {
+          while (RPONumbers[A] > RPONumbers[B])
+            A = IDoms[A];
+          while (RPONumbers[B] > RPONumbers[A])
+            B = IDoms[B];
+        }
+        NewIDom = A;
+      }
+      if (IDoms[N] != NewIDom) {
+        IDoms[N] = NewIDom;
+        Changed = true;
+      }
+    }
+  }
+
+  // The children of every node are listed in reverse postorder.
+  DomChildren.assign(Nodes.size(), std::vector<unsigned>());
+  for (unsigned i = 1, e = Order.size(); i != e; ++i)
+    DomChildren[IDoms[Order[i]]].push_back(Order[i]);
+}
+
+bool JsRelooper::dominates(unsigned A, unsigned B) const {
+  while (B != A && B != 0)
+    B = IDoms[B];
+  return B == A;
+}
+
+/// isColdSuccessor - Return true if the profile shows that successor i of N
+/// is rarely taken.  Nothing is cold in blocks that never ran, or that have
+/// a single successor.
+bool JsRelooper::isColdSuccessor(unsigned N, unsigned i) const {
+  const std::vector<double> &Weights = Nodes[N].Weights;
+  const std::vector<BasicBlock*> &Dests = Nodes[N].Dests;
+  if (Weights.size() < 2)
+    return false;
+  // The successors with the same destination share the weight of the edge.
+  double Total = 0;
+  for (unsigned s = 0, se = Weights.size(); s != se; ++s) {
+    if (Weights[s] == ProfileInfo::MissingValue)
+      return false;
+    if (std::find(Dests.begin(), Dests.begin() + s, Dests[s]) ==
+        Dests.begin() + s)
+      Total += Weights[s];
+  }
+  return Total > 0 && Weights[i] * JS_COLD_EDGE_RATIO < Total;
+}
+
+/// buildTree - Build the code of node N and of the nodes that it dominates.
+/// The children of N that are merge nodes, i.e. that have several forward
+/// predecessors, or that are outlined, follow the code of N in reverse
+/// postorder, each one after a labeled block that encloses all its
+/// predecessors.  The other children are nested in the code of N by
+/// buildBranch.
+const JsShape *JsRelooper::buildTree(unsigned N) {
+  std::vector<unsigned> Merges;
+  for (unsigned i = 0, e = DomChildren[N].size(); i != e; ++i)
+    if (ForwardPreds[DomChildren[N][i]] > 1 || Outlined[DomChildren[N][i]])
+      Merges.push_back(DomChildren[N][i]);
+
+  if (!LoopHeaders[N])
+    return buildNodeWithin(N, Merges, Merges.size());
+
+  JsShape *S = newShape(JsShape::Loop);
+  S->Label = LoopLabels[N] = NumLabels++;
+  S->Inner = buildNodeWithin(N, Merges, Merges.size());
+  return S;
+}
+
+/// buildNodeWithin - Build the code of N, followed by the first NumMerges of
+/// its merge children.
+const JsShape *JsRelooper::buildNodeWithin(unsigned N,
+                                           const std::vector<unsigned> &Merges,
+                                           unsigned NumMerges) {
+  if (NumMerges == 0) {
+    JsShape *S = newShape(JsShape::Simple);
+    S->Node = N;
+    for (unsigned i = 0, e = Nodes[N].Succs.size(); i != e; ++i)
+      S->Branches.push_back(buildBranch(N, i));
+    return S;
+  }
+
+  // The last merge child comes after all the others, so its block is the
+  // outermost one.
+  unsigned Merge = Merges[NumMerges - 1];
+  JsShape *S = newShape(JsShape::Block);
+  S->Label = BlockLabels[Merge] = NumLabels++;
+  S->Inner = buildNodeWithin(N, Merges, NumMerges - 1);
+  S->Next = buildTree(Merge);
+  return S;
+}
+
+/// buildBranch - Build the transfer of control along successor i of From.
+JsBranch JsRelooper::buildBranch(unsigned From, unsigned i) {
+  unsigned To = Nodes[From].Succs[i];
+  JsBranch B;
+  B.Dest = Nodes[From].Dests[i];
+  B.SetLabel = Nodes[From].SetLabels[i];
+  B.Cold = isColdSuccessor(From, i);
+  B.Target = 0;
+  B.Label = 0;
+  if (RPONumbers[To] <= RPONumbers[From]) {
+    assert(LoopLabels.count(To) && "Back edge outside of its loop!");
+    B.Kind = JsBranch::Continue;
+    B.Label = LoopLabels[To];
+  } else if (ForwardPreds[To] > 1 || Outlined[To]) {
+    assert(BlockLabels.count(To) && "Break outside of its block!");
+    B.Kind = JsBranch::Break;
+    B.Label = BlockLabels[To];
+  } else {
+    B.Kind = JsBranch::Nested;
+    B.Target = buildTree(To);
+  }
+  return B;
+}
+
+JsShape *JsRelooper::newShape(JsShape::ShapeKind Kind) {
+  Shapes.push_back(JsShape());
+  JsShape *S = &Shapes.back();
+  S->Kind = Kind;
+  S->Label = 0;
+  S->Node = 0;
+  S->Inner = 0;
+  S->Next = 0;
+  return S;
+}
@@ -0,0 +1,170 @@
+//===-- JsRelooper.h - Structured control flow of the JsBackend -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the relooper of the javascript code generator, which
+// rebuilds structured control flow (nested loops, conditionals and labeled
+// blocks) from the CFG of a function, so that the generated code does not
+// need a label-switch dispatch loop.
+//
+// The structure follows the dominator tree of the CFG.  Every loop header
+// becomes a "while (1)" loop that its back edges continue, every block with
+// more than one forward predecessor is placed right after a labeled block
+// that its predecessors break out of, and every other block is nested in the
+// code of its only predecessor.
+//
+// With a profile, the successors that are rarely taken from their block are
+// cold: they are placed after the code of the block, like merge blocks, and
+// reached by breaking out of a labeled block, so that the hot path stays
+// compact and linear.  The cold successors are also ordered after their hot
+// siblings.
+//
+// This requires a reducible CFG.  Irreducible regions, i.e. cycles with more
+// than one entry, are made reducible first by routing all the edges into
+// their entries through a dispatch node, which selects the entry through the
+// "label" variable.  The rest of the function stays structured.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSRELOOPER_H
+#define JSRELOOPER_H
+
+#include "llvm/Analysis/ProfileInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include <deque>
+#include <vector>
+
+namespace llvm {
+
+class BasicBlock;
+struct JsShape;
+
+/// JsBranch - How the code generator transfers control along one edge of the
+/// CFG.  The phis of Dest are assigned first, then the label variable if the
+/// edge leads to a dispatch node, and then control either breaks out of the
+/// labeled block that precedes the target, continues the loop of the target,
+/// or falls into the nested code of the target.
+struct JsBranch {
+  enum BranchKind { Break, Continue, Nested };
+
+  BranchKind Kind;
+  /// Label - The label of the block or loop for Break and Continue.
+  unsigned Label;
+  /// Target - The code of the target for Nested.
+  const JsShape *Target;
+  /// Dest - The original destination of the edge, whose phis are assigned.
+  BasicBlock *Dest;
+  /// SetLabel - The value to assign to the label variable, or -1.
+  int SetLabel;
+  /// Cold - True if the profile shows that the edge is rarely taken.
+  bool Cold;
+};
+
+/// JsShape - A statement of the structured form of a function.
+struct JsShape {
+  enum ShapeKind {
+    /// Simple - The code of one node, followed by its branches.
+    Simple,
+    /// Block - "Label: { Inner } Next", where Inner breaks to Label in
+    /// order to get to Next.
+    Block,
+    /// Loop - "Label: while (1) { Inner }".
+    Loop
+  };
+
+  ShapeKind Kind;
+  unsigned Label;
+  /// Node - The node of a Simple shape.
+  unsigned Node;
+  const JsShape *Inner;
+  const JsShape *Next;
+  /// Branches - The branches of a Simple shape, one for every successor of
+  /// its node.
+  std::vector<JsBranch> Branches;
+};
+
+/// JsRelooper - The structured form of the control flow of one function.
+///
+/// The nodes of the graph are the basic blocks, numbered in the order they
+/// are given in, followed by the dispatch nodes that were added for the
+/// irreducible regions.  The first block must be the entry block.  The
+/// successors of a block node are the successors of its terminator, except
+/// that the unwind destination of an invoke that cannot throw is left out.
+/// The successors of a dispatch node are the entries of its region, and the
+/// node selects the entry whose number is the value of the label variable.
+class JsRelooper {
+  struct Node {
+    BasicBlock *BB;
+    std::vector<unsigned> Succs;
+    std::vector<BasicBlock*> Dests;
+    std::vector<int> SetLabels;
+    /// Weights - The profiled execution counts of the successors, or
+    /// ProfileInfo::MissingValue.
+    std::vector<double> Weights;
+    /// DispatchValues - The label values that select the successors of a
+    /// dispatch node.
+    std::vector<unsigned> DispatchValues;
+  };
+
+  std::vector<Node> Nodes;
+  unsigned NumDispatchNodes;
+  std::deque<JsShape> Shapes;
+  const JsShape *Root;
+  unsigned NumLabels;
+
+  // State of the structuring: the reverse postorder numbers, the dominator
+  // tree, and the labels of the loops and blocks built so far.
+  std::vector<unsigned> RPONumbers;
+  std::vector<unsigned> IDoms;
+  std::vector<std::vector<unsigned> > DomChildren;
+  std::vector<unsigned> ForwardPreds;
+  std::vector<bool> LoopHeaders;
+  std::vector<bool> Outlined;
+  DenseMap<unsigned, unsigned> LoopLabels, BlockLabels;
+
+public:
+  /// JsRelooper - Structure the given blocks, and lay out the cold ones
+  /// according to the edge profile in PI if it is not null.
+  explicit JsRelooper(const std::vector<BasicBlock*> &Blocks,
+                      ProfileInfo *PI = 0);
+
+  /// getRoot - Return the structured body of the function.
+  const JsShape *getRoot() const { return Root; }
+
+  /// usesDispatch - Return true if the function has irreducible control flow,
+  /// and thus needs the label variable.
+  bool usesDispatch() const { return NumDispatchNodes != 0; }
+
+  /// getBlock - Return the basic block of node N, or null for a dispatch
+  /// node.
+  BasicBlock *getBlock(unsigned N) const { return Nodes[N].BB; }
+
+  /// getDispatchValue - Return the label value that selects successor i of
+  /// the dispatch node N.
+  unsigned getDispatchValue(unsigned N, unsigned i) const {
+    return Nodes[N].DispatchValues[i];
+  }
+
+private:
+  void makeReducible(const std::vector<unsigned> &Region, unsigned Header);
+  void findCycles(const std::vector<unsigned> &Region, unsigned Header,
+                  std::vector<std::vector<unsigned> > &Cycles);
+  void computeDominators();
+  bool dominates(unsigned A, unsigned B) const;
+  bool isColdSuccessor(unsigned N, unsigned i) const;
+  const JsShape *buildTree(unsigned N);
+  const JsShape *buildNodeWithin(unsigned N,
+                                 const std::vector<unsigned> &Merges,
+                                 unsigned NumMerges);
+  JsBranch buildBranch(unsigned From, unsigned i);
+  JsShape *newShape(JsShape::ShapeKind Kind);
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,95 @@
+//===-- JsSourceMap.cpp - Source maps of the JsBackend --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the writer of the source maps of the javascript code
+// generator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsSourceMap.h"
+using namespace llvm;
+
+JsSourceMap::JsSourceMap(const char *FileName, std::string &Error)
+  : Out(FileName, Error), Line(0), Column(0), MappedLine(0),
+    LineHasSegments(false), PrevColumn(0), PrevSource(0), PrevSourceLine(0),
+    PrevSourceColumn(0) {
+  // The keys of the map may come in any order, which lets the mappings be
+  // written before the sources are all known.
+  Out << "{\"version\":3,\"mappings\":\"";
+}
+
+void JsSourceMap::addText(StringRef Text) {
+  for (size_t i = 0, e = Text.size(); i != e; ++i) {
+    if (Text[i] == '\n') {
+      ++Line;
+      Column = 0;
+    } else {
+      ++Column;
+    }
+  }
+}
+
+void JsSourceMap::addMapping(StringRef Source, unsigned SourceLine,
+                             unsigned SourceColumn) {
+  // Each line of the output is a group of segments, separated by ';', whose
+  // columns are relative to the start of the line.
+  for (; MappedLine < Line; ++MappedLine) {
+    Out << ';';
+    LineHasSegments = false;
+    PrevColumn = 0;
+  }
+
+  StringMapEntry<unsigned> &Entry =
+    SourceIndices.GetOrCreateValue(Source, Sources.size());
+  if (Entry.getValue() == Sources.size())
+    Sources.push_back(Entry.getKey());
+  int SourceIndex = Entry.getValue();
+  // The source positions of the format count from 0.
+  int LineIndex = SourceLine ? SourceLine - 1 : 0;
+  int ColumnIndex = SourceColumn ? SourceColumn - 1 : 0;
+
+  if (LineHasSegments)
+    Out << ',';
+  writeVLQ(Column - PrevColumn);
+  writeVLQ(SourceIndex - PrevSource);
+  writeVLQ(LineIndex - PrevSourceLine);
+  writeVLQ(ColumnIndex - PrevSourceColumn);
+  LineHasSegments = true;
+  PrevColumn = Column;
+  PrevSource = SourceIndex;
+  PrevSourceLine = LineIndex;
+  PrevSourceColumn = ColumnIndex;
+}
+
+void JsSourceMap::finish() {
+  Out << "\",\"sources\":[";
+  for (unsigned i = 0, e = Sources.size(); i != e; ++i) {
+    Out << (i ? ",\"" : "\"");
+    Out.write_escaped(Sources[i]);
+    Out << '"';
+  }
+  Out << "],\"names\":[]}\n";
+}
+
+/// writeVLQ - Write the given value as a base64 VLQ: the sign is the lowest
+/// bit of the first digit, and every digit holds five bits of the value,
+/// least significant first, and a sixth bit that is set if more digits
+/// follow.
+void JsSourceMap::writeVLQ(int Value) {
+  static const char Digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  unsigned VLQ = Value < 0 ? ((unsigned)-Value << 1) | 1 : (unsigned)Value << 1;
+  do {
+    unsigned Digit = VLQ & 31;
+    VLQ >>= 5;
+    if (VLQ)
+      Digit |= 32;
+    Out << Digits[Digit];
+  } while (VLQ);
+}
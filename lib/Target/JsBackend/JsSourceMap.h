@@ -0,0 +1,74 @@
+//===-- JsSourceMap.h - Source maps of the JsBackend ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the writer of the source maps of the javascript code
+// generator, in the version 3 format that the javascript engines read.
+//
+// The map is written as the code is: the writer is told about every piece of
+// text that goes to the output, and about the source positions at which the
+// pieces start, so that it knows the line and column of each position in the
+// output without keeping the output.  The mappings are encoded as they come,
+// and only the names of the source files are kept until the end.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSSOURCEMAP_H
+#define JSSOURCEMAP_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DebugLoc.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// JsSourceLocation - The offset in the code of a function at which the code
+/// of an instruction starts, and the debug location of the instruction.
+struct JsSourceLocation {
+  uint64_t Offset;
+  DebugLoc Loc;
+};
+
+class JsSourceMap {
+  raw_fd_ostream Out;
+  StringMap<unsigned> SourceIndices;
+  std::vector<StringRef> Sources;
+
+  // The position in the output of the next text, and the line of the output
+  // that the mappings were last written for.
+  unsigned Line, Column, MappedLine;
+  bool LineHasSegments;
+
+  // The fields of the last segment, from which the next one is encoded.
+  int PrevColumn, PrevSource, PrevSourceLine, PrevSourceColumn;
+
+public:
+  /// JsSourceMap - Start writing the map to the file FileName.  Errors are
+  /// reported in Error, as by raw_fd_ostream.
+  JsSourceMap(const char *FileName, std::string &Error);
+
+  /// addText - Advance past the given text in the output.
+  void addText(StringRef Text);
+
+  /// addMapping - Map the current position in the output to the given line
+  /// and column of the source file Source.  Lines and columns count from 1,
+  /// and a column of 0 stands for the start of the line.
+  void addMapping(StringRef Source, unsigned SourceLine, unsigned SourceColumn);
+
+  /// finish - Write the end of the map, with the names of the source files.
+  void finish();
+
+private:
+  void writeVLQ(int Value);
+};
+
+} // End llvm namespace
+
+#endif
@@ -20,11 +20,23 @@
 namespace llvm {
 
 class formatted_raw_ostream;
+class Function;
+class FunctionPass;
+class FunctionType;
+class ModulePass;
 
 struct JsTargetMachine : public TargetMachine {
+  /// DataLayout - The layout of the javascript heap: 32-bit pointers, and
+  /// every scalar aligned to its size, so that it can be accessed through the
+  /// typed array of its type.  Modules that carry a data layout of their own
+  /// are emitted with that one instead.
+  const TargetData DataLayout;
+
   JsTargetMachine(const Target &T, const std::string &TT,
                    const std::string &FS)
-    : TargetMachine(T) {}
+    : TargetMachine(T),
+      DataLayout("e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-"
+                 "f32:32:32-f64:64:64-n32") {}
 
   virtual bool addPassesToEmitFile(PassManagerBase &PM,
 				   formatted_raw_ostream &Out,
@@ -32,11 +44,48 @@ struct JsTargetMachine : public TargetMachine {
 				   CodeGenOpt::Level OptLevel,
 				   bool DisableVerify);
 
-  virtual const TargetData *getTargetData() const { return 0; }
+  virtual const TargetData *getTargetData() const { return &DataLayout; }
 };
 
 extern Target TheJsBackendTarget;
 
+/// createJsLegalizeI64Pass - Split the i64 operations of a function into
+/// operations on i32 halves, for the javascript code generator.
+FunctionPass *createJsLegalizeI64Pass();
+
+/// createJsLegalizeI64SignaturesPass - Pass the i64 arguments and results of
+/// the functions of a module as i32 halves, for the javascript code
+/// generator.  The functions whose bodies are not read yet are left to
+/// legalizeJsI64Signature.
+ModulePass *createJsLegalizeI64SignaturesPass();
+
+/// legalizeJsI64Signature - Replace F, whose body has just been read from a
+/// module that is read lazily, by a function of its legal type, as the pass
+/// above does for the other functions, and return it.  F is removed from the
+/// module but not deleted.  Return null if the type of F is legal.
+Function *legalizeJsI64Signature(Function *F);
+
+/// getJsLegalI64Type - Return the type that the functions of the given type
+/// have once their i64 arguments and results are passed as halves.
+const FunctionType *getJsLegalI64Type(const FunctionType *FTy);
+
+enum {
+  /// JS_TEMP_RET_PTR - Address of the heap word through which functions
+  /// return the high half of their i64 results.
+  JS_TEMP_RET_PTR = 4
+};
+
+/// createJsProfilingPass - Count the entries of the functions, and keep the
+/// counts and those of the optimal edge profiler in an llvmprof.out file in
+/// the heap, for the javascript code generator.
+ModulePass *createJsProfilingPass();
+
+/// createJsCtorEvalPass - Evaluate the static constructors that can be at
+/// compile time into the initializers of the globals, and remove them from
+/// llvm.global_ctors, for the javascript code generator.  Layout is the data
+/// layout of modules that do not specify one.
+ModulePass *createJsCtorEvalPass(const TargetData *Layout);
+
 } // End llvm namespace
 
 
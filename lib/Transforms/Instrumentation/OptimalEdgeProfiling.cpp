@@ -23,6 +23,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "MaximumSpanningTree.h"
@@ -49,6 +50,24 @@ namespace {
       return "Optimal Edge Profiler";
     }
   };
+
+  /// EdgeOrder - Orders edges by the positions of their blocks in the
+  /// function, the virtual block 0 first, so that the spanning tree breaks
+  /// ties between edges of equal weight the same way on every run.
+  struct EdgeOrder {
+    const DenseMap<const BasicBlock*, unsigned> &Positions;
+    explicit EdgeOrder(const DenseMap<const BasicBlock*, unsigned> &P)
+      : Positions(P) {}
+
+    bool operator()(const ProfileInfo::EdgeWeight &X,
+                    const ProfileInfo::EdgeWeight &Y) const {
+      unsigned XFrom = Positions.lookup(X.first.first);
+      unsigned YFrom = Positions.lookup(Y.first.first);
+      if (XFrom != YFrom) return XFrom < YFrom;
+      return Positions.lookup(X.first.second) <
+             Positions.lookup(Y.first.second);
+    }
+  };
 }
 
 char OptimalEdgeProfiler::ID = 0;
@@ -139,6 +158,12 @@ bool OptimalEdgeProfiler::runOnModule(Module &M) {
     ProfileInfo::EdgeWeights ECs = 
       getAnalysis<ProfileInfo>(*F).getEdgeWeights(F);
     std::vector<ProfileInfo::EdgeWeight> EdgeVector(ECs.begin(), ECs.end());
+    // The edge weights are keyed by pointers, put them in CFG order.
+    DenseMap<const BasicBlock*, unsigned> Positions;
+    unsigned Position = 0;
+    for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+      Positions[BB] = ++Position;
+    std::sort(EdgeVector.begin(), EdgeVector.end(), EdgeOrder(Positions));
     MaximumSpanningTree<BasicBlock> MST (EdgeVector);
     std::stable_sort(MST.begin(),MST.end());
 
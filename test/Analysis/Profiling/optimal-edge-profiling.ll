@@ -0,0 +1,31 @@
+; Test that the optimal edge profiling instrumentation breaks the ties between
+; edges of equal weight by the order of their blocks.
+; RUN: opt < %s -insert-optimal-edge-profiling -S | FileCheck %s
+
+; Of the edges of equal weight, the spanning tree takes the earlier ones: the
+; edges out of entry.  Its edges are not counted (-1), so the counters are on
+; the edges of then and else into join.
+; CHECK: @OptEdgeProfCounters = internal global [6 x i32] [i32 -1, i32 -1, i32 -1, i32 0, i32 0, i32 -1]
+
+define i32 @main(i32 %argc, i8** %argv) nounwind {
+entry:
+  %c = icmp sgt i32 %argc, 1
+  br i1 %c, label %then, label %else
+
+; CHECK: then:
+; CHECK-NEXT: load i32* getelementptr inbounds ([6 x i32]* @OptEdgeProfCounters, i32 0, i32 3)
+then:
+  br label %join
+
+; CHECK: else:
+; CHECK-NEXT: load i32* getelementptr inbounds ([6 x i32]* @OptEdgeProfCounters, i32 0, i32 4)
+else:
+  br label %join
+
+; CHECK: join:
+; CHECK-NOT: OptEdgeProfCounters
+; CHECK: ret i32
+join:
+  %r = phi i32 [ 1, %then ], [ 2, %else ]
+  ret i32 %r
+}
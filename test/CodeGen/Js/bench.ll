@@ -0,0 +1,11 @@
+; RUN: llvm-jsbench -workload=structs -runs=1 | FileCheck %s
+; RUN: llvm-jsbench -workload=structs -runs=1 -js-codegen | FileCheck %s -check-prefix=CODEGEN
+
+; The benchmark generates its own modules, and prints a line of JSON for
+; every phase.  The code generator has no binary form.
+; CHECK: {"workload": "structs", "phase": "generate", "scale": 1, "runs": 1, "seconds": {{[0-9.]+}}, "bytes": 0, "functions": 40, "mb_per_s": 0.000, "functions_per_s": {{[0-9.]+}}, "peak_rss_kb": {{[0-9]+}}}
+; CHECK-NEXT: {"workload": "structs", "phase": "emit", "scale": 1, "runs": 1, "seconds": {{[0-9.]+}}, "bytes": {{[1-9][0-9]*}}, "functions": 40,
+; CHECK-NEXT: {"workload": "structs", "phase": "emit-binary", "scale": 1, "runs": 1,
+; CODEGEN: "phase": "generate"
+; CODEGEN-NEXT: "phase": "emit"
+; CODEGEN-NOT: "phase": "emit-binary"
@@ -0,0 +1,36 @@
+; RUN: llc < %s -march=js -O0 -filetype=obj -o %t
+; RUN: llvm-jsdump %t | FileCheck %s
+
+; CHECK: global @_OC_str : [7 x i8]* = c"hi %d\n"  ; line 0
+@.str = private constant [7 x i8] c"hi %d\0A\00"
+; CHECK: global @pair : { i32, double }* = [7, 2.500000e+00]  ; line 1
+@pair = internal global { i32, double } { i32 7, double 2.5 }
+; CHECK: global @zeros : [4 x i16]* = zeroinitializer  ; line 2
+@zeros = internal global [4 x i16] zeroinitializer
+
+; CHECK: function @main(%vargc) : i32  ; line 3
+define i32 @main(i32 %argc) {
+; CHECK-NEXT: ventry:
+entry:
+; CHECK-NEXT:   %vneg = icmp i32 %vargc, i32 -5  ; line 4
+  %neg = icmp slt i32 %argc, -5
+; CHECK-NEXT:   br : void i1 %vneg, label %vexit, label %vbody  ; line 5
+  br i1 %neg, label %body, label %exit
+
+; CHECK-NEXT: vbody:
+body:
+; CHECK-NEXT:   %v0 = call i8* @_OC_str, i32 %vargc, i32 (i8*, ...)* @printf  ; line 6
+  %0 = call i32 (i8*, ...)* @printf(i8* getelementptr ([7 x i8]* @.str, i32 0, i32 0), i32 %argc)
+; Without a data layout in the module, doubles are 8 byte aligned.
+; CHECK-NEXT:   %v1 = store double 1.000000e+00, double* offset ({ i32, double }* @pair, i32 8)  ; line 7
+  store double 1.0, double* getelementptr ({ i32, double }* @pair, i32 0, i32 1)
+; CHECK-NEXT:   br : void label %vexit  ; line 8
+  br label %exit
+
+; CHECK-NEXT: vexit:
+exit:
+; CHECK-NEXT:   ret : void i32 0  ; line 9
+  ret i32 0
+}
+
+declare i32 @printf(i8*, ...)
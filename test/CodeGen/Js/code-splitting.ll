@@ -0,0 +1,83 @@
+; RUN: llc < %s -march=js -js-codegen -js-split=%t.chunk | FileCheck %s
+; RUN: FileCheck -check-prefix=CHUNK %s < %t.chunk1.js
+; RUN: llc < %s -march=js -js-codegen -js-minify-names -js-split=%t.serial > %t1
+; RUN: llc < %s -march=js -js-codegen -js-minify-names -js-split=%t.threads -js-threads=2 > %t2
+; RUN: diff %t1 %t2
+; RUN: diff %t.serial1.js %t.threads1.js
+
+; Without a profile, main and the functions that it always calls stay in the
+; module.  The other functions are replaced by stubs that load their chunk.
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+@handler = global i32 (i32)* @cold_b
+
+; CHECK: function loadChunk(chunk) { chunk = chunk|0; if (!loadedChunks[chunk]) { loadedChunks[chunk] = 1; eval(env.loadChunk(chunk)); } }
+
+; CHECK: function _init(vx) {
+; CHECK-NEXT: vx = vx|0;
+define i32 @init(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+; The callee of a cold function joins the chunk of its caller.
+
+; CHECK: function _cold_a(vx) {
+; CHECK-NEXT: loadChunk(1);
+; CHECK-NEXT: return _cold_a(vx);
+; CHECK-NEXT: }
+; CHECK: function _cold_helper(vx) {
+; CHECK-NEXT: loadChunk(1);
+; CHECK-NEXT: return _cold_helper(vx);
+; CHECK-NEXT: }
+; CHECK: function _cold_b(vx) {
+; CHECK-NEXT: loadChunk(1);
+; CHECK-NEXT: return _cold_b(vx);
+; CHECK-NEXT: }
+
+; CHUNK: _cold_a = function _cold_a(vx) {
+; CHUNK: vr = _cold_helper(vx)|0;
+; CHUNK: };
+; CHUNK-NEXT: _cold_helper = function _cold_helper(vx) {
+; CHUNK: };
+; CHUNK-NEXT: _cold_b = function _cold_b(vx) {
+; CHUNK: };
+; CHUNK-NEXT: FUNCTION_TABLE_ii[1] = _cold_b;
+define internal i32 @cold_a(i32 %x) {
+  %r = call i32 @cold_helper(i32 %x)
+  %s = mul i32 %r, 3
+  ret i32 %s
+}
+
+define internal i32 @cold_helper(i32 %x) {
+  %r = add i32 %x, 100
+  ret i32 %r
+}
+
+define i32 @cold_b(i32 %x) {
+  %r = sub i32 %x, 5
+  ret i32 %r
+}
+
+; CHECK: function _main(vargc) {
+; CHECK-NEXT: vargc = vargc|0;
+; CHECK: va = _init(vargc)|0;
+; CHECK: vb = _cold_a(va)|0;
+; CHECK: var FUNCTION_TABLE_ii = [abort, _cold_b];
+define i32 @main(i32 %argc) {
+entry:
+  %a = call i32 @init(i32 %argc)
+  %c = icmp sgt i32 %a, 1
+  br i1 %c, label %slow, label %done
+
+slow:
+  %b = call i32 @cold_a(i32 %a)
+  %f = load i32 (i32)** @handler
+  %d = call i32 %f(i32 %b)
+  br label %done
+
+done:
+  %r = phi i32 [ %a, %entry ], [ %d, %slow ]
+  ret i32 %r
+}
@@ -0,0 +1,101 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+; RUN: llc < %s -march=js -js-codegen > %t1
+; RUN: llc < %s -march=js -js-codegen -js-threads=2 > %t2
+; RUN: diff %t1 %t2
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; CHECK: var JsModule = function(global, env, buffer) {
+; CHECK: var HEAP32 = new global.Int32Array(buffer);
+; CHECK: var STACKTOP = 32;
+
+@.str = private constant [4 x i8] c"%d\0A\00"
+@table = internal global [3 x i16] [i16 1, i16 -2, i16 300]
+@fp = internal global i32 (i32)* @square
+
+; CHECK: function _square(vx) {
+; CHECK-NEXT:   vx = vx|0;
+; CHECK-NEXT:   var vr = 0;
+; CHECK-NEXT:   vr = Math_imul(vx, vx)|0;
+; CHECK-NEXT:   return vr|0;
+define internal i32 @square(i32 %x) {
+  %r = mul i32 %x, %x
+  ret i32 %r
+}
+
+; CHECK: function _narrow(va, vb) {
+define internal i8 @narrow(i8 %a, i8 %b) {
+; CHECK:   vs = (va + vb)<<24>>24;
+  %s = add i8 %a, %b
+; CHECK:   vd = ((vs & 255) / (vb & 255))<<24>>24;
+  %d = udiv i8 %s, %b
+; CHECK:   vc = ((vd & 255) < (vs & 255))|0;
+  %c = icmp ult i8 %d, %s
+; CHECK:   vm = vc ? vd : vs;
+  %m = select i1 %c, i8 %d, i8 %s
+  ret i8 %m
+}
+
+; CHECK: function _sum(vn) {
+; CHECK: var vi = 0, vt = 0, vp = 0, vv = 0, vw = 0, vc = 0, vi$phi = 0, vt$phi = 0;
+define internal i32 @sum(i32 %n) {
+entry:
+; CHECK-NEXT: vi = 0;
+; CHECK-NEXT: vt = 0;
+; CHECK-NEXT: L0: while (1) {
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %t = phi i32 [ 0, %entry ], [ %t1, %loop ]
+; CHECK-NEXT: vp = (20 + (vi << 1))|0;
+  %p = getelementptr [3 x i16]* @table, i32 0, i32 %i
+; CHECK-NEXT: vv = HEAP16[vp>>1]|0;
+  %v = load i16* %p
+  %w = sext i16 %v to i32
+  %t1 = add i32 %t, %w
+  %i1 = add i32 %i, 1
+  %c = icmp slt i32 %i1, %n
+; CHECK: if (vc) {
+; CHECK-NEXT: continue L0;
+; CHECK-NEXT: } else {
+  br i1 %c, label %loop, label %exit
+exit:
+; CHECK: return vt|0;
+  ret i32 %t1
+}
+
+; CHECK: function _main() {
+define i32 @main() {
+; The static allocas are in a frame that is allocated on entry.  The store is
+; volatile, or the alloca would be promoted away.
+; CHECK: sp = STACKTOP;
+; CHECK-NEXT: STACKTOP = (STACKTOP + 8)|0;
+; CHECK-NEXT: vd = sp;
+  %d = alloca double
+; Doubles are only 4 byte aligned in this data layout.
+; CHECK-NEXT: HEAPF64[tempDoublePtr>>3] = 2.5; HEAP32[vd>>2] = HEAP32[tempDoublePtr>>2]; HEAP32[vd + 4 >>2] = HEAP32[tempDoublePtr + 4 >>2];
+  volatile store double 2.5, double* %d
+; CHECK-NEXT: vf = HEAP32[28>>2]|0;
+  %f = load i32 (i32)** @fp
+; CHECK-NEXT: vr = (FUNCTION_TABLE_ii[vf & 1](7))|0;
+  %r = call i32 %f(i32 7)
+; CHECK-NEXT: vs = _sum(3)|0;
+  %s = call i32 @sum(i32 3)
+; CHECK-NEXT: argbuf = STACKTOP;
+; CHECK-NEXT: STACKTOP = (STACKTOP + 8)|0;
+; CHECK-NEXT: HEAP32[argbuf>>2] = vs;
+; CHECK-NEXT: v0 = _printf(16, argbuf)|0;
+; CHECK-NEXT: STACKTOP = argbuf;
+  %1 = call i32 (i8*, ...)* @printf(i8* getelementptr ([4 x i8]* @.str, i32 0, i32 0), i32 %s)
+; CHECK-NEXT: STACKTOP = sp;
+; CHECK-NEXT: return vr|0;
+  ret i32 %r
+}
+
+declare i32 @printf(i8*, ...)
+
+; CHECK: var _printf = env._printf;
+; CHECK-NEXT: HEAPU8.set([37,100,10,0,1,0,254,255,44,1,0,0,1], 16);
+; CHECK-NEXT: var FUNCTION_TABLE_ii = [abort, _square];
+; CHECK-NEXT: return { _main: _main };
+; CHECK-NEXT: };
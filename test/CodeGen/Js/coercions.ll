@@ -0,0 +1,54 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+
+; Every operation carries the coercion of its type, except where the
+; operators of the expression already give the value that form.
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; CHECK: function _ops(va, vb, vc) {
+; CHECK: vq = (va / vb)|0;
+; CHECK: vs = vq << vb;
+; CHECK: vu = (vs >>> 3)|0;
+; CHECK: vm = vc ? vu : va;
+; CHECK: vn = (0 - vc)|0;
+; CHECK: vr = (vm + vn)|0;
+; CHECK: return vr|0;
+define i32 @ops(i32 %a, i32 %b, i1 %c) {
+  %q = sdiv i32 %a, %b
+  %s = shl i32 %q, %b
+  %u = lshr i32 %s, 3
+  %m = select i1 %c, i32 %u, i32 %a
+  %n = sext i1 %c to i32
+  %r = add i32 %m, %n
+  ret i32 %r
+}
+
+; CHECK: function _narrow(va, vb) {
+; CHECK: vq = ((va & 255) / (vb & 255))<<24>>24;
+; CHECK: vs = (vq << 1)<<24>>24;
+; CHECK: vd = (vs / va)<<24>>24;
+; CHECK: vb1 = vd&1;
+define i1 @narrow(i8 %a, i8 %b) {
+  %q = udiv i8 %a, %b
+  %s = shl i8 %q, 1
+  %d = sdiv i8 %s, %a
+  %b1 = trunc i8 %d to i1
+  ret i1 %b1
+}
+
+; CHECK: function _dbl(vx, vy, vc) {
+; CHECK: vs = +(vx + vy);
+; CHECK: vm = vc ? vs : vx;
+; CHECK: return +vm;
+define double @dbl(double %x, double %y, i1 %c) {
+  %s = fadd double %x, %y
+  %m = select i1 %c, double %s, double %x
+  ret double %m
+}
+
+; CHECK: function _flt(vx, vy) {
+; CHECK: vs = Math_fround(vx * vy);
+define float @flt(float %x, float %y) {
+  %s = fmul float %x, %y
+  ret float %s
+}
@@ -0,0 +1,81 @@
+; RUN: llc < %s -march=js -js-codegen -O2 | FileCheck %s
+
+; The static constructors that can be run at compile time, loops, aggregate
+; stores and memory intrinsics included, are folded into the static data, up
+; to the first one that calls the environment.
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+%struct.point = type { i32, i16, double }
+
+@squares = global [8 x i32] zeroinitializer
+@origin = global %struct.point zeroinitializer
+@copy = global [4 x i8] zeroinitializer
+@.src = private constant [4 x i8] c"abc\00"
+@filled = global [3 x i16] zeroinitializer
+@ends = global [4 x i32] zeroinitializer
+@counter = global i32 0
+@llvm.global_ctors = appending global [3 x { i32, void ()* }] [{ i32, void ()* } { i32 65535, void ()* @init }, { i32, void ()* } { i32 65535, void ()* @runtime }, { i32, void ()* } { i32 65535, void ()* @late }]
+
+declare void @llvm.memcpy.p0i8.p0i8.i32(i8*, i8*, i32, i32, i1)
+declare void @llvm.memset.p0i8.i32(i8*, i8, i32, i32, i1)
+declare i32 @getenv_count()
+
+; CHECK-NOT: function _init(
+define internal void @init() {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %sq = mul i32 %i, %i
+  %p = getelementptr [8 x i32]* @squares, i32 0, i32 %i
+  store i32 %sq, i32* %p
+  %next = add i32 %i, 1
+  %done = icmp eq i32 %next, 8
+  br i1 %done, label %rest, label %loop
+rest:
+  %tmp = alloca %struct.point
+  store %struct.point { i32 3, i16 -4, double 2.5 }, %struct.point* %tmp
+  %v = load %struct.point* %tmp
+  store %struct.point %v, %struct.point* @origin
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* getelementptr ([4 x i8]* @copy, i32 0, i32 0), i8* getelementptr ([4 x i8]* @.src, i32 0, i32 0), i32 4, i32 1, i1 false)
+  call void @llvm.memset.p0i8.i32(i8* bitcast ([3 x i16]* @filled to i8*), i8 1, i32 6, i32 2, i1 false)
+  %b = bitcast [4 x i32]* @ends to i8*
+  %third = getelementptr i8* %b, i32 8
+  %tp = bitcast i8* %third to i32*
+  store i32 77, i32* %tp
+  br label %ploop
+ploop:
+  %q = phi i32* [ getelementptr ([4 x i32]* @ends, i32 0, i32 0), %rest ], [ %qn, %ploop ]
+  %old = load i32* %q
+  %new = add i32 %old, 1
+  store i32 %new, i32* %q
+  %qn = getelementptr i32* %q, i32 1
+  %pe = icmp eq i32* %qn, getelementptr ([4 x i32]* @ends, i32 1, i32 0)
+  br i1 %pe, label %exit, label %ploop
+exit:
+  ret void
+}
+
+; CHECK: function _runtime() {
+define internal void @runtime() {
+  %n = call i32 @getenv_count()
+  store i32 %n, i32* @counter
+  ret void
+}
+
+; CHECK: function _late() {
+define internal void @late() {
+  store i32 5, i32* @counter
+  ret void
+}
+
+define i32 @main() {
+  %a = load i32* getelementptr ([8 x i32]* @squares, i32 0, i32 7)
+  ret i32 %a
+}
+
+; The squares, the point, the copied and the filled bytes, the incremented
+; ends, and the table of the remaining constructors.
+; CHECK: HEAPU8.set([0,0,0,0,1,0,0,0,4,0,0,0,9,0,0,0,16,0,0,0,25,0,0,0,36,0,0,0,49,0,0,0,3,0,0,0,252,255,0,0,0,0,0,0,0,0,4,64,97,98,99,0,97,98,99,0,1,1,1,1,1,1,0,0,1,0,0,0,1,0,0,0,78,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,1,0,0,0,255,255,0,0,2], 16);
+; CHECK: var FUNCTION_TABLE_v = [abort, _runtime, _late, abort];
@@ -0,0 +1,43 @@
+; RUN: echo api > %t.exports
+; RUN: llc < %s -march=js -js-codegen -js-exports=%t.exports | FileCheck %s
+
+; Only main and the listed symbols stay external.  The code and data that
+; they do not use are removed, and the constant arguments of the internal
+; functions are propagated into them.
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+@table = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+@counter = global i32 0
+
+; CHECK-NOT: _lib_unused
+define i32 @lib_unused(i32 %x) {
+  %v = load i32* @counter
+  %r = add i32 %v, %x
+  ret i32 %r
+}
+
+; CHECK: function _lib_scale(vx, vk) {
+; CHECK: vr = Math_imul(vx, 3)|0;
+define i32 @lib_scale(i32 %x, i32 %k) {
+  %r = mul i32 %x, %k
+  ret i32 %r
+}
+
+; CHECK: function _api(vi) {
+define i32 @api(i32 %i) {
+  %p = getelementptr [4 x i32]* @table, i32 0, i32 %i
+  %v = load i32* %p
+  %r = call i32 @lib_scale(i32 %v, i32 3)
+  ret i32 %r
+}
+
+; CHECK: function _main() {
+define i32 @main() {
+  %r = call i32 @api(i32 1)
+  ret i32 %r
+}
+
+; Only the table is left in the static data.
+; CHECK: HEAPU8.set([1,0,0,0,2,0,0,0,3,0,0,0,4], 16);
+; CHECK: return { _api: _api, _main: _main };
@@ -0,0 +1,49 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+@unary = global [3 x i32 (i32)*] [i32 (i32)* @inc, i32 (i32)* @dec, i32 (i32)* @neg]
+@scale = global double (double, i32)* @twice
+
+define i32 @inc(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @dec(i32 %x) {
+  %r = sub i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @neg(i32 %x) {
+  %r = sub i32 0, %x
+  ret i32 %r
+}
+
+define double @twice(double %x, i32 %n) {
+  %r = fmul double %x, 2.0
+  ret double %r
+}
+
+; Indirect calls index the table of their signature, masked to its size.
+; CHECK: function _call(vi, vx, vcb) {
+define double @call(i32 %i, double %x, void (float)* %cb) {
+  %p = getelementptr [3 x i32 (i32)*]* @unary, i32 0, i32 %i
+  %f = load i32 (i32)** %p
+; CHECK: vy = (FUNCTION_TABLE_ii[vf & 3](7))|0;
+  %y = call i32 %f(i32 7)
+  %g = load double (double, i32)** @scale
+; CHECK: vz = +(FUNCTION_TABLE_ddi[vg & 1](vx, vy));
+  %z = call double %g(double %x, i32 %y)
+; No function has this signature, so its table only holds the null pointer.
+; CHECK: FUNCTION_TABLE_vf[vcb & 0](Math_fround(1.0));
+  call void %cb(float 1.0)
+  ret double %z
+}
+
+; Pointers to functions are their indices in the table of their signature.
+; CHECK: HEAPU8.set([1,0,0,0,2,0,0,0,3,0,0,0,1], 16);
+; The tables are padded to powers of two.
+; CHECK: var FUNCTION_TABLE_ddi = [abort, _twice];
+; CHECK-NEXT: var FUNCTION_TABLE_ii = [abort, _inc, _dec, _neg];
+; CHECK-NEXT: var FUNCTION_TABLE_vf = [abort];
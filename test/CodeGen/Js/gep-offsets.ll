@@ -0,0 +1,29 @@
+; RUN: llc < %s -march=js -O0 | FileCheck %s
+; RUN: llc < %s -march=js -O0 -js-codegen | FileCheck %s -check-prefix=CODEGEN
+
+; Without a data layout in the module, the layout of the javascript target
+; is used: i64 and double are 8 byte aligned.
+
+%struct.rec = type { i32, double, [4 x i16] }
+
+; Constant getelementptrs in initializers become byte offsets.
+; CHECK: { "ident": "last", "intertype": "globalVariable", "lineNum": 0, "type": "i16**", "value": { "text": { "intertype": "offset", "operands": [{ "value": "rec", "type": "{ i32, double, [4 x i16] }*" }, { "value": 22, "type": "i32" }]} }}
+@last = internal global i16* getelementptr (%struct.rec* @rec, i32 0, i32 2, i32 3)
+@rec = internal global %struct.rec { i32 1, double 2.0, [4 x i16] [i16 3, i16 4, i16 5, i16 6] }
+
+; CODEGEN: var STACKTOP = 64;
+
+define double @field(%struct.rec* %p, i32 %i) {
+; Struct field accesses with constant indices become byte offsets.
+; CHECK: { "ident": "vd", "intertype": "offset", "lineNum": 2, "operands": [{ "value": "vp", "type": "{ i32, double, [4 x i16] }*" }, { "value": 32, "type": "i32" }]},
+; CODEGEN: vd = (vp + 32)|0;
+  %d = getelementptr %struct.rec* %p, i32 1, i32 1
+; Variable indices are left to the consumer.
+; CHECK: { "ident": "ve", "intertype": "getelementptr", "lineNum": 3,
+; CODEGEN: ve = (vp + Math_imul(vi, 24) + 16)|0;
+  %e = getelementptr %struct.rec* %p, i32 %i, i32 2, i32 0
+  %v = load double* %d
+  ret double %v
+}
+
+; CODEGEN: HEAPU8.set([54,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,64,3,0,4,0,5,0,6], 16);
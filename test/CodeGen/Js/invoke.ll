@@ -0,0 +1,101 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+; RUN: llc < %s -march=js | FileCheck -check-prefix=JSON %s
+
+; The intertype has no invokes or unwinds: LowerInvoke turns them into calls
+; and unreachables.
+; JSON: "ident": "catch_int"
+; JSON-NOT: "intertype": "invoke"
+; JSON-NOT: "intertype": "unwind"
+
+; An invoke that may throw runs its call in a try block, and branches to the
+; landing pad when the runtime threw the pointer to an exception.
+
+@_ZTIi = external constant i8*
+
+declare void @may_throw(i32)
+declare void @cleanup() nounwind
+declare i8* @llvm.eh.exception() nounwind readonly
+declare i32 @llvm.eh.selector(i8*, i8*, ...) nounwind
+declare i32 @llvm.eh.typeid.for(i8*) nounwind
+declare i32 @__gxx_personality_v0(...)
+declare void @_Unwind_Resume_or_Rethrow(i8*)
+
+; CHECK: function _catch_int(vx) {
+; CHECK: exn = 0, ehsp = 0;
+; CHECK: exn = 0;
+; CHECK-NEXT: ehsp = STACKTOP;
+; CHECK-NEXT: try {
+; CHECK-NEXT: _may_throw(vx);
+; CHECK-NEXT: } catch (e) {
+; CHECK-NEXT: if (typeof e != "number") throw e;
+; CHECK-NEXT: exn = e|0;
+; CHECK-NEXT: STACKTOP = ehsp;
+; CHECK-NEXT: }
+; CHECK-NEXT: if (exn) {
+; CHECK: vexn = exn;
+; CHECK-NEXT: vsel = eh_selector(vexn, __ZTIi)|0;
+; CHECK-NEXT: vid = __ZTIi;
+; CHECK: _Unwind_Resume_or_Rethrow(vexn);
+define i32 @catch_int(i32 %x) {
+entry:
+  invoke void @may_throw(i32 %x)
+          to label %cont unwind label %lpad
+
+cont:
+  ret i32 0
+
+lpad:
+  %exn = call i8* @llvm.eh.exception()
+  %sel = call i32 (i8*, i8*, ...)* @llvm.eh.selector(i8* %exn, i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*), i8* bitcast (i8** @_ZTIi to i8*))
+  %id = call i32 @llvm.eh.typeid.for(i8* bitcast (i8** @_ZTIi to i8*))
+  %caught = icmp eq i32 %sel, %id
+  br i1 %caught, label %handler, label %resume
+
+handler:
+  ret i32 1
+
+resume:
+  call void @_Unwind_Resume_or_Rethrow(i8* %exn)
+  unreachable
+}
+
+; An invoke of a call that cannot throw is a plain call.
+
+; CHECK: function _nothrow() {
+; CHECK-NOT: try
+; CHECK: _cleanup();
+; CHECK-NOT: try
+; CHECK: }
+define void @nothrow() {
+entry:
+  invoke void @cleanup()
+          to label %cont unwind label %lpad
+
+cont:
+  ret void
+
+lpad:
+  unreachable
+}
+
+; Unwind rethrows the exception that was caught last, and aborts if there
+; is none.
+
+; CHECK: function _rethrow(vx) {
+; CHECK: exn = e|0;
+; CHECK: if (!exn) abort();
+; CHECK-NEXT: throw exn;
+define void @rethrow(i32 %x) {
+entry:
+  invoke void @may_throw(i32 %x)
+          to label %cont unwind label %lpad
+
+cont:
+  ret void
+
+lpad:
+  call void @cleanup()
+  unwind
+}
+
+; CHECK: var eh_selector = env.eh_selector;
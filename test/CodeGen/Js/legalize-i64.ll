@@ -0,0 +1,97 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+; RUN: llc < %s -march=js -js-codegen -js-legalize-i64=false | FileCheck -check-prefix=DOUBLE %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; The i64 operations are computed exactly on the halves, from the loads to the
+; stores.
+; CHECK: function _mix(va, vb, vo) {
+define void @mix(i64* %a, i64* %b, i64* %o) {
+; CHECK: vx_2e_lo = HEAP32[v0>>2]|0;
+; CHECK: vx_2e_hi = HEAP32[v1>>2]|0;
+  %x = load i64* %a, align 4
+  %y = load i64* %b, align 4
+; CHECK: vs_2e_lo = (vx_2e_lo + vy_2e_lo)|0;
+; CHECK: [[CARRY:v[0-9]+]] = ((vs_2e_lo>>>0) < (vx_2e_lo>>>0))|0;
+; CHECK: vs_2e_hi = ({{v[0-9]+}} + {{v[0-9]+}})|0;
+  %s = add i64 %x, %y
+; Only the high half of the product is used.
+; CHECK-NOT: vm_2e_lo =
+; CHECK: Math_imul({{v[0-9]+}}, 435)|0;
+; CHECK: vm_2e_hi = ({{v[0-9]+}} + {{v[0-9]+}})|0;
+  %m = mul i64 %s, 1099511628211
+; CHECK: vh_2e_hi = vm_2e_hi >> 31;
+  %h = ashr i64 %m, 32
+; CHECK: HEAP32[v{{[0-9]+}}>>2] = vm_2e_hi;
+; CHECK: HEAP32[v{{[0-9]+}}>>2] = vh_2e_hi;
+  store i64 %h, i64* %o, align 4
+  ret void
+; CHECK-NOT: i64_
+; CHECK: }
+}
+
+; The high halves of extended values are known, and divisions of values that
+; fit in i32 are i32 divisions.
+; CHECK: function _widen(va, vb) {
+define i32 @widen(i32 %a, i32 %b) {
+  %az = zext i32 %a to i64
+  %bz = zext i32 %b to i64
+; CHECK: vq_2e_lo = ((va>>>0) / (vb>>>0))|0;
+  %q = udiv i64 %az, %bz
+  %p = mul i64 %q, %bz
+  %t = trunc i64 %p to i32
+  ret i32 %t
+; CHECK-NOT: i64_
+; CHECK: }
+}
+
+; Comparisons decide on the high halves unless they are equal.
+; CHECK: function _less(va, vb) {
+define i32 @less(i64* %a, i64* %b) {
+  %x = load i64* %a, align 4
+  %y = load i64* %b, align 4
+; CHECK: [[LO:v[0-9]+]] = ((vx_2e_lo>>>0) < (vy_2e_lo>>>0))|0;
+; CHECK: [[HI:v[0-9]+]] = (vx_2e_hi < vy_2e_hi)|0;
+; CHECK: [[EQ:v[0-9]+]] = (vx_2e_hi == vy_2e_hi)|0;
+; CHECK: vc = [[EQ]] ? [[LO]] : [[HI]];
+  %c = icmp slt i64 %x, %y
+  %r = zext i1 %c to i32
+  ret i32 %r
+}
+
+; Arguments are passed as their halves, and results as their low half, with
+; the high half stored to the heap word at address 4.
+; CHECK: function _pass(va_2e_lo, va_2e_hi) {
+define i64 @pass(i64 %a) {
+; CHECK: vr_2e_lo = va_2e_lo ^ 255;
+  %r = xor i64 %a, 255
+; CHECK: HEAP32[4>>2] = va_2e_hi;
+; CHECK: return vr_2e_lo|0;
+  ret i64 %r
+; CHECK-NOT: i64_
+; CHECK: }
+}
+
+; Calls read the high half of the result right after the call, and the
+; divisions that do not fit in i32 call the runtime on the halves.
+; CHECK: function _call(va_2e_lo, va_2e_hi) {
+define i64 @call(i64 %a) {
+; CHECK: vr_2e_lo = _pass(va_2e_lo, va_2e_hi)|0;
+; CHECK: vr_2e_hi = HEAP32[4>>2]|0;
+  %r = call i64 @pass(i64 %a)
+; CHECK: vq_2e_lo = i64_divmod(vr_2e_lo, vr_2e_hi, 1000, 0, 0, 0)|0;
+; CHECK: vq_2e_hi = HEAP32[4>>2]|0;
+  %q = udiv i64 %r, 1000
+; CHECK: vs_2e_lo = i64_divmod(va_2e_lo, va_2e_hi, vq_2e_lo, vq_2e_hi, 1, 1)|0;
+  %s = srem i64 %a, %q
+  ret i64 %s
+; CHECK-NOT: i64_
+; CHECK: }
+}
+
+; Without the legalization, i64 values are approximated by doubles.
+; DOUBLE: function _mix(va, vb, vo) {
+; DOUBLE: vs = +(vx + vy);
+; DOUBLE: vm = +(vs * 1099511628211);
+; DOUBLE: function _pass(va) {
+; DOUBLE: return +vr;
@@ -0,0 +1,47 @@
+; RUN: llc < %s -march=js -O0 -js-mem-init | FileCheck %s
+; RUN: llc < %s -march=js -O0 -js-mem-init -js-mem-init-file=%t.mem | FileCheck -check-prefix=FILE %s
+; RUN: od -An -tu1 %t.mem | FileCheck -check-prefix=BYTES %s
+; RUN: llc < %s -march=js -js-codegen -js-mem-init | FileCheck -check-prefix=CODEGEN %s
+; RUN: llc < %s -march=js -js-codegen -js-mem-init -js-mem-init-file=%t2.mem | FileCheck -check-prefix=LOADED %s
+; RUN: od -An -tu1 %t2.mem | FileCheck -check-prefix=IMAGE %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; CHECK: [{ "intertype": "memoryInitializer", "base": 16, "size": 448, "data": "aGkAAAEA/v8sAQAAAAAAAAcAAAARAAAAAAAAAAAAAAAAAPg/" },
+; FILE: [{ "intertype": "memoryInitializer", "base": 16, "size": 448, "file": "{{.*}}" },
+; BYTES: 104 105 0 0 1 0 254 255 44 1 0 0 0 0 0 0
+; BYTES-NEXT: 7 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0
+; BYTES-NEXT: 0 0 248 63
+
+; CHECK-NEXT: { "ident": "_OC_str", "intertype": "globalVariable", "lineNum": 0, "type": "[3 x i8]*", "address": 16 },
+@.str = private constant [3 x i8] c"hi\00"
+; CHECK-NEXT: { "ident": "table", "intertype": "globalVariable", "lineNum": 1, "type": "[3 x i16]*", "address": 20 },
+@table = internal global [3 x i16] [i16 1, i16 -2, i16 300]
+; Pointers to global variables in the image are resolved, the others are
+; relocated.
+; CHECK-NEXT: { "ident": "s", "intertype": "globalVariable", "lineNum": 2, "type": "{ i32, i8*, void ()*, double }*", "address": 32 },
+@s = internal global { i32, i8*, void ()*, double } { i32 7, i8* getelementptr ([3 x i8]* @.str, i32 0, i32 1), void ()* @f, double 1.5 }
+@ext = external global i32
+; CHECK-NEXT: { "ident": "p", "intertype": "globalVariable", "lineNum": 3, "type": "i32**", "address": 52 },
+@p = internal global i32* @ext
+; CHECK-NEXT: { "ident": "big", "intertype": "globalVariable", "lineNum": 4, "type": "[100 x i32]*", "address": 64 },
+@big = internal global [100 x i32] zeroinitializer
+@pub = global i32 5
+; CHECK-NEXT: { "intertype": "relocations", "relocations": [{ "address": 40, "target": "f", "offset": 0 }, { "address": 52, "target": "ext", "offset": 0 }]},
+
+; CHECK-NEXT: { "ident": "f", "intertype": "function", "lineNum": 5
+define void @f() {
+  ret void
+}
+
+; The static data of the code generator is decoded from base64, or loaded
+; through the environment.
+; CODEGEN: function base64Decode(s, p) {
+; CODEGEN: base64Decode("aGkAAAEA/v8sAQAAAAAAAAcAAAARAAAAAQAAAAAAAAAAAPg/{{A*}}U=", 16);
+; CODEGEN-NEXT: HEAP32[52 >> 2] = _ext;
+; LOADED-NOT: base64Decode
+; LOADED: HEAPU8.set(new global.Uint8Array(env.loadMemoryImage("{{.*}}")), 16);
+
+; The code generator stores the table index of the function pointer.
+; IMAGE: 104 105 0 0 1 0 254 255 44 1 0 0 0 0 0 0
+; IMAGE-NEXT: 7 0 0 0 17 0 0 0 1 0 0 0 0 0 0 0
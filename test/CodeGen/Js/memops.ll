@@ -0,0 +1,45 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+declare void @llvm.memcpy.p0i8.p0i8.i32(i8*, i8*, i32, i32, i1)
+declare void @llvm.memmove.p0i8.p0i8.i32(i8*, i8*, i32, i32, i1)
+declare void @llvm.memset.p0i8.i32(i8*, i8, i32, i32, i1)
+
+; CHECK: function _copy(vd, vs, vn, vv) {
+define void @copy(i8* %d, i8* %s, i32 %n, i8 %v) {
+; Small copies are unrolled into the widest units that the alignment allows.
+; CHECK: HEAP32[vd>>2] = HEAP32[vs>>2];
+; CHECK-NEXT: HEAP32[vd + 4 >>2] = HEAP32[vs + 4 >>2];
+; CHECK-NEXT: HEAP32[vd + 8 >>2] = HEAP32[vs + 8 >>2];
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %d, i8* %s, i32 12, i32 4, i1 false)
+; CHECK-NEXT: HEAP16[vd>>1] = HEAP16[vs>>1];
+; CHECK-NEXT: HEAP16[vd + 2 >>1] = HEAP16[vs + 2 >>1];
+; CHECK-NEXT: HEAP16[vd + 4 >>1] = HEAP16[vs + 4 >>1];
+; CHECK-NEXT: HEAP8[vd + 6 >>0] = HEAP8[vs + 6 >>0];
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %d, i8* %s, i32 7, i32 2, i1 false)
+; CHECK-NEXT: HEAPU8.set(HEAPU8.subarray(vs, (vs + vn)|0), vd);
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %d, i8* %s, i32 %n, i32 1, i1 false)
+; CHECK-NEXT: HEAP32.set(HEAP32.subarray(vs>>2, ((vs + 400)|0)>>2), vd>>2);
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %d, i8* %s, i32 400, i32 4, i1 false)
+; Memmoves are never unrolled, set copies overlapping ranges correctly.
+; CHECK-NEXT: HEAP32.set(HEAP32.subarray(vs>>2, ((vs + 8)|0)>>2), vd>>2);
+  call void @llvm.memmove.p0i8.p0i8.i32(i8* %d, i8* %s, i32 8, i32 4, i1 false)
+; CHECK-NEXT: HEAP32[vd>>2] = 16843009;
+; CHECK-NEXT: HEAP16[vd + 4 >>1] = 257;
+  call void @llvm.memset.p0i8.i32(i8* %d, i8 1, i32 6, i32 4, i1 false)
+; CHECK-NEXT: HEAPU8.fill(vv, vd, (vd + 6)|0);
+  call void @llvm.memset.p0i8.i32(i8* %d, i8 %v, i32 6, i32 4, i1 false)
+; Words of a variable value hold its low byte in each of their bytes.
+; CHECK-NEXT: HEAP32.fill(Math_imul(vv & 255, 16843009), vd>>2, ((vd + 8)|0)>>2);
+  call void @llvm.memset.p0i8.i32(i8* %d, i8 %v, i32 8, i32 4, i1 false)
+; CHECK-NEXT: HEAP32.fill((-1), vd>>2, ((vd + 256)|0)>>2);
+  call void @llvm.memset.p0i8.i32(i8* %d, i8 -1, i32 256, i32 8, i1 false)
+; CHECK-NEXT: HEAPU8.fill(0, vd, (vd + vn)|0);
+  call void @llvm.memset.p0i8.i32(i8* %d, i8 0, i32 %n, i32 8, i1 false)
+  ret void
+}
+
+; The intrinsics are not imported.
+; CHECK-NOT: env._memcpy
+; CHECK-NOT: env._memset
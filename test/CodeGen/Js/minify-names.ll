@@ -0,0 +1,47 @@
+; RUN: llc < %s -march=js -js-codegen -js-minify-names -js-name-map=%t.map | FileCheck %s
+; RUN: FileCheck -check-prefix=MAP %s < %t.map
+; RUN: llc < %s -march=js -O0 -js-minify-names | FileCheck -check-prefix=JSON %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+@.str = private constant [4 x i8] c"%d\0A\00"
+@counter = internal global i32 0
+
+; JSON: { "ident": "c", "intertype": "globalVariable"
+; JSON: { "ident": "a", "intertype": "function", "lineNum": 1, "params": [{ "item": "e", "intertype": "" }]
+; JSON-NEXT: [{ "ident": "f", "intertype": "load", "lineNum": 2, "operands": [{ "value": "b", "type": "i32*" }]},
+
+; The most used values get the shortest names.
+; CHECK: function a(c) {
+; CHECK-NEXT: c = c|0;
+; CHECK-NEXT: var d = 0, b = 0, e = 0, f = 0;
+; CHECK-NEXT: d = HEAP32[20>>2]|0;
+; CHECK-NEXT: b = (d + c)|0;
+define internal i32 @_ZN3foo3barEi(i32 %x) {
+  %a = load i32* @counter
+  %b = add i32 %a, %x
+  store i32 %b, i32* @counter
+  %c = mul i32 %b, %b
+  %d = add i32 %c, %b
+  ret i32 %d
+}
+
+; Exported and imported functions keep their names.
+; CHECK: function _main() {
+; CHECK-NEXT: var b = 0, c = 0, d = 0, argbuf = 0, sp = 0;
+; CHECK: b = a(3)|0;
+; CHECK-NEXT: c = a(b)|0;
+; CHECK: d = _printf(16, argbuf)|0;
+define i32 @main() {
+  %r = call i32 @_ZN3foo3barEi(i32 3)
+  %s = call i32 @_ZN3foo3barEi(i32 %r)
+  %1 = call i32 (i8*, ...)* @printf(i8* getelementptr ([4 x i8]* @.str, i32 0, i32 0), i32 %s)
+  ret i32 0
+}
+
+declare i32 @printf(i8*, ...)
+
+; MAP: global a _ZN3foo3barEi
+; MAP-NEXT: local a b vb
+; MAP-NEXT: local a c vx
+; MAP: local main b vr
@@ -0,0 +1,75 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+; RUN: llc < %s -march=js -js-codegen -js-coalesce-phis=false | FileCheck %s -check-prefix=NOCOALESCE
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; The induction variable and its increment share a local, and the back edge
+; carries no copy.
+; CHECK: function _count(vn) {
+; CHECK: var vi = 0, vc = 0;
+; CHECK: vi = (vi + 1)|0;
+; CHECK-NEXT: vc = (vi < vn)|0;
+; CHECK-NEXT: if (vc) {
+; CHECK-NEXT: continue L0;
+; NOCOALESCE: function _count(vn) {
+; NOCOALESCE: var vi = 0, vi1 = 0, vc = 0;
+; NOCOALESCE: vi = vi1;
+; NOCOALESCE-NEXT: continue L0;
+define i32 @count(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %i1 = add i32 %i, 1
+  %c = icmp slt i32 %i1, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i1
+}
+
+; The old value of the phi is used after the increment, so the two interfere
+; and the back edge keeps its copy.
+; CHECK: function _previous(vn) {
+; CHECK: vi1 = (vi + 1)|0;
+; CHECK: if (vc) {
+; CHECK-NEXT: vi = vi1;
+; CHECK-NEXT: continue L0;
+; CHECK: return vi|0;
+define i32 @previous(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %i1 = add i32 %i, 1
+  %c = icmp slt i32 %i1, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i
+}
+
+; The phis of a block are assigned in parallel.  A rotation of three values
+; is ordered through one temporary.
+; CHECK: function _rotate(vn) {
+; CHECK: va$phi = va;
+; CHECK-NEXT: va = vb;
+; CHECK-NEXT: vb = vc;
+; CHECK-NEXT: vc = va$phi;
+; CHECK-NEXT: continue L0;
+define i32 @rotate(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %a = phi i32 [ 1, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 2, %entry ], [ %c, %loop ]
+  %c = phi i32 [ 3, %entry ], [ %a, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %i1 = add i32 %i, 1
+  %done = icmp eq i32 %i1, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  %ab = mul i32 %a, 100
+  %bc = mul i32 %b, 10
+  %s = add i32 %ab, %bc
+  %r = add i32 %s, %c
+  ret i32 %r
+}
@@ -0,0 +1,71 @@
+; RUN: llc < %s -O0 -march=js -js-codegen -js-profile=%p/Inputs/profile-layout.prof | FileCheck %s
+
+; The edge profile: check runs 100 times and fails once, scale runs 50 times
+; and never clamps, but returns 0 for 20 of them.
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+declare void @report(i32)
+
+; The error path moves after the hot path, which falls through the if.
+; CHECK: function _check(vx) {
+; CHECK: L0: {
+; CHECK-NEXT: vbad = (vx < 0)|0;
+; CHECK-NEXT: if (vbad) {
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: }
+; CHECK-NEXT: vr = Math_imul(vx, 3)|0;
+; CHECK-NEXT: return vr|0;
+; CHECK-NEXT: }
+; CHECK-NEXT: _report(vx);
+; CHECK-NEXT: return (-1)|0;
+define i32 @check(i32 %x) {
+entry:
+  %bad = icmp slt i32 %x, 0
+  br i1 %bad, label %error, label %ok
+error:
+  call void @report(i32 %x)
+  ret i32 -1
+ok:
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+; A cold arm of a diamond comes after the hot one.  Branches that both run
+; often keep their order.
+; CHECK: function _scale(vx) {
+; CHECK: L0: {
+; CHECK-NEXT: L1: {
+; CHECK-NEXT: vbig = (vx > 1000)|0;
+; CHECK-NEXT: if (vbig) {
+; CHECK-NEXT: break L1;
+; CHECK-NEXT: }
+; CHECK-NEXT: vv = vx;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: }
+; CHECK-NEXT: vv = 1000;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: }
+; CHECK-NEXT: vpos = (vv > 0)|0;
+; CHECK-NEXT: if (vpos) {
+; CHECK-NEXT: vm = Math_imul(vv, 2)|0;
+; CHECK-NEXT: return vm|0;
+; CHECK-NEXT: } else {
+; CHECK-NEXT: return 0|0;
+; CHECK-NEXT: }
+define i32 @scale(i32 %x) {
+entry:
+  %big = icmp sgt i32 %x, 1000
+  br i1 %big, label %clamp, label %join
+clamp:
+  br label %join
+join:
+  %v = phi i32 [ 1000, %clamp ], [ %x, %entry ]
+  %pos = icmp sgt i32 %v, 0
+  br i1 %pos, label %body, label %done
+body:
+  %m = mul i32 %v, 2
+  ret i32 %m
+done:
+  ret i32 0
+}
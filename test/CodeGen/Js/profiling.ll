@@ -0,0 +1,56 @@
+; RUN: llc < %s -march=js -js-codegen -js-profile-instrument | FileCheck %s
+
+; The functions count their entries, and the edges that the optimal edge
+; profiler selects count their executions, in an llvmprof.out file at
+; address 16: [1, 0], [2, 2, <functions>], [7, 10, <edges>].
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; CHECK: function _f(vx) {
+; CHECK: HEAP32[32>>2] = {{.*}}NewFuncCounter
+; CHECK: if (vc) {
+; CHECK: HEAP32[60>>2] = {{.*}}NewFuncCounter
+; CHECK: } else {
+; CHECK: HEAP32[64>>2] = {{.*}}NewFuncCounter
+define internal i32 @f(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 5
+  br i1 %c, label %big, label %small
+big:
+  %a = mul i32 %x, 2
+  br label %done
+small:
+  %b = add i32 %x, 1
+  br label %done
+done:
+  %r = phi i32 [ %a, %big ], [ %b, %small ]
+  ret i32 %r
+}
+
+; The initialization call of the profiling runtime is removed, and main sees
+; its own argc.
+; CHECK: function _main(vargc, vargv) {
+; CHECK-NOT: llvm_start_opt_edge_profiling
+; CHECK: HEAP32[36>>2] = {{.*}}NewFuncCounter
+; CHECK: vs = vargc;
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %n, %loop ]
+  %s = phi i32 [ %argc, %entry ], [ %t, %loop ]
+  %v = call i32 @f(i32 %i)
+  %t = add i32 %s, %v
+  %n = add i32 %i, 1
+  %e = icmp eq i32 %n, 10
+  br i1 %e, label %out, label %loop
+out:
+  ret i32 %t
+}
+
+; CHECK: function _llvm_prof_data() {
+; CHECK-NEXT: return 16|0;
+; CHECK: function _llvm_prof_size() {
+; CHECK-NEXT: return 72|0;
+; CHECK: HEAPU8.set([1,0,0,0,0,0,0,0,2,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,7,0,0,0,10,0,0,0,
+; CHECK: return { _main: _main, _llvm_prof_data: _llvm_prof_data, _llvm_prof_size: _llvm_prof_size };
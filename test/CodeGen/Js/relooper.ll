@@ -0,0 +1,135 @@
+; RUN: llc < %s -O0 -march=js -js-codegen | FileCheck %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; A diamond is a labeled block that both arms break out of.
+; CHECK: function _max(va, vb) {
+; CHECK-NOT: label
+; CHECK: L0: {
+; CHECK-NEXT: vc = (va > vb)|0;
+; CHECK-NEXT: if (vc) {
+; CHECK-NEXT: vm = va;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: } else {
+; CHECK-NEXT: vm = vb;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: }
+; CHECK-NEXT: }
+; CHECK-NEXT: return vm|0;
+define i32 @max(i32 %a, i32 %b) {
+entry:
+  %c = icmp sgt i32 %a, %b
+  br i1 %c, label %then, label %else
+then:
+  br label %join
+else:
+  br label %join
+join:
+  %m = phi i32 [ %a, %then ], [ %b, %else ]
+  ret i32 %m
+}
+
+; Nested loops continue their own label, and the exit of the inner loop is
+; nested in the code that leaves it.
+; CHECK: function _triangle(vn) {
+; CHECK-NOT: label
+; CHECK: L0: while (1) {
+; CHECK: L1: while (1) {
+; CHECK: continue L1;
+; CHECK: continue L0;
+; CHECK: return
+define i32 @triangle(i32 %n) {
+entry:
+  br label %outer
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i1, %outer.latch ]
+  %s = phi i32 [ 0, %entry ], [ %s2, %outer.latch ]
+  br label %inner
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j1, %inner ]
+  %s1 = phi i32 [ %s, %outer ], [ %s2, %inner ]
+  %s2 = add i32 %s1, 1
+  %j1 = add i32 %j, 1
+  %ci = icmp slt i32 %j1, %i
+  br i1 %ci, label %inner, label %outer.latch
+outer.latch:
+  %i1 = add i32 %i, 1
+  %co = icmp slt i32 %i1, %n
+  br i1 %co, label %outer, label %exit
+exit:
+  ret i32 %s2
+}
+
+; Cases that share a destination break to the block before it.
+; CHECK: function _classify(vx) {
+; CHECK: L0: {
+; CHECK-NEXT: L1: {
+; CHECK-NEXT: if (((vx - 1)>>>0) <= 1) {
+; CHECK-NEXT: break L1;
+; CHECK-NEXT: }
+; CHECK-NEXT: if (vx == 3) {
+; CHECK-NEXT: vr = 30;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: }
+; CHECK-NEXT: return (-1)|0;
+; CHECK: vr = 10;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: }
+; CHECK-NEXT: return vr|0;
+define i32 @classify(i32 %x) {
+entry:
+  switch i32 %x, label %other [ i32 1, label %small
+                                i32 2, label %small
+                                i32 3, label %three ]
+small:
+  br label %done
+three:
+  br label %done
+other:
+  ret i32 -1
+done:
+  %r = phi i32 [ 10, %small ], [ 30, %three ]
+  ret i32 %r
+}
+
+; A loop with two entries is entered through a dispatch on the label.  The
+; phis share a local with their incoming values, so the edges carry no copies.
+; CHECK: function _irreducible(vc, vn) {
+; CHECK: label = 0;
+; CHECK: if (vc) {
+; CHECK-NEXT: vi = 0;
+; CHECK-NEXT: label = 1;
+; CHECK-NEXT: break L0;
+; CHECK-NEXT: } else {
+; CHECK-NEXT: vi = 5;
+; CHECK-NEXT: label = 2;
+; CHECK-NEXT: break L0;
+; CHECK: L1: while (1) {
+; CHECK-NEXT: L2: {
+; CHECK-NEXT: switch (label|0) {
+; CHECK-NEXT: case 1: {
+; CHECK-NEXT: vi = (vi + 1)|0;
+; CHECK: label = 2;
+; CHECK-NEXT: continue L1;
+; CHECK: default: {
+; CHECK-NEXT: vi = (vi + 2)|0;
+; CHECK: label = 1;
+; CHECK-NEXT: continue L1;
+; CHECK: return vi|0;
+define i32 @irreducible(i1 %c, i32 %n) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  %i = phi i32 [ 0, %entry ], [ %ib, %b ]
+  %ia = add i32 %i, 1
+  %ca = icmp slt i32 %ia, %n
+  br i1 %ca, label %b, label %exit
+b:
+  %j = phi i32 [ 5, %entry ], [ %ia, %a ]
+  %ib = add i32 %j, 2
+  %cb = icmp slt i32 %ib, %n
+  br i1 %cb, label %a, label %exit
+exit:
+  %r = phi i32 [ %ia, %a ], [ %ib, %b ]
+  ret i32 %r
+}
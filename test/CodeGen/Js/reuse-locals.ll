@@ -0,0 +1,79 @@
+; RUN: llc < %s -march=js -js-codegen -js-reuse-locals | FileCheck %s
+; RUN: llc < %s -march=js -js-codegen -js-reuse-locals > %t1
+; RUN: llc < %s -march=js -js-codegen -js-reuse-locals -js-threads=2 > %t2
+; RUN: diff %t1 %t2
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; Integers and doubles never share a local.
+; CHECK: function _chain(vx) {
+; An expression is evaluated before its local is assigned, so a value may take
+; the local of its last operand.
+; CHECK: var va = 0, vd = 0.0, ve = 0;
+define i32 @chain(i32 %x) {
+entry:
+; CHECK-NEXT: va = (vx + 1)|0;
+  %a = add i32 %x, 1
+; CHECK-NEXT: va = Math_imul(va, 3)|0;
+  %b = mul i32 %a, 3
+; CHECK-NEXT: va = (va - 7)|0;
+  %c = sub i32 %b, 7
+; CHECK-NEXT: vd = +(1.0 + 2.0);
+  %d = fadd double 1.0, 2.0
+; CHECK-NEXT: ve = ~~vd;
+  %e = fptosi double %d to i32
+; CHECK-NEXT: va = (va + ve)|0;
+  %f = add i32 %c, %e
+  ret i32 %f
+}
+
+; The phis are assigned after the condition has been tested, so the
+; condition may take the local of a value that is assigned to a phi, and the
+; phis share the locals of their incoming values, which leaves the back edge
+; without copies.
+; CHECK: function _loop(vn) {
+; CHECK: var vi = 0, vt = 0, vsq = 0,
+define i32 @loop(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %t = phi i32 [ 0, %entry ], [ %t1, %loop ]
+; CHECK: vsq = Math_imul(vi, vi)|0;
+  %sq = mul i32 %i, %i
+; CHECK-NEXT: vt = (vt + vsq)|0;
+  %t1 = add i32 %t, %sq
+; CHECK-NEXT: vi = (vi + 1)|0;
+  %i1 = add i32 %i, 1
+; CHECK-NEXT: vsq = (vi < vn)|0;
+  %c = icmp slt i32 %i1, %n
+; CHECK-NEXT: if (vsq) {
+; CHECK-NEXT: continue L0;
+  br i1 %c, label %loop, label %exit
+exit:
+; CHECK: vi = Math_imul(vt, 2)|0;
+; CHECK-NEXT: return vi|0;
+  %r = mul i32 %t1, 2
+  ret i32 %r
+}
+
+; Phis of the same block never share a local, and the cycle of their copies
+; is broken with a temporary.
+; CHECK: function _swap(vn) {
+; CHECK: va$phi = va;
+; CHECK-NEXT: va = vb;
+; CHECK-NEXT: vb = va$phi;
+; CHECK-NEXT: continue L0;
+define i32 @swap(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %a = phi i32 [ 0, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 1, %entry ], [ %a, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %i1 = add i32 %i, 1
+  %c = icmp slt i32 %i1, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %a
+}
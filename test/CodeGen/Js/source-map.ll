@@ -0,0 +1,59 @@
+; RUN: llc < %s -march=js -js-codegen -js-source-map=%t.map | FileCheck %s
+; RUN: FileCheck -check-prefix=MAP %s < %t.map
+; RUN: llc < %s -march=js -js-codegen -js-minify-names -js-split=%t.serial -js-source-map=%t1.map | grep -v sourceMappingURL > %t1
+; RUN: llc < %s -march=js -js-codegen -js-minify-names -js-split=%t.threads -js-threads=2 -js-source-map=%t2.map | grep -v sourceMappingURL > %t2
+; RUN: diff %t1 %t2
+; RUN: diff %t1.map %t2.map
+
+; The instructions are mapped to their debug locations.  An instruction with
+; the same location as the one before it, like the branch and the returns
+; below, shares its mapping.
+
+; CHECK: vs = (va + vb)|0;
+; CHECK-NEXT: vc = (vs > 10)|0;
+; CHECK-NEXT: if (vc) {
+; CHECK-NEXT: vm = Math_imul(vs, 2)|0;
+; CHECK-NEXT: return vm|0;
+; CHECK-NEXT: } else {
+; CHECK-NEXT: return vs|0;
+; CHECK: vr = _add(1, 2)|0;
+; CHECK-NEXT: return vr|0;
+; CHECK: //# sourceMappingURL=source-map.ll.tmp.map
+
+; MAP: {"version":3,"mappings":"{{;+}}EACW;EACL;;IACF;;;IACF;;;;;EAIO;EACP","sources":["/src/x.c"],"names":[]}
+
+define i32 @add(i32 %a, i32 %b) nounwind {
+entry:
+  %s = add i32 %a, %b, !dbg !10
+  %c = icmp sgt i32 %s, 10, !dbg !11
+  br i1 %c, label %big, label %small, !dbg !11
+
+big:
+  %m = mul i32 %s, 2, !dbg !12
+  ret i32 %m, !dbg !12
+
+small:
+  ret i32 %s, !dbg !13
+}
+
+define i32 @main() nounwind {
+entry:
+  %r = call i32 @add(i32 1, i32 2), !dbg !14
+  ret i32 %r, !dbg !15
+}
+
+!llvm.dbg.sp = !{!0, !6}
+!0 = metadata !{i32 589870, i32 0, metadata !1, metadata !"add", metadata !"add", metadata !"", metadata !1, i32 1, metadata !3, i1 false, i1 true, i32 0, i32 0, null, i32 0, i1 false, i32 (i32, i32)* @add}
+!1 = metadata !{i32 589865, metadata !"x.c", metadata !"/src", metadata !2}
+!2 = metadata !{i32 589841, i32 0, i32 12, metadata !"x.c", metadata !"/src", metadata !"clang", i1 true, i1 false, metadata !"", i32 0}
+!3 = metadata !{i32 589845, metadata !1, metadata !"", metadata !1, i32 0, i64 0, i64 0, i64 0, i32 0, null, metadata !4, i32 0, null}
+!4 = metadata !{metadata !5}
+!5 = metadata !{i32 589860, metadata !2, metadata !"int", metadata !1, i32 0, i64 32, i64 32, i64 0, i32 0, i32 5}
+!6 = metadata !{i32 589870, i32 0, metadata !1, metadata !"main", metadata !"main", metadata !"", metadata !1, i32 8, metadata !3, i1 false, i1 true, i32 0, i32 0, null, i32 0, i1 false, i32 ()* @main}
+!8 = metadata !{i32 589835, metadata !0, i32 2, i32 12, metadata !1, i32 0}
+!10 = metadata !{i32 2, i32 12, metadata !0, null}
+!11 = metadata !{i32 3, i32 7, metadata !8, null}
+!12 = metadata !{i32 4, i32 5, metadata !8, null}
+!13 = metadata !{i32 5, i32 3, metadata !0, null}
+!14 = metadata !{i32 9, i32 10, metadata !6, null}
+!15 = metadata !{i32 10, i32 3, metadata !6, null}
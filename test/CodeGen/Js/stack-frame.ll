@@ -0,0 +1,113 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+; RUN: llc < %s -march=js -js-codegen -js-share-stack-slots=false | FileCheck %s -check-prefix=NOSHARE
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+declare void @use(i32*)
+declare void @llvm.lifetime.start(i64, i8* nocapture)
+declare void @llvm.lifetime.end(i64, i8* nocapture)
+
+; The arrays are indexed with variables, so they stay in memory, but the
+; contents of the first are dead once the second is written, and they share
+; a slot.
+; CHECK: function _phases(vi, vj) {
+; CHECK: sp = STACKTOP;
+; CHECK-NEXT: STACKTOP = (STACKTOP + 32)|0;
+; CHECK-NEXT: va = sp;
+; CHECK-NEXT: vb = sp;
+; CHECK: STACKTOP = sp;
+; NOSHARE: function _phases(vi, vj) {
+; NOSHARE: STACKTOP = (STACKTOP + 64)|0;
+; NOSHARE-NEXT: va = sp;
+; NOSHARE-NEXT: vb = (sp + 32)|0;
+define i32 @phases(i32 %i, i32 %j) {
+entry:
+  %a = alloca [8 x i32]
+  %b = alloca [8 x i32]
+  %pa = getelementptr [8 x i32]* %a, i32 0, i32 %i
+  store i32 1, i32* %pa
+  %qa = getelementptr [8 x i32]* %a, i32 0, i32 %j
+  %x = load i32* %qa
+  %pb = getelementptr [8 x i32]* %b, i32 0, i32 %i
+  store i32 %x, i32* %pb
+  %qb = getelementptr [8 x i32]* %b, i32 0, i32 %j
+  %y = load i32* %qb
+  ret i32 %y
+}
+
+; The first array is read after the second is written.
+; CHECK: function _overlap(vi, vj) {
+; CHECK: STACKTOP = (STACKTOP + 64)|0;
+; CHECK-NEXT: va = sp;
+; CHECK-NEXT: vb = (sp + 32)|0;
+define i32 @overlap(i32 %i, i32 %j) {
+entry:
+  %a = alloca [8 x i32]
+  %b = alloca [8 x i32]
+  %pa = getelementptr [8 x i32]* %a, i32 0, i32 %i
+  store i32 1, i32* %pa
+  %pb = getelementptr [8 x i32]* %b, i32 0, i32 %i
+  store i32 2, i32* %pb
+  %qa = getelementptr [8 x i32]* %a, i32 0, i32 %j
+  %x = load i32* %qa
+  %qb = getelementptr [8 x i32]* %b, i32 0, i32 %j
+  %y = load i32* %qb
+  %r = add i32 %x, %y
+  ret i32 %r
+}
+
+; Every iteration writes both arrays again, but only the lifetime markers
+; tell that the contents of one are dead while the other is in use.
+; CHECK: function _markers(vn, vi) {
+; CHECK: STACKTOP = (STACKTOP + 16)|0;
+; CHECK-NEXT: va = sp;
+; CHECK-NEXT: vb = sp;
+define i32 @markers(i32 %n, i32 %i) {
+entry:
+  %a = alloca [4 x i32]
+  %b = alloca [4 x i32]
+  %a8 = bitcast [4 x i32]* %a to i8*
+  %b8 = bitcast [4 x i32]* %b to i8*
+  br label %loop
+loop:
+  %k = phi i32 [ 0, %entry ], [ %k1, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s2, %loop ]
+  call void @llvm.lifetime.start(i64 16, i8* %a8)
+  %pa = getelementptr [4 x i32]* %a, i32 0, i32 %i
+  store i32 %k, i32* %pa
+  %x = load i32* %pa
+  call void @llvm.lifetime.end(i64 16, i8* %a8)
+  call void @llvm.lifetime.start(i64 16, i8* %b8)
+  %pb = getelementptr [4 x i32]* %b, i32 0, i32 %i
+  store i32 %x, i32* %pb
+  %y = load i32* %pb
+  call void @llvm.lifetime.end(i64 16, i8* %b8)
+  %s1 = add i32 %s, %x
+  %s2 = add i32 %s1, %y
+  %k1 = add i32 %k, 1
+  %c = icmp slt i32 %k1, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %s2
+}
+
+; An alloca whose address escapes has a slot of its own, and allocas of
+; variable size are still allocated when they are reached.
+; CHECK: function _escape(vn, vi) {
+; CHECK: STACKTOP = (STACKTOP + 40)|0;
+; CHECK-NEXT: va = sp;
+; CHECK-NEXT: ve = (sp + 32)|0;
+; CHECK-NEXT: vd = STACKTOP;
+; CHECK-NEXT: STACKTOP = (STACKTOP + (Math_imul(vn, 4) + 7 & -8))|0;
+define i32 @escape(i32 %n, i32 %i) {
+entry:
+  %a = alloca [8 x i32]
+  %e = alloca i32
+  %d = alloca i32, i32 %n
+  %pa = getelementptr [8 x i32]* %a, i32 0, i32 %i
+  store i32 1, i32* %pa
+  call void @use(i32* %e)
+  call void @use(i32* %d)
+  %x = load i32* %pa
+  ret i32 %x
+}
@@ -0,0 +1,73 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: llc < %t.bc -march=js -js-codegen -O0 > %t1
+; RUN: llc < %t.bc -march=js -js-codegen -O0 -lazy-bitcode -js-stream > %t2
+; RUN: diff %t1 %t2
+; RUN: llc < %t.bc -march=js -js-codegen -O0 -js-threads=2 -lazy-bitcode -js-stream > %t3
+; RUN: diff %t1 %t3
+; RUN: llc < %t.bc -march=js -js-codegen -O0 -js-minify-names > %t4
+; RUN: llc < %t.bc -march=js -js-codegen -O0 -js-minify-names -lazy-bitcode -js-stream > %t5
+; RUN: diff %t4 %t5
+; RUN: llc < %t.bc -march=js -O0 -js-type-table > %t6
+; RUN: llc < %t.bc -march=js -O0 -js-type-table -lazy-bitcode -js-stream > %t7
+; RUN: diff %t6 %t7
+; RUN: llc < %t.bc -march=js -js-codegen -O0 -lazy-bitcode -js-stream | FileCheck %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+%pair = type { i32, i64 }
+
+@handler = global i32 (i32)* @twice
+@msg = internal constant [3 x i8] c"hi\00"
+@extern_value = external global i32
+@last = internal global %pair zeroinitializer
+
+declare i32 @puts(i8*)
+declare i64 @host_wide(i64)
+
+; The bodies of the functions are released as they are emitted, but the
+; declarations that only they referred to are still imported, and the
+; internal functions are still not exported.
+; CHECK: function _twice(vx) {
+define internal i32 @twice(i32 %x) {
+  %1 = shl i32 %x, 1
+  ret i32 %1
+}
+
+; A function whose i64 signature is legalized when its body is read keeps
+; its name and its entry in the function table.
+; CHECK: function _wide(va_2e_lo, va_2e_hi) {
+; CHECK: HEAP32[4>>2] =
+define internal i64 @wide(i64 %a) {
+  %1 = call i64 @host_wide(i64 %a)
+  %2 = getelementptr %pair* @last, i32 0, i32 1
+  store i64 %1, i64* %2
+  ret i64 %1
+}
+
+define i32 @greet() {
+  %1 = call i32 @puts(i8* getelementptr ([3 x i8]* @msg, i32 0, i32 0))
+  %2 = load i32* @extern_value
+  %3 = add i32 %1, %2
+  ret i32 %3
+}
+
+; CHECK: function _main() {
+; CHECK: _wide(
+define i32 @main() {
+  %f = load i32 (i32)** @handler
+  %1 = call i32 @greet()
+  %2 = call i32 %f(i32 %1)
+  %w = call i64 @wide(i64 5)
+  %p = select i1 true, i64 (i64)* @wide, i64 (i64)* @wide
+  %v = call i64 %p(i64 %w)
+  %t = trunc i64 %v to i32
+  %3 = add i32 %2, %t
+  ret i32 %3
+}
+
+; CHECK: var _puts = env._puts;
+; CHECK: var _host_wide = env._host_wide;
+; CHECK: var _extern_value = env._extern_value|0;
+; CHECK: var FUNCTION_TABLE_ii = [abort, _twice];
+; CHECK: var FUNCTION_TABLE_iii = [abort, _wide];
+; CHECK: return { _greet: _greet, _main: _main };
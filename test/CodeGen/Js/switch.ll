@@ -0,0 +1,115 @@
+; RUN: llc < %s -march=js -js-codegen | FileCheck %s
+
+target datalayout = "e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:32:64-n8:16:32"
+
+; Up to three ranges of cases are compared one by one, a range of
+; consecutive values with one unsigned comparison.
+; CHECK: function _small(vx) {
+; CHECK: if (vx == (-1)) {
+; CHECK: if (((vx - 10)>>>0) <= 2 | vx == 20) {
+define i32 @small(i32 %x) {
+entry:
+  switch i32 %x, label %other [ i32 10, label %a
+                                i32 11, label %a
+                                i32 12, label %a
+                                i32 20, label %a
+                                i32 -1, label %b ]
+a:
+  ret i32 1
+b:
+  ret i32 2
+other:
+  ret i32 0
+}
+
+; Cases that span fewer values than a mask has bits, and lead to few
+; destinations, are tested with masks, the most popular one first.
+; CHECK: function _bits(vx) {
+; CHECK: if ((vx>>>0) <= 30) {
+; CHECK-NEXT: if ((1 << vx) & 2730) {
+; CHECK: if ((1 << vx) & 1073741828) {
+define i32 @bits(i8 signext %x) {
+entry:
+  switch i8 %x, label %no [ i8 1, label %odd
+                            i8 3, label %odd
+                            i8 5, label %odd
+                            i8 7, label %odd
+                            i8 9, label %odd
+                            i8 11, label %odd
+                            i8 2, label %other
+                            i8 30, label %other ]
+odd:
+  ret i32 1
+other:
+  ret i32 2
+no:
+  ret i32 0
+}
+
+; Dense cases become a switch statement with sorted cases, which the engines
+; compile into a jump table.
+; CHECK: function _dense(vx) {
+; CHECK: switch (vx|0) {
+; CHECK-NEXT: case 1: case 5: {
+; CHECK: case 2: {
+; CHECK: case 3: {
+; CHECK: case 4: {
+; CHECK: case 6: {
+; CHECK: return 0|0;
+define i32 @dense(i32 %x) {
+entry:
+  switch i32 %x, label %other [ i32 6, label %f
+                                i32 5, label %a
+                                i32 4, label %e
+                                i32 3, label %d
+                                i32 2, label %c
+                                i32 1, label %a ]
+a:
+  ret i32 10
+c:
+  ret i32 20
+d:
+  ret i32 30
+e:
+  ret i32 40
+f:
+  ret i32 50
+other:
+  ret i32 0
+}
+
+; Sparse cases are searched in a binary tree, which is split where the gap
+; between the values is widest compared to the density of the halves, and
+; whose dense leaves become jump tables.
+; CHECK: function _sparse(vx) {
+; CHECK: if (vx < 100000) {
+; CHECK-NEXT: if (vx < 1000) {
+; CHECK-NEXT: switch (vx|0) {
+; CHECK: } else {
+; CHECK-NEXT: if (vx == 1000) {
+; CHECK: } else {
+; CHECK-NEXT: if (vx == 100000) {
+; CHECK: return 0|0;
+define i32 @sparse(i32 %x) {
+entry:
+  switch i32 %x, label %other [ i32 0, label %a
+                                i32 1, label %b
+                                i32 2, label %c
+                                i32 3, label %d
+                                i32 1000, label %e
+                                i32 100000, label %f ]
+a:
+  ret i32 1
+b:
+  ret i32 2
+c:
+  ret i32 3
+d:
+  ret i32 4
+e:
+  ret i32 5
+f:
+  ret i32 6
+other:
+  ret i32 0
+}
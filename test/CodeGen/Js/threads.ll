@@ -0,0 +1,48 @@
+; RUN: llc < %s -march=js -O0 > %t1
+; RUN: llc < %s -march=js -O0 -js-threads=4 > %t2
+; RUN: diff %t1 %t2
+; RUN: llc < %s -march=js -js-threads=3 | FileCheck %s
+
+; Functions emitted in parallel must come out in module order, with the same
+; value names and line numbers as in the serial output.
+
+@.str = private constant [4 x i8] c"%d\0A\00"
+@table = internal global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+; CHECK: { "ident": "sum", "intertype": "function", "lineNum": 1
+define i32 @sum(i32* %p, i32 %n) {
+entry:
+  %0 = icmp sgt i32 %n, 0
+  br i1 %0, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %1, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %3, %loop ]
+  %1 = add i32 %i, 1
+  %2 = getelementptr i32* %p, i32 %i
+  %v = load i32* %2
+  %3 = add i32 %acc, %v
+  %4 = icmp slt i32 %1, %n
+  br i1 %4, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %3, %loop ]
+  ret i32 %r
+}
+
+; CHECK: { "ident": "twice", "intertype": "function", "lineNum": 14
+define internal i32 @twice(i32) {
+  %2 = mul i32 %0, 2
+  ret i32 %2
+}
+
+; CHECK: { "ident": "main", "intertype": "function", "lineNum": 17
+define i32 @main() {
+  %1 = getelementptr [4 x i32]* @table, i32 0, i32 0
+  %2 = call i32 @sum(i32* %1, i32 4)
+  %3 = call i32 @twice(i32 %2)
+  %4 = call i32 (i8*, ...)* @printf(i8* getelementptr ([4 x i8]* @.str, i32 0, i32 0), i32 %3)
+  ret i32 0
+}
+
+declare i32 @printf(i8*, ...)
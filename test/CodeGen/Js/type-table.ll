@@ -0,0 +1,25 @@
+; RUN: llc < %s -march=js -O0 -js-type-table | FileCheck %s
+; RUN: llc < %s -march=js -O0 -js-type-table > %t1
+; RUN: llc < %s -march=js -O0 -js-type-table -js-threads=2 > %t2
+; RUN: diff %t1 %t2
+
+; Types are numbered in the order in which the module first uses them.
+; CHECK: [{ "intertype": "typeTable", "types": ["{ i32, i32 }*", "{ i32, i32 }", "i32", "i8*", "i32 (i8*, ...)*", "i64", "i32*", "void"]},
+; CHECK-NEXT: { "ident": "point", "intertype": "globalVariable", "lineNum": 0, "type": 0, "value": { "text": [1, 2] }},
+
+%struct.point = type { i32, i32 }
+
+@point = internal global %struct.point { i32 1, i32 2 }
+
+; CHECK: { "ident": "main", "intertype": "function", "lineNum": 1, "params": [{ "item": "vs", "intertype": "" }], "returnType": 2, "basicBlocks":
+define i32 @main(i8* %s) {
+; CHECK: { "ident": "v0", "intertype": "call", "lineNum": 2, "operands": [{ "value": "vs", "type": 3 }, { "value": "printf", "type": 4 }]},
+  %1 = call i32 (i8*, ...)* @printf(i8* %s)
+; CHECK: { "ident": "v1", "intertype": "offset", "lineNum": 3, "operands": [{ "value": "point", "type": 0 }, { "value": 4, "type": 2 }]},
+  %2 = getelementptr %struct.point* @point, i64 0, i32 1
+  %3 = load i32* %2
+; CHECK: { "intertype": "ret", "lineNum": 5, "type": 7, "operands": [{ "value": "v2", "type": 2 }]}
+  ret i32 %3
+}
+
+declare i32 @printf(i8*, ...)
@@ -76,6 +76,11 @@ MAttrs("mattr",
   cl::desc("Target specific attributes (-mattr=help for details)"),
   cl::value_desc("a1,+a2,-a3,..."));
 
+static cl::opt<bool>
+LazyBitcode("lazy-bitcode",
+  cl::desc("Read the function bodies of the input module only when the code "
+           "generator needs them (see -js-stream)"));
+
 static cl::opt<bool>
 RelaxAll("mc-relax-all",
   cl::desc("When used with filetype=obj, "
@@ -212,7 +217,10 @@ int main(int argc, char **argv) {
   SMDiagnostic Err;
   std::auto_ptr<Module> M;
 
-  M.reset(ParseIRFile(InputFilename, Err, Context));
+  if (LazyBitcode)
+    M.reset(getLazyIRFileModule(InputFilename, Err, Context));
+  else
+    M.reset(ParseIRFile(InputFilename, Err, Context));
   if (M.get() == 0) {
     Err.Print(argv[0], errs());
     return 1;
@@ -261,6 +269,16 @@ int main(int argc, char **argv) {
     }
   }
 
+  // Only the javascript backend reads the bodies as it goes, the other code
+  // generators need all of them.
+  std::string ErrorMessage;
+  if (LazyBitcode && StringRef(TheTarget->getName()) != "js" &&
+      mod.MaterializeAll(&ErrorMessage)) {
+    errs() << argv[0] << ": bitcode didn't read correctly.\n";
+    errs() << "Reason: " << ErrorMessage << "\n";
+    return 1;
+  }
+
   // Package up features to be passed to target/subtarget
   std::string FeaturesStr;
   if (MCPU.size() || MAttrs.size()) {
@@ -0,0 +1,505 @@
+//===-- llvm-jsbench.cpp - Javascript backend throughput benchmark --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This tool measures how fast the Javascript backend translates modules.  It
+// generates large synthetic modules, each of which stresses one part of the
+// writer, and runs the backend on them the way llc -march=js does:
+//
+//   structs     deeply nested struct types, and globals and GEPs through them
+//   arrays      huge constant arrays of integers, doubles, strings and structs
+//   functions   many small functions that call each other
+//   switches    giant functions made of switches with many cases
+//
+// Every phase of every workload is reported as one line of JSON: the time it
+// took, the bytes written and the functions translated per second, and the
+// peak resident set size of the phase.  The options of the backend, such as
+// -js-codegen or -js-threads, are accepted and apply to every run.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetRegistry.h"
+#include "llvm/Target/TargetSelect.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+using namespace llvm;
+
+namespace {
+  enum Workload { Structs, Arrays, Functions, Switches };
+}
+
+static const char *const WorkloadNames[] = {
+  "structs", "arrays", "functions", "switches"
+};
+
+static cl::list<Workload>
+Workloads("workload",
+  cl::desc("Run only these workloads (default = all of them):"),
+  cl::values(
+    clEnumValN(Structs, "structs",
+               "Deeply nested struct types"),
+    clEnumValN(Arrays, "arrays",
+               "Huge constant arrays"),
+    clEnumValN(Functions, "functions",
+               "Many small functions"),
+    clEnumValN(Switches, "switches",
+               "Giant functions made of switches"),
+    clEnumValEnd),
+  cl::CommaSeparated);
+
+static cl::opt<unsigned>
+Scale("scale", cl::desc("Size of the generated modules (default = 1)"),
+      cl::value_desc("N"), cl::init(1));
+
+static cl::opt<unsigned>
+Runs("runs", cl::desc("Number of runs of every phase, of which the fastest "
+                      "is reported (default = 3)"),
+     cl::value_desc("N"), cl::init(3));
+
+static cl::opt<char>
+OptLevel("O",
+         cl::desc("Optimization level. [-O0, -O1, -O2, or -O3] "
+                  "(default = '-O2')"),
+         cl::Prefix,
+         cl::ZeroOrMore,
+         cl::init(' '));
+
+static const char *ProgramName;
+
+/// CountingOstream - A stream that throws its output away, and only counts
+/// the bytes written to it, so that the size of the output does not weigh on
+/// the memory of the benchmark.
+class CountingOstream : public raw_ostream {
+  uint64_t Bytes;
+
+  virtual void write_impl(const char *Ptr, size_t Size) { Bytes += Size; }
+  virtual uint64_t current_pos() const { return Bytes; }
+
+public:
+  CountingOstream() : Bytes(0) {}
+  ~CountingOstream() { flush(); }
+};
+
+/// PhaseResult - The measurements of one phase of a workload.
+struct PhaseResult {
+  double Seconds;
+  uint64_t Bytes;
+  unsigned Functions;
+  uint64_t PeakRSS;
+};
+
+/// resetPeakRSS - Start a new high-water mark of the resident set size, where
+/// the system allows it.  Elsewhere the peak is that of the whole process.
+static void resetPeakRSS() {
+#ifdef __linux__
+  if (FILE *F = fopen("/proc/self/clear_refs", "w")) {
+    fputs("5", F);
+    fclose(F);
+  }
+#endif
+}
+
+/// getPeakRSS - Return the peak resident set size, in kilobytes, since the
+/// last call to resetPeakRSS.
+static uint64_t getPeakRSS() {
+#ifdef __linux__
+  if (FILE *F = fopen("/proc/self/status", "r")) {
+    char Line[256];
+    unsigned long long KB = 0;
+    while (fgets(Line, sizeof(Line), F))
+      if (sscanf(Line, "VmHWM: %llu kB", &KB) == 1)
+        break;
+    fclose(F);
+    if (KB)
+      return KB;
+  }
+#endif
+#if defined(HAVE_GETRUSAGE) && defined(HAVE_SYS_RESOURCE_H)
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) == 0)
+    return Usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+/// nextRandom - Return the next number of a linear congruential generator,
+/// which keeps the generated modules the same from one run to the next.
+static uint32_t nextRandom(uint32_t &Seed) {
+  Seed = Seed * 1103515245 + 12345;
+  return Seed >> 8;
+}
+
+/// buildStructs - Build a chain of struct types, each of which holds the
+/// previous one, with a constant global of each and a function that reads
+/// the innermost field of it through a GEP of the whole depth.
+static void buildStructs(Module &M) {
+  LLVMContext &Context = M.getContext();
+  const Type *Int16Ty = Type::getInt16Ty(Context);
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  const Type *DoubleTy = Type::getDoubleTy(Context);
+  const Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+  const ArrayType *ShortsTy = ArrayType::get(Int16Ty, 4);
+  unsigned Depth = 40 * Scale;
+
+  const Type *Inner = Int32Ty;
+  Constant *Init = ConstantInt::get(Int32Ty, 0);
+  std::vector<Value*> Indices(1, ConstantInt::get(Int32Ty, 0));
+  for (unsigned d = 0; d != Depth; ++d) {
+    std::vector<const Type*> Fields;
+    Fields.push_back(Inner);
+    Fields.push_back(Int32Ty);
+    Fields.push_back(DoubleTy);
+    Fields.push_back(ShortsTy);
+    Fields.push_back(Int8PtrTy);
+    const StructType *STy = StructType::get(Context, Fields);
+    M.addTypeName("struct.level" + utostr(d), STy);
+
+    std::vector<Constant*> Shorts;
+    for (unsigned i = 0; i != 4; ++i)
+      Shorts.push_back(ConstantInt::get(Int16Ty, d + i));
+    std::vector<Constant*> Values;
+    Values.push_back(Init);
+    Values.push_back(ConstantInt::get(Int32Ty, d));
+    Values.push_back(ConstantFP::get(DoubleTy, d * 0.5));
+    Values.push_back(ConstantArray::get(ShortsTy, Shorts));
+    Values.push_back(Constant::getNullValue(Int8PtrTy));
+    Init = ConstantStruct::get(STy, Values);
+    GlobalVariable *GV =
+      new GlobalVariable(M, STy, false, GlobalValue::InternalLinkage, Init,
+                         "level" + utostr(d));
+
+    // The innermost i32 is field 0 of every level.
+    Indices.push_back(ConstantInt::get(Int32Ty, 0));
+    Function *F = Function::Create(
+      FunctionType::get(Int32Ty, std::vector<const Type*>(1, Int32Ty),
+                        false),
+      GlobalValue::ExternalLinkage, "get_level" + utostr(d), &M);
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+    Value *Ptr = Builder.CreateInBoundsGEP(GV, Indices.begin(), Indices.end());
+    Value *Sum = Builder.CreateAdd(Builder.CreateLoad(Ptr), F->arg_begin());
+    Builder.CreateStore(Sum, Ptr);
+    Value *Count = Builder.CreateStructGEP(GV, 1);
+    Builder.CreateStore(Builder.CreateAdd(Builder.CreateLoad(Count), Sum),
+                        Count);
+    Builder.CreateRet(Sum);
+    Inner = STy;
+  }
+}
+
+/// buildArrays - Build constant arrays of integers, doubles, strings and
+/// structs, and a function that reads an element of each.
+static void buildArrays(Module &M) {
+  LLVMContext &Context = M.getContext();
+  const Type *Int16Ty = Type::getInt16Ty(Context);
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  const Type *DoubleTy = Type::getDoubleTy(Context);
+  unsigned NumElements = 20000 * Scale;
+  uint32_t Seed = 1;
+
+  std::vector<Constant*> Ints, Doubles, Pairs;
+  std::string Chars;
+  const StructType *PairTy = StructType::get(Context, Int32Ty, Int16Ty, NULL);
+  for (unsigned i = 0; i != NumElements; ++i) {
+    int32_t Value = nextRandom(Seed) - (1 << 23);
+    Ints.push_back(ConstantInt::get(Int32Ty, Value, true));
+    Doubles.push_back(ConstantFP::get(DoubleTy, Value / 64.0));
+    Chars += (char)(' ' + nextRandom(Seed) % 95);
+    Constant *Fields[] = {
+      ConstantInt::get(Int32Ty, i),
+      ConstantInt::get(Int16Ty, Value & 0x7fff)
+    };
+    Pairs.push_back(ConstantStruct::get(PairTy,
+                                        std::vector<Constant*>(Fields,
+                                                               Fields + 2)));
+  }
+
+  Constant *Inits[] = {
+    ConstantArray::get(ArrayType::get(Int32Ty, NumElements), Ints),
+    ConstantArray::get(ArrayType::get(DoubleTy, NumElements), Doubles),
+    ConstantArray::get(Context, Chars, true),
+    ConstantArray::get(ArrayType::get(PairTy, NumElements), Pairs)
+  };
+  const char *Names[] = { "ints", "doubles", "chars", "pairs" };
+
+  Function *F = Function::Create(
+    FunctionType::get(Int32Ty, std::vector<const Type*>(1, Int32Ty), false),
+    GlobalValue::ExternalLinkage, "read_arrays", &M);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  Value *Sum = F->arg_begin();
+  for (unsigned i = 0; i != 4; ++i) {
+    GlobalVariable *GV =
+      new GlobalVariable(M, Inits[i]->getType(), true,
+                         GlobalValue::InternalLinkage, Inits[i], Names[i]);
+    Value *Indices[] = { ConstantInt::get(Int32Ty, 0), F->arg_begin() };
+    Value *Ptr = Builder.CreateInBoundsGEP(GV, Indices, Indices + 2);
+    if (i == 3)
+      Ptr = Builder.CreateStructGEP(Ptr, 1);
+    Value *Element = Builder.CreateLoad(Ptr);
+    if (Element->getType()->isDoubleTy())
+      Element = Builder.CreateFPToSI(Element, Int32Ty);
+    else if (Element->getType() != Int32Ty)
+      Element = Builder.CreateSExt(Element, Int32Ty);
+    Sum = Builder.CreateAdd(Sum, Element);
+  }
+  Builder.CreateRet(Sum);
+}
+
+/// buildFunctions - Build many small functions, each of which does a little
+/// arithmetic and calls the previous one.
+static void buildFunctions(Module &M) {
+  LLVMContext &Context = M.getContext();
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  std::vector<const Type*> Params(2, Int32Ty);
+  const FunctionType *FTy = FunctionType::get(Int32Ty, Params, false);
+  unsigned NumFunctions = 2000 * Scale;
+
+  Function *Prev = 0;
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    Function *F = Function::Create(
+      FTy, i % 4 ? GlobalValue::InternalLinkage : GlobalValue::ExternalLinkage,
+      "small" + utostr(i), &M);
+    Function::arg_iterator AI = F->arg_begin();
+    Value *A = AI++, *B = AI;
+    A->setName("a");
+    B->setName("b");
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+    Value *Sum = Builder.CreateAdd(A, ConstantInt::get(Int32Ty, i));
+    Value *Product = Builder.CreateMul(Sum, B);
+    Value *Mixed = Builder.CreateXor(Product, Builder.CreateLShr(A, 3));
+    Value *Less = Builder.CreateICmpSLT(Mixed, B);
+    Value *Result = Builder.CreateSelect(Less, Mixed, Sum);
+    if (Prev)
+      Result = Builder.CreateCall2(Prev, Result, A);
+    Builder.CreateRet(Result);
+    Prev = F;
+  }
+}
+
+/// buildSwitches - Build functions made of one switch with many cases, some
+/// of them dense and the others sparse, whose cases meet at a phi.
+static void buildSwitches(Module &M) {
+  LLVMContext &Context = M.getContext();
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  unsigned NumFunctions = 4 * Scale, NumCases = 2000;
+  uint32_t Seed = 7;
+
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    Function *F = Function::Create(
+      FunctionType::get(Int32Ty, std::vector<const Type*>(2, Int32Ty), false),
+      GlobalValue::ExternalLinkage, "switch" + utostr(i), &M);
+    Function::arg_iterator AI = F->arg_begin();
+    Value *Key = AI++, *X = AI;
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+    BasicBlock *Default = BasicBlock::Create(Context, "default", F);
+    BasicBlock *Join = BasicBlock::Create(Context, "join", F);
+    IRBuilder<> Builder(Entry);
+    SwitchInst *SI = Builder.CreateSwitch(Key, Default, NumCases);
+
+    Builder.SetInsertPoint(Join);
+    PHINode *PN = Builder.CreatePHI(Int32Ty);
+    PN->reserveOperandSpace(NumCases + 1);
+    Builder.CreateRet(PN);
+
+    std::vector<uint32_t> Values;
+    for (unsigned c = 0; c != NumCases; ++c)
+      Values.push_back(i % 2 ? nextRandom(Seed) : c * 3);
+    std::sort(Values.begin(), Values.end());
+    Values.erase(std::unique(Values.begin(), Values.end()), Values.end());
+    for (unsigned c = 0, e = Values.size(); c != e; ++c) {
+      BasicBlock *Case = BasicBlock::Create(Context, "case", F, Join);
+      Builder.SetInsertPoint(Case);
+      Value *V = Builder.CreateMul(X, ConstantInt::get(Int32Ty, c + 1));
+      V = Builder.CreateAdd(V, ConstantInt::get(Int32Ty, Values[c]));
+      Builder.CreateBr(Join);
+      SI->addCase(cast<ConstantInt>(ConstantInt::get(Int32Ty, Values[c])),
+                  Case);
+      PN->addIncoming(V, Case);
+    }
+    Builder.SetInsertPoint(Default);
+    Builder.CreateBr(Join);
+    PN->addIncoming(X, Default);
+  }
+}
+
+/// buildModule - Build the module of the given workload.
+static Module *buildModule(Workload W, LLVMContext &Context,
+                           const TargetMachine &Target) {
+  Module *M = new Module(WorkloadNames[W], Context);
+  M->setDataLayout(Target.getTargetData()->getStringRepresentation());
+  switch (W) {
+  case Structs:   buildStructs(*M); break;
+  case Arrays:    buildArrays(*M); break;
+  case Functions: buildFunctions(*M); break;
+  case Switches:  buildSwitches(*M); break;
+  }
+  return M;
+}
+
+/// countFunctions - Return the number of functions defined by M.
+static unsigned countFunctions(const Module &M) {
+  unsigned Count = 0;
+  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration())
+      ++Count;
+  return Count;
+}
+
+/// measureBuild - Measure the generation of the module of W.
+static PhaseResult measureBuild(Workload W, const TargetMachine &Target) {
+  PhaseResult Best = { 0, 0, 0, 0 };
+  for (unsigned r = 0; r != Runs; ++r) {
+    LLVMContext Context;
+    resetPeakRSS();
+    TimeRecord Start = TimeRecord::getCurrentTime(true);
+    OwningPtr<Module> M(buildModule(W, Context, Target));
+    TimeRecord End = TimeRecord::getCurrentTime(false);
+    double Seconds = End.getWallTime() - Start.getWallTime();
+    if (!r || Seconds < Best.Seconds)
+      Best.Seconds = Seconds;
+    Best.Functions = countFunctions(*M);
+    Best.PeakRSS = std::max(Best.PeakRSS, getPeakRSS());
+  }
+  return Best;
+}
+
+/// measureEmit - Measure the translation of the module of W to a file of the
+/// given type.  Return false if the backend cannot write such files.
+static bool measureEmit(Workload W, TargetMachine &Target,
+                        TargetMachine::CodeGenFileType FileType,
+                        CodeGenOpt::Level OLvl, PhaseResult &Best) {
+  for (unsigned r = 0; r != Runs; ++r) {
+    LLVMContext Context;
+    OwningPtr<Module> M(buildModule(W, Context, Target));
+    unsigned Functions = countFunctions(*M);
+    PassManager PM;
+    PM.add(new TargetData(*Target.getTargetData()));
+    CountingOstream Out;
+    {
+      formatted_raw_ostream FOS(Out);
+      if (Target.addPassesToEmitFile(PM, FOS, FileType, OLvl, true))
+        return false;
+      resetPeakRSS();
+      TimeRecord Start = TimeRecord::getCurrentTime(true);
+      PM.run(*M);
+      FOS.flush();
+      TimeRecord End = TimeRecord::getCurrentTime(false);
+      double Seconds = End.getWallTime() - Start.getWallTime();
+      if (!r || Seconds < Best.Seconds)
+        Best.Seconds = Seconds;
+    }
+    Out.flush();
+    Best.Bytes = Out.tell();
+    Best.Functions = Functions;
+    Best.PeakRSS = std::max(Best.PeakRSS, getPeakRSS());
+  }
+  return true;
+}
+
+/// printResult - Print the measurements of a phase as one line of JSON.
+static void printResult(Workload W, const char *Phase,
+                        const PhaseResult &R) {
+  // Phases too fast for the clock still get finite rates.
+  double Seconds = std::max(R.Seconds, 1e-6);
+  outs() << "{\"workload\": \"" << WorkloadNames[W] << "\", \"phase\": \""
+         << Phase << "\", \"scale\": " << Scale << ", \"runs\": " << Runs
+         << ", \"seconds\": " << format("%.6f", R.Seconds)
+         << ", \"bytes\": " << R.Bytes
+         << ", \"functions\": " << R.Functions
+         << ", \"mb_per_s\": " << format("%.3f", R.Bytes / Seconds / 1e6)
+         << ", \"functions_per_s\": "
+         << format("%.1f", R.Functions / Seconds)
+         << ", \"peak_rss_kb\": " << R.PeakRSS << "}\n";
+  outs().flush();
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  ProgramName = argv[0];
+
+  InitializeAllTargets();
+  InitializeAllAsmPrinters();
+
+  cl::ParseCommandLineOptions(argc, argv,
+                              "javascript backend throughput benchmark\n");
+
+  CodeGenOpt::Level OLvl = CodeGenOpt::Default;
+  switch (OptLevel) {
+  default:
+    errs() << ProgramName << ": invalid optimization level.\n";
+    return 1;
+  case ' ': break;
+  case '0': OLvl = CodeGenOpt::None; break;
+  case '1': OLvl = CodeGenOpt::Less; break;
+  case '2': OLvl = CodeGenOpt::Default; break;
+  case '3': OLvl = CodeGenOpt::Aggressive; break;
+  }
+  if (!Runs) {
+    errs() << ProgramName << ": -runs must be at least 1.\n";
+    return 1;
+  }
+
+  const Target *TheTarget = 0;
+  for (TargetRegistry::iterator it = TargetRegistry::begin(),
+         ie = TargetRegistry::end(); it != ie; ++it)
+    if (!strcmp(it->getName(), "js")) {
+      TheTarget = &*it;
+      break;
+    }
+  if (!TheTarget) {
+    errs() << ProgramName << ": error: the javascript backend is not "
+           << "built.\n";
+    return 1;
+  }
+  OwningPtr<TargetMachine>
+    Target(TheTarget->createTargetMachine(sys::getHostTriple(), ""));
+  assert(Target.get() && "Could not allocate target machine!");
+
+  std::vector<Workload> Selected(Workloads.begin(), Workloads.end());
+  if (Selected.empty())
+    for (unsigned W = Structs; W <= Switches; ++W)
+      Selected.push_back((Workload)W);
+
+  for (unsigned i = 0, e = Selected.size(); i != e; ++i) {
+    Workload W = Selected[i];
+    printResult(W, "generate", measureBuild(W, *Target));
+    PhaseResult R = { 0, 0, 0, 0 };
+    if (measureEmit(W, *Target, TargetMachine::CGFT_AssemblyFile, OLvl, R))
+      printResult(W, "emit", R);
+    PhaseResult B = { 0, 0, 0, 0 };
+    if (measureEmit(W, *Target, TargetMachine::CGFT_ObjectFile, OLvl, B))
+      printResult(W, "emit-binary", B);
+  }
+  return 0;
+}
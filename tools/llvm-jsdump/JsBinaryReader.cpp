@@ -0,0 +1,106 @@
+//===-- JsBinaryReader.cpp - Reader for the binary intertype format -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the reference decoder for the binary intertype format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsBinaryReader.h"
+#include "llvm/Support/JsBinaryFormat.h"
+#include "llvm/Support/MathExtras.h"
+using namespace llvm;
+
+uint64_t JsBinaryCursor::readVBR() {
+  uint64_t V = 0;
+  for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+    if (Ptr == End) {
+      Failed = true;
+      return 0;
+    }
+    unsigned char Byte = *Ptr++;
+    V |= (uint64_t)(Byte & 0x7f) << Shift;
+    if (!(Byte & 0x80))
+      return V;
+  }
+  Failed = true;
+  return 0;
+}
+
+int64_t JsBinaryCursor::readSignedVBR() {
+  uint64_t V = readVBR();
+  return (int64_t)(V >> 1) ^ -(int64_t)(V & 1);
+}
+
+double JsBinaryCursor::readDouble() {
+  StringRef Bytes = readBytes(8);
+  if (Bytes.size() != 8)
+    return 0;
+  uint64_t Bits = 0;
+  for (unsigned i = 0; i != 8; ++i)
+    Bits |= (uint64_t)(unsigned char)Bytes[i] << (i * 8);
+  return BitsToDouble(Bits);
+}
+
+StringRef JsBinaryCursor::readBytes(uint64_t Size) {
+  if (Size > (uint64_t)(End - Ptr)) {
+    Failed = true;
+    Ptr = End;
+    return StringRef();
+  }
+  StringRef Bytes(reinterpret_cast<const char*>(Ptr), Size);
+  Ptr += Size;
+  return Bytes;
+}
+
+bool JsBinaryReader::open(StringRef Data, std::string &ErrorStr) {
+  if (Data.size() < 8 || !Data.startswith("JSIB")) {
+    ErrorStr = "not a binary intertype file";
+    return false;
+  }
+
+  // The trailer locates the pools.
+  uint64_t PoolsOffset = 0;
+  for (unsigned i = 0; i != 4; ++i)
+    PoolsOffset |= (uint64_t)(unsigned char)Data[Data.size() - 4 + i] << (i*8);
+  if (PoolsOffset < 4 || PoolsOffset > Data.size() - 4) {
+    ErrorStr = "invalid pool offset";
+    return false;
+  }
+
+  JsBinaryCursor Pools(Data.slice(PoolsOffset, Data.size() - 4));
+  uint64_t NumStrings = Pools.readVBR();
+  for (uint64_t i = 0; i != NumStrings && !Pools.hasError(); ++i)
+    Strings.push_back(Pools.readBytes(Pools.readVBR()));
+  uint64_t NumTypes = Pools.readVBR();
+  for (uint64_t i = 0; i != NumTypes && !Pools.hasError(); ++i)
+    TypeStrings.push_back(Pools.readVBR());
+  if (Pools.hasError() || !Pools.atEnd()) {
+    ErrorStr = "malformed string or type pool";
+    return false;
+  }
+
+  // Index the items, without decoding them.
+  JsBinaryCursor Body(Data.slice(4, PoolsOffset));
+  Version = Body.readVBR();
+  if (Version != jsbin::JS_BINARY_VERSION) {
+    ErrorStr = "unsupported version";
+    return false;
+  }
+  while (!Body.atEnd() && !Body.hasError()) {
+    Item I;
+    I.Kind = Body.readVBR();
+    I.Payload = Body.readBytes(Body.readVBR());
+    Items.push_back(I);
+  }
+  if (Body.hasError()) {
+    ErrorStr = "truncated item";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,96 @@
+//===-- JsBinaryReader.h - Reader for the binary intertype format -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This is the reference decoder for the binary intertype format written by the
+// Javascript backend, which is described in JsBinaryFormat.h.  The reader
+// works in place on the file contents: opening a file only decodes the string
+// and type pools and indexes the items, and the items are decoded on demand
+// through a JsBinaryCursor over their payload.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JSBINARYREADER_H
+#define JSBINARYREADER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// JsBinaryCursor - Reads the primitive values of the format from a range of
+/// bytes.  Reading past the end of the range sets the error flag and yields
+/// zeros, so that callers only need to check for errors once they are done.
+class JsBinaryCursor {
+  const unsigned char *Ptr, *End;
+  bool Failed;
+
+public:
+  JsBinaryCursor() : Ptr(0), End(0), Failed(false) {}
+  explicit JsBinaryCursor(StringRef Data)
+    : Ptr(reinterpret_cast<const unsigned char*>(Data.data())),
+      End(reinterpret_cast<const unsigned char*>(Data.data()) + Data.size()),
+      Failed(false) {}
+
+  bool atEnd() const { return Ptr == End; }
+  bool hasError() const { return Failed; }
+
+  uint64_t readVBR();
+  int64_t readSignedVBR();
+  double readDouble();
+
+  /// readBytes - Return the next Size bytes, without copying them.
+  StringRef readBytes(uint64_t Size);
+};
+
+/// JsBinaryReader - An opened binary intertype file.
+class JsBinaryReader {
+public:
+  /// Item - A top-level item: its kind and its undecoded payload.
+  struct Item {
+    unsigned Kind;
+    StringRef Payload;
+  };
+
+private:
+  std::vector<StringRef> Strings;
+  std::vector<unsigned> TypeStrings;
+  std::vector<Item> Items;
+  unsigned Version;
+
+public:
+  JsBinaryReader() : Version(0) {}
+
+  /// open - Decode the header, the pools and the item index of Data, which
+  /// must outlive the reader.  Returns false and sets ErrorStr on malformed
+  /// input.
+  bool open(StringRef Data, std::string &ErrorStr);
+
+  unsigned getVersion() const { return Version; }
+
+  unsigned getNumItems() const { return Items.size(); }
+  const Item &getItem(unsigned i) const { return Items[i]; }
+
+  /// getString - Return the string with the given index, or an empty string
+  /// if the index is out of range.
+  StringRef getString(uint64_t ID) const {
+    return ID < Strings.size() ? Strings[ID] : StringRef();
+  }
+
+  /// getType - Return the description of the type with the given index, or
+  /// an empty string if the index is out of range.
+  StringRef getType(uint64_t ID) const {
+    return ID < TypeStrings.size() ? getString(TypeStrings[ID]) : StringRef();
+  }
+};
+
+} // End llvm namespace
+
+#endif
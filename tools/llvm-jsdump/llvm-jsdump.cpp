@@ -0,0 +1,188 @@
+//===-- llvm-jsdump.cpp - Binary intertype dumping tool -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This tool prints the contents of the binary intertype files written by the
+// Javascript backend (llc -march=js -filetype=obj) in a readable form.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JsBinaryReader.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JsBinaryFormat.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+using namespace llvm;
+
+static cl::opt<std::string>
+InputFile(cl::Positional, cl::desc("<input file>"), cl::init("-"));
+
+static const char *ProgramName;
+
+static int Error(const Twine &Msg) {
+  errs() << ProgramName << ": error: " << Msg << "\n";
+  return 1;
+}
+
+static void DumpValue(const JsBinaryReader &R, JsBinaryCursor &C);
+
+static void DumpOperand(const JsBinaryReader &R, JsBinaryCursor &C) {
+  outs() << R.getType(C.readVBR()) << ' ';
+  DumpValue(R, C);
+}
+
+static void DumpValue(const JsBinaryReader &R, JsBinaryCursor &C) {
+  switch (C.readVBR()) {
+  case jsbin::VALUE_LOCAL:
+    outs() << '%' << R.getString(C.readVBR());
+    break;
+  case jsbin::VALUE_GLOBAL:
+    outs() << '@' << R.getString(C.readVBR());
+    break;
+  case jsbin::VALUE_INT:
+    outs() << C.readSignedVBR();
+    break;
+  case jsbin::VALUE_BOOL:
+    outs() << (C.readVBR() ? "true" : "false");
+    break;
+  case jsbin::VALUE_FLOAT:
+    outs() << C.readDouble();
+    break;
+  case jsbin::VALUE_NULL:
+    outs() << "null";
+    break;
+  case jsbin::VALUE_UNDEF:
+    outs() << "undef";
+    break;
+  case jsbin::VALUE_STRING:
+    outs() << "c\"";
+    outs().write_escaped(R.getString(C.readVBR()));
+    outs() << '"';
+    break;
+  case jsbin::VALUE_AGGREGATE: {
+    uint64_t NumElts = C.readVBR();
+    outs() << '[';
+    for (uint64_t i = 0; i != NumElts && !C.hasError(); ++i) {
+      if (i)
+        outs() << ", ";
+      DumpValue(R, C);
+    }
+    outs() << ']';
+    break;
+  }
+  case jsbin::VALUE_ZERO:
+    outs() << "zeroinitializer";
+    break;
+  case jsbin::VALUE_EXPR: {
+    outs() << R.getString(C.readVBR());
+    if (uint64_t Predicate = C.readVBR())
+      outs() << " pred " << Predicate;
+    uint64_t NumOps = C.readVBR();
+    outs() << " (";
+    for (uint64_t i = 0; i != NumOps && !C.hasError(); ++i) {
+      if (i)
+        outs() << ", ";
+      DumpOperand(R, C);
+    }
+    outs() << ')';
+    break;
+  }
+  default:
+    outs() << "<invalid>";
+    break;
+  }
+}
+
+static void DumpGlobal(const JsBinaryReader &R, JsBinaryCursor &C) {
+  StringRef Ident = R.getString(C.readVBR());
+  uint64_t LineNum = C.readVBR();
+  outs() << "global @" << Ident << " : " << R.getType(C.readVBR()) << " = ";
+  DumpValue(R, C);
+  outs() << "  ; line " << LineNum << "\n";
+}
+
+static void DumpFunction(const JsBinaryReader &R, JsBinaryCursor &C) {
+  StringRef Ident = R.getString(C.readVBR());
+  uint64_t LineNum = C.readVBR();
+  StringRef ReturnType = R.getType(C.readVBR());
+  outs() << "function @" << Ident << '(';
+  uint64_t NumParams = C.readVBR();
+  for (uint64_t i = 0; i != NumParams && !C.hasError(); ++i) {
+    if (i)
+      outs() << ", ";
+    outs() << '%' << R.getString(C.readVBR());
+  }
+  outs() << ") : " << ReturnType << "  ; line " << LineNum << "\n";
+
+  uint64_t NumBlocks = C.readVBR();
+  for (uint64_t b = 0; b != NumBlocks && !C.hasError(); ++b) {
+    outs() << R.getString(C.readVBR()) << ":\n";
+    uint64_t NumInsts = C.readVBR();
+    for (uint64_t i = 0; i != NumInsts && !C.hasError(); ++i) {
+      outs() << "  ";
+      if (uint64_t Ident = C.readVBR())
+        outs() << '%' << R.getString(Ident - 1) << " = ";
+      outs() << R.getString(C.readVBR());
+      uint64_t InstLine = C.readVBR();
+      if (uint64_t Type = C.readVBR())
+        outs() << " : " << R.getType(Type - 1);
+      uint64_t NumOps = C.readVBR();
+      for (uint64_t o = 0; o != NumOps && !C.hasError(); ++o) {
+        outs() << (o ? ", " : " ");
+        DumpOperand(R, C);
+      }
+      outs() << "  ; line " << InstLine << "\n";
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  ProgramName = argv[0];
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv, "llvm binary intertype dumper\n");
+
+  error_code ec;
+  OwningPtr<MemoryBuffer> InputBuffer(
+    MemoryBuffer::getFileOrSTDIN(InputFile, ec));
+  if (!InputBuffer)
+    return Error("unable to read input: '" + ec.message() + "'");
+
+  std::string ErrorStr;
+  JsBinaryReader Reader;
+  if (!Reader.open(InputBuffer->getBuffer(), ErrorStr))
+    return Error("unable to load intertype file: '" + ErrorStr + "'");
+
+  for (unsigned i = 0, e = Reader.getNumItems(); i != e; ++i) {
+    const JsBinaryReader::Item &I = Reader.getItem(i);
+    JsBinaryCursor C(I.Payload);
+    switch (I.Kind) {
+    case jsbin::ITEM_GLOBAL:
+      DumpGlobal(Reader, C);
+      break;
+    case jsbin::ITEM_FUNCTION:
+      DumpFunction(Reader, C);
+      break;
+    default:
+      // Unknown items are skipped, which their length prefix allows.
+      outs() << "; unknown item kind " << I.Kind << "\n";
+      continue;
+    }
+    if (C.hasError() || !C.atEnd())
+      return Error("malformed item " + Twine(i));
+  }
+  return 0;
+}